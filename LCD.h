@@ -6,6 +6,15 @@
  * control de cursor y actualización del estado de instrumentos.
  */
 
+#ifndef LCD_H
+#define LCD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Velocidad del bus I2C de la LCD (PCF8574). */
+#define LCD_BAUD 100000
+
 /**
  * @brief Inicializa la pantalla LCD y la interfaz I2C.
  *
@@ -52,3 +61,20 @@ void lcd_print(const char *s);
  *  - Línea inferior: instrumento del slot vertical.
  */
 void lcd_mostrar_estado();
+
+/**
+ * @brief Enciende o apaga la pantalla y su luz de fondo.
+ *
+ * El contenido se conserva: al encender vuelve a verse lo mismo.
+ *
+ * @param on true para encender.
+ */
+void lcd_set_power(bool on);
+
+/**
+ * @brief Vuelve a fijar la velocidad del I2C tras un cambio de clk_peri
+ *        (aviso de cambio de reloj, ver power_manager.h).
+ */
+void lcd_clock_changed(void);
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * @file adpcm.c
+ * @brief Implementación del decodificador IMA ADPCM.
+ *
+ * Las funciones de decodificación se ubican en RAM, igual que los kernels
+ * de mezcla, porque corren para cada voz comprimida en cada bloque I2S.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "adpcm.h"
+#include "pico/stdlib.h"
+
+static const int16_t step_table[89] = {
+        7,     8,     9,    10,    11,    12,    13,    14,    16,    17,
+       19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+       50,    55,    60,    66,    73,    80,    88,    97,   107,   118,
+      130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+      337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+      876,   963,  1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+     2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+     5894,  6484,  7132,  7845,  8630,  9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/**
+ * @brief Decodifica un nibble y actualiza el estado del canal.
+ */
+static inline int16_t decode_nibble(adpcm_channel_t *ch, uint32_t nibble) {
+    int32_t step = step_table[ch->index];
+    int32_t diff = step >> 3;
+
+    if (nibble & 4) diff += step;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 1) diff += step >> 2;
+
+    int32_t pred = ch->predictor + ((nibble & 8) ? -diff : diff);
+    if (pred >  32767) pred =  32767;
+    if (pred < -32768) pred = -32768;
+    ch->predictor = pred;
+
+    int32_t index = ch->index + index_table[nibble];
+    if (index < 0)  index = 0;
+    if (index > 88) index = 88;
+    ch->index = index;
+
+    return (int16_t)pred;
+}
+
+int16_t adpcm_block_header(adpcm_channel_t *ch, const uint8_t *hdr) {
+    int32_t index = hdr[2];
+
+    ch->predictor = (int16_t)(hdr[0] | (hdr[1] << 8));
+    ch->index     = (index > 88) ? 88 : index;
+    return (int16_t)ch->predictor;
+}
+
+void __time_critical_func(adpcm_decode_mono)(adpcm_channel_t *ch, const uint8_t *src,
+                                             uint32_t bytes, int16_t *dst) {
+    while (bytes--) {
+        uint32_t b = *src++;
+        *dst++ = decode_nibble(ch, b & 0x0F);
+        *dst++ = decode_nibble(ch, b >> 4);
+    }
+}
+
+void __time_critical_func(adpcm_decode_stereo)(adpcm_channel_t ch[2], const uint8_t *src,
+                                               uint32_t groups, int16_t *dst) {
+    while (groups--) {
+        for (uint32_t c = 0; c < 2; c++) {
+            const uint8_t *p   = src + 4 * c;
+            int16_t       *out = dst + c;
+
+            for (uint32_t i = 0; i < 4; i++) {
+                uint32_t b = p[i];
+                out[0] = decode_nibble(&ch[c], b & 0x0F);
+                out[2] = decode_nibble(&ch[c], b >> 4);
+                out += 4;
+            }
+        }
+        src += ADPCM_STEREO_GROUP;
+        dst += 2 * 8;
+    }
+}
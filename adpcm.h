@@ -0,0 +1,71 @@
+/**
+ * @file adpcm.h
+ * @brief Decodificador IMA/DVI ADPCM (WAV formato 0x11) en punto fijo.
+ *
+ * Cada bloque de un WAV IMA ADPCM empieza con una cabecera de 4 bytes por
+ * canal (predictor de 16 bits, índice de paso y un byte reservado); el
+ * predictor es además la primera muestra del bloque. Siguen los datos a
+ * 4 bits por muestra:
+ *  - Mono: cada byte trae dos muestras, primero el nibble bajo.
+ *  - Estéreo: grupos de 8 bytes, 4 del canal izquierdo (8 muestras) y
+ *    4 del derecho.
+ *
+ * El decodificador trabaja por tramos, guardando el estado de cada canal,
+ * para que el reproductor pueda decodificar un bloque en pedazos pequeños
+ * directamente antes de mezclarlos.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef ADPCM_H
+#define ADPCM_H
+
+#include <stdint.h>
+
+/** Bytes de cabecera de bloque por canal. */
+#define ADPCM_HEADER_BYTES  4
+
+/** Bytes de un grupo estéreo (8 frames). */
+#define ADPCM_STEREO_GROUP  8
+
+/**
+ * @brief Estado de decodificación de un canal.
+ */
+typedef struct {
+    int32_t predictor;   /**< Última muestra decodificada. */
+    int32_t index;       /**< Índice en la tabla de pasos (0..88). */
+} adpcm_channel_t;
+
+/**
+ * @brief Carga la cabecera de bloque de un canal.
+ * @return Primera muestra del bloque (el predictor).
+ */
+int16_t adpcm_block_header(adpcm_channel_t *ch, const uint8_t *hdr);
+
+/**
+ * @brief Decodifica datos mono (2 muestras por byte).
+ *
+ * @param ch Estado del canal.
+ * @param src Datos comprimidos.
+ * @param bytes Bytes a decodificar.
+ * @param dst Destino; recibe 2 * @p bytes muestras.
+ */
+void adpcm_decode_mono(adpcm_channel_t *ch, const uint8_t *src,
+                       uint32_t bytes, int16_t *dst);
+
+/**
+ * @brief Decodifica grupos estéreo de 8 bytes en frames L/R intercalados.
+ *
+ * @param ch Estado de los dos canales.
+ * @param src Datos comprimidos.
+ * @param groups Grupos a decodificar.
+ * @param dst Destino; recibe 8 * @p groups frames.
+ */
+void adpcm_decode_stereo(adpcm_channel_t ch[2], const uint8_t *src,
+                         uint32_t groups, int16_t *dst);
+
+#endif // ADPCM_H
@@ -0,0 +1,459 @@
+/**
+ * @file audio_engine.c
+ * @brief Implementación del motor de audio en core1 y sus colas sin bloqueo.
+ *
+ * La mezcla corre en la IRQ DMA del I2S, también en core1; el bucle de
+ * core1 queda para los comandos, las lecturas de la SD y la precarga, y
+ * ninguno de ellos puede retrasar un bloque de audio.
+ *
+ * Las colas son anillos de un productor y un consumidor: cada índice lo
+ * escribe un solo núcleo, así que basta una barrera de memoria entre
+ * escribir el dato y publicar el índice. Core0 emite __sev() al encolar
+ * para despertar a core1, que duerme en __wfe() cuando no tiene trabajo
+ * (la IRQ DMA de bloque libre también lo despierta); core1 hace lo mismo
+ * al publicar un evento, para despertar al bucle principal de core0.
+ *
+ * El estado se publica con un contador de secuencia: impar mientras core1
+ * escribe, par cuando la copia es coherente.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "audio_engine.h"
+#include "audio_player.h"
+#include "i2s_output.h"
+#include "latency_probe.h"
+#include "sample_index.h"
+#include "sistema.h"
+#include "instrumentos.h"
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+
+/**
+ * @brief Comandos que core0 envía a core1.
+ */
+typedef enum {
+    ENGINE_CMD_PLAY_NOTE,
+    ENGINE_CMD_RELEASE_NOTE,
+    ENGINE_CMD_STOP_ALL,
+    ENGINE_CMD_SET_GAIN,
+    ENGINE_CMD_SET_TREMOLO,
+    ENGINE_CMD_SET_INSTRUMENT,
+    ENGINE_CMD_RESET_HEALTH,
+    ENGINE_CMD_RESET_PROFILE,
+    ENGINE_CMD_SUSPEND,
+    ENGINE_CMD_RESUME
+} engine_cmd_type_t;
+
+/**
+ * @brief Comando en la cola core0 -> core1.
+ */
+typedef struct {
+    uint8_t  type;
+    uint8_t  slot;
+    uint8_t  arg;       // nota o instrumento
+    char     variant;
+    uint16_t value;     // ganancia o frecuencia del tremolo
+    uint16_t aux;       // profundidad del tremolo
+} engine_cmd_t;
+
+// Cola de comandos (productor core0, consumidor core1)
+static engine_cmd_t      cmd_queue[AUDIO_ENGINE_CMD_QUEUE];
+static volatile uint32_t cmd_head = 0;
+static volatile uint32_t cmd_tail = 0;
+
+// Cola de eventos (productor core1, consumidor core0)
+static audio_engine_event_t evt_queue[AUDIO_ENGINE_EVT_QUEUE];
+static volatile uint32_t    evt_head = 0;
+static volatile uint32_t    evt_tail = 0;
+
+// Estado publicado por core1
+static audio_engine_status_t status;
+static volatile uint32_t status_seq = 0;
+
+// Instrumento asignado a cada slot (solo lo usa core1)
+static uint8_t engine_slot_inst[2] = {0, 1};
+
+// Precarga pendiente por slot (solo la usa core1)
+static bool     prefetch_pending[2] = {false, false};
+static uint8_t  prefetch_cursor[2];
+static uint32_t prefetch_due_us[2];
+static int      prefetch_slot = -1;   // slot cuya precarga está en curso
+
+// Audio suspendido (solo lo usa core1) y suspensiones completadas (core0 las espera)
+static bool              engine_suspended = false;
+static volatile uint32_t suspend_count    = 0;
+
+static uint32_t core1_stack[AUDIO_ENGINE_CORE1_STACK / sizeof(uint32_t)];
+
+/**
+ * @brief Encola un comando desde core0.
+ */
+static bool cmd_push(const engine_cmd_t *cmd) {
+    uint32_t head = cmd_head;
+    if (head - cmd_tail >= AUDIO_ENGINE_CMD_QUEUE) {
+        return false;
+    }
+
+    cmd_queue[head % AUDIO_ENGINE_CMD_QUEUE] = *cmd;
+    __dmb();
+    cmd_head = head + 1;
+    __sev();
+    return true;
+}
+
+/**
+ * @brief Extrae un comando en core1.
+ */
+static bool cmd_pop(engine_cmd_t *cmd) {
+    uint32_t tail = cmd_tail;
+    if (tail == cmd_head) {
+        return false;
+    }
+
+    __dmb();
+    *cmd = cmd_queue[tail % AUDIO_ENGINE_CMD_QUEUE];
+    __dmb();
+    cmd_tail = tail + 1;
+    return true;
+}
+
+/**
+ * @brief Publica un evento desde core1 (se descarta si core0 no da abasto).
+ */
+static void evt_push(const audio_engine_event_t *ev) {
+    uint32_t head = evt_head;
+    if (head - evt_tail >= AUDIO_ENGINE_EVT_QUEUE) {
+        return;
+    }
+
+    evt_queue[head % AUDIO_ENGINE_EVT_QUEUE] = *ev;
+    __dmb();
+    evt_head = head + 1;
+    __sev();   // despierta al bucle de core0 si duerme (event_loop)
+}
+
+/**
+ * @brief Publica una instantánea del estado del reproductor.
+ */
+static void publish_status(void) {
+    audio_engine_status_t snap = {
+        .player  = audio_player_get_info(),
+        .cache   = sample_cache_get_stats(),
+        .i2s     = i2s_output_get_info(),
+        .health  = audio_health_get(),
+        .profile = audio_player_get_profile()
+    };
+
+    status_seq++;
+    __dmb();
+    status = snap;
+    __dmb();
+    status_seq++;
+}
+
+/**
+ * @brief Ejecuta un comando en core1.
+ */
+static void engine_dispatch(const engine_cmd_t *cmd) {
+    switch (cmd->type) {
+        case ENGINE_CMD_PLAY_NOTE: {
+            latency_probe_mark(LATENCY_CORE1);
+            uint8_t inst = engine_slot_inst[cmd->slot & 1];
+            if (inst >= total_instrumentos && total_instrumentos > 0) {
+                inst = 0;
+            }
+
+            audio_engine_event_t ev = {
+                .type    = ENGINE_EVT_NOTE_FAILED,
+                .slot    = cmd->slot,
+                .inst    = inst,
+                .note    = cmd->arg,
+                .variant = cmd->variant
+            };
+            if (audio_player_play_note(inst, cmd->variant, cmd->arg)) {
+                ev.type = ENGINE_EVT_NOTE_STARTED;
+            }
+            evt_push(&ev);
+            break;
+        }
+
+        case ENGINE_CMD_RELEASE_NOTE:
+            audio_player_release_note(cmd->arg);
+            break;
+
+        case ENGINE_CMD_STOP_ALL:
+            audio_player_stop();
+            break;
+
+        case ENGINE_CMD_SET_GAIN:
+            audio_player_set_gain(cmd->value);
+            break;
+
+        case ENGINE_CMD_SET_TREMOLO:
+            audio_player_set_tremolo(cmd->value, cmd->aux);
+            break;
+
+        case ENGINE_CMD_SET_INSTRUMENT: {
+            uint8_t slot = cmd->slot & 1;
+            engine_slot_inst[slot] = cmd->arg;
+            // Las notas que faltaban del instrumento elegido se reintentan
+            sample_index_forget_missing(cmd->arg);
+
+            // Reiniciar la precarga del slot; la anterior se abandona
+            if (prefetch_slot == slot) {
+                audio_player_prefetch_cancel();
+                prefetch_slot = -1;
+            }
+            prefetch_pending[slot] = true;
+            prefetch_cursor[slot]  = 0;
+            prefetch_due_us[slot]  = time_us_32() + AUDIO_ENGINE_PREFETCH_SETTLE_MS * 1000u;
+            break;
+        }
+
+        case ENGINE_CMD_RESET_HEALTH:
+            audio_health_reset();
+            break;
+
+        case ENGINE_CMD_RESET_PROFILE:
+            audio_player_reset_profile();
+            break;
+
+        case ENGINE_CMD_SUSPEND:
+            audio_player_stop();
+            audio_player_prefetch_cancel();
+            prefetch_slot = -1;
+            i2s_output_stop();
+            engine_suspended = true;
+            __dmb();
+            suspend_count++;
+            __sev();
+            break;
+
+        case ENGINE_CMD_RESUME:
+            i2s_output_start();
+            engine_suspended = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Avanza un paso de la precarga si las voces no esperan lecturas.
+ *
+ * Las recargas de las voces que suenan tienen plazo y van primero; la
+ * precarga solo usa la SD cuando no queda ninguna pendiente. Atiende
+ * primero el slot cambiado más recientemente.
+ *
+ * @param reads_pending true si el reproductor tiene lecturas por hacer.
+ * @param settle_us Devuelve cuánto falta (us) para que venza la espera de
+ *        un slot si toda la precarga pendiente está aún esperando; 0 si no.
+ * @return true si queda precarga que se puede avanzar ya.
+ */
+static bool engine_prefetch(bool reads_pending, uint32_t *settle_us) {
+    *settle_us = 0;
+    if (engine_suspended || (!prefetch_pending[0] && !prefetch_pending[1])) {
+        return false;
+    }
+    if (reads_pending) {
+        return true;
+    }
+
+    uint32_t now  = time_us_32();
+    int      slot = -1;
+    for (int s = 0; s < 2; s++) {
+        if (!prefetch_pending[s]) continue;
+
+        int32_t left = (int32_t)(prefetch_due_us[s] - now);
+        if (left > 0) {
+            if (*settle_us == 0 || (uint32_t)left < *settle_us) *settle_us = (uint32_t)left;
+            continue;
+        }
+        if (slot < 0 || (int32_t)(prefetch_due_us[s] - prefetch_due_us[slot]) > 0) {
+            slot = s;
+        }
+    }
+    if (slot < 0) {
+        return false;  // aún dentro del tiempo de espera (*settle_us)
+    }
+    *settle_us = 0;
+
+    if (prefetch_slot != slot) {
+        audio_player_prefetch_cancel();
+        prefetch_slot = slot;
+    }
+
+    uint8_t inst = engine_slot_inst[slot];
+    if (inst >= total_instrumentos ||
+        !audio_player_prefetch_step(inst, &prefetch_cursor[slot])) {
+        prefetch_pending[slot] = false;
+        prefetch_slot = -1;
+    }
+    return prefetch_pending[0] || prefetch_pending[1];
+}
+
+/**
+ * @brief Bucle principal de core1.
+ */
+static void core1_main(void) {
+    // Lo que imprimirían los módulos que corren aquí va al anillo de
+    // mensajes del reproductor
+    i2s_output_set_log_callback(audio_player_vlog);
+    sample_index_set_log_callback(audio_player_vlog);
+
+    // I2S se inicializa aquí para que su IRQ DMA quede en core1
+    bool ok = i2s_output_init(AUDIO_OUTPUT_RATE) && audio_player_init();
+    multicore_fifo_push_blocking(ok ? 1u : 0u);
+
+    if (!ok) {
+        while (true) {
+            __wfe();
+        }
+    }
+
+    while (true) {
+        engine_cmd_t cmd;
+        while (cmd_pop(&cmd)) {
+            engine_dispatch(&cmd);
+        }
+
+        bool reading = audio_player_process();
+        if (!engine_suspended) {
+            // Tras reanudar, el DMA arranca con la primera nota mezclada
+            i2s_output_prime();
+        }
+        publish_status();
+
+        uint32_t settle_us;
+        bool prefetching = engine_prefetch(reading, &settle_us);
+
+        // Dormir hasta un comando (__sev de core0) o una IRQ de bloque
+        // libre, que es donde la mezcla pide nuevas lecturas; si la
+        // precarga espera a que el selector se asiente, hasta ese plazo
+        if (cmd_tail == cmd_head && !reading && !prefetching) {
+            if (settle_us > 0) {
+                best_effort_wfe_or_timeout(make_timeout_time_us(settle_us));
+            } else {
+                __wfe();
+            }
+        }
+    }
+}
+
+bool audio_engine_start(void) {
+    multicore_launch_core1_with_stack(core1_main, core1_stack, sizeof(core1_stack));
+    bool ok = multicore_fifo_pop_blocking() == 1u;
+
+    // Mensajes del arranque de core1, en orden con los del resto del arranque
+    char line[AUDIO_LOG_LINE_LEN];
+    while (audio_player_pop_log(line)) {
+        printf("%s", line);
+    }
+    return ok;
+}
+
+bool audio_engine_play_note(uint8_t slot, char variant, uint8_t note) {
+    engine_cmd_t cmd = {
+        .type = ENGINE_CMD_PLAY_NOTE, .slot = slot, .arg = note, .variant = variant
+    };
+    return cmd_push(&cmd);
+}
+
+bool audio_engine_release_note(uint8_t note) {
+    engine_cmd_t cmd = { .type = ENGINE_CMD_RELEASE_NOTE, .arg = note };
+    return cmd_push(&cmd);
+}
+
+bool audio_engine_stop_all(void) {
+    engine_cmd_t cmd = { .type = ENGINE_CMD_STOP_ALL };
+    return cmd_push(&cmd);
+}
+
+bool audio_engine_suspend(void) {
+    engine_cmd_t cmd    = { .type = ENGINE_CMD_SUSPEND };
+    uint32_t     target = suspend_count + 1;
+
+    if (!cmd_push(&cmd)) {
+        return false;
+    }
+    while (suspend_count != target) {
+        __wfe();
+    }
+    return true;
+}
+
+bool audio_engine_resume(void) {
+    engine_cmd_t cmd = { .type = ENGINE_CMD_RESUME };
+    return cmd_push(&cmd);
+}
+
+bool audio_engine_set_gain(uint16_t gain_q8) {
+    engine_cmd_t cmd = { .type = ENGINE_CMD_SET_GAIN, .value = gain_q8 };
+    return cmd_push(&cmd);
+}
+
+bool audio_engine_set_tremolo(uint16_t rate_chz, uint16_t depth_q15) {
+    engine_cmd_t cmd = {
+        .type = ENGINE_CMD_SET_TREMOLO, .value = rate_chz, .aux = depth_q15
+    };
+    return cmd_push(&cmd);
+}
+
+bool audio_engine_set_instrument(uint8_t slot, uint8_t inst) {
+    engine_cmd_t cmd = { .type = ENGINE_CMD_SET_INSTRUMENT, .slot = slot, .arg = inst };
+    return cmd_push(&cmd);
+}
+
+bool audio_engine_reset_health(void) {
+    engine_cmd_t cmd = { .type = ENGINE_CMD_RESET_HEALTH };
+    return cmd_push(&cmd);
+}
+
+bool audio_engine_reset_profile(void) {
+    engine_cmd_t cmd = { .type = ENGINE_CMD_RESET_PROFILE };
+    return cmd_push(&cmd);
+}
+
+bool audio_engine_poll_event(audio_engine_event_t *ev) {
+    uint32_t tail = evt_tail;
+    if (tail == evt_head) {
+        return false;
+    }
+
+    __dmb();
+    *ev = evt_queue[tail % AUDIO_ENGINE_EVT_QUEUE];
+    __dmb();
+    evt_tail = tail + 1;
+    return true;
+}
+
+bool audio_engine_poll_log(char *line) {
+    return audio_player_pop_log(line);
+}
+
+audio_engine_status_t audio_engine_get_status(void) {
+    audio_engine_status_t copy;
+    uint32_t s0, s1;
+
+    do {
+        s0 = status_seq;
+        __dmb();
+        copy = status;
+        __dmb();
+        s1 = status_seq;
+    } while ((s0 & 1u) || s0 != s1);
+
+    return copy;
+}
+
+bool audio_engine_is_playing(void) {
+    return audio_engine_get_status().player.state == PLAYER_PLAYING;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file audio_engine.h
+ * @brief Motor de audio dedicado en core1.
+ *
+ * El reproductor (recarga de buffers desde la SD, mezcla de voces y
+ * alimentación del I2S) corre completo en core1: la mezcla en la IRQ DMA
+ * del I2S y las lecturas de la SD en el bucle principal. Core0 se comunica con él
+ * solo a través de:
+ *  - Una cola SPSC de comandos core0 -> core1 (tocar y soltar nota, detener,
+ *    ganancia, tremolo, cambio de instrumento, reinicio de contadores
+ *    y del perfil en ciclos).
+ *  - Una cola SPSC de eventos core1 -> core0 (nota iniciada / fallida).
+ *  - Un anillo SPSC de mensajes de texto core1 -> core0: core1 nunca
+ *    llama a printf, core0 imprime los mensajes del reproductor, del I2S
+ *    y del índice de samples.
+ *  - Una instantánea del estado del reproductor publicada por core1.
+ *
+ * Ninguna operación bloquea: si una cola está llena, el comando (o el
+ * mensaje) se descarta y la función devuelve false. Así el trabajo lento
+ * de core0 (LCD, IMU, printf) nunca puede dejar sin datos al audio.
+ *
+ * Tras audio_engine_start() todos los accesos a la SD los hace core1.
+ *
+ * Al asignar un instrumento a un slot, core1 precarga en segundo plano el
+ * ataque de sus notas, solo cuando las voces no esperan lecturas de la SD
+ * y tras AUDIO_ENGINE_PREFETCH_SETTLE_MS sin nuevos cambios en ese slot:
+ * si el usuario sigue recorriendo la lista, la precarga del instrumento
+ * anterior se abandona.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef AUDIO_ENGINE_H
+#define AUDIO_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "audio_player.h"
+#include "sample_cache.h"
+#include "i2s_output.h"
+#include "audio_health.h"
+
+/** Capacidad de la cola de comandos (potencia de 2). */
+#define AUDIO_ENGINE_CMD_QUEUE   16
+
+/** Capacidad de la cola de eventos (potencia de 2). */
+#define AUDIO_ENGINE_EVT_QUEUE   16
+
+/** Espera tras el último cambio de instrumento antes de precargarlo (ms). */
+#define AUDIO_ENGINE_PREFETCH_SETTLE_MS 150
+
+/** Tamaño de la pila de core1 en bytes. */
+#define AUDIO_ENGINE_CORE1_STACK 8192
+
+/**
+ * @brief Tipos de eventos que core1 informa a core0.
+ */
+typedef enum {
+    ENGINE_EVT_NOTE_STARTED,  /**< La nota empezó a sonar. */
+    ENGINE_EVT_NOTE_FAILED    /**< No se pudo iniciar la nota. */
+} audio_engine_event_type_t;
+
+/**
+ * @brief Evento publicado por core1.
+ */
+typedef struct {
+    uint8_t type;     /**< audio_engine_event_type_t. */
+    uint8_t slot;     /**< Slot de instrumento usado (SLOT_H / SLOT_V). */
+    uint8_t inst;     /**< Índice de instrumento resuelto. */
+    uint8_t note;     /**< Índice de nota 0..6. */
+    char    variant;  /**< Variante 'a' / 'b'. */
+} audio_engine_event_t;
+
+/**
+ * @brief Estado del motor publicado por core1.
+ */
+typedef struct {
+    player_info_t        player;  /**< Reproductor y mezcla. */
+    sample_cache_stats_t cache;   /**< Caché de samples. */
+    i2s_info_t           i2s;     /**< Salida I2S / DMA. */
+    audio_health_t       health;  /**< Contadores de salud del audio. */
+    player_profile_t     profile; /**< Perfil en ciclos del reproductor. */
+} audio_engine_status_t;
+
+/**
+ * @brief Lanza core1, que inicializa I2S y el reproductor y queda atendiendo
+ *        comandos. Espera a que core1 confirme la inicialización.
+ *
+ * El I2S queda fijo en AUDIO_OUTPUT_RATE. Los mensajes de la
+ * inicialización de core1 se imprimen antes de volver.
+ *
+ * @return true si core1 inicializó I2S y reproductor correctamente.
+ */
+bool audio_engine_start(void);
+
+/**
+ * @brief Encola tocar una nota del instrumento asignado a un slot.
+ * @return false si la cola de comandos está llena.
+ */
+bool audio_engine_play_note(uint8_t slot, char variant, uint8_t note);
+
+/**
+ * @brief Encola soltar una nota: sus voces pasan a la fase de release.
+ * @param note Índice de nota 0..6 (la tecla, sin importar el slot).
+ * @return false si la cola de comandos está llena.
+ */
+bool audio_engine_release_note(uint8_t note);
+
+/**
+ * @brief Encola detener todas las voces.
+ */
+bool audio_engine_stop_all(void);
+
+/**
+ * @brief Detiene todas las voces y la salida I2S, y espera a que core1
+ *        quede sin trabajo (sin lecturas de la SD ni IRQ de bloque).
+ *
+ * Deja los periféricos de audio quietos para cambiar los relojes o
+ * dormir (ver power_manager.h).
+ *
+ * @return false si la cola de comandos está llena.
+ */
+bool audio_engine_suspend(void);
+
+/**
+ * @brief Encola reanudar la salida I2S, con el divisor del reloj actual.
+ *
+ * Los comandos encolados después (por ejemplo, la nota que despertó al
+ * instrumento) se atienden con el I2S ya en marcha.
+ */
+bool audio_engine_resume(void);
+
+/**
+ * @brief Encola un cambio de ganancia maestra (Q8, 256 = 1.0).
+ */
+bool audio_engine_set_gain(uint16_t gain_q8);
+
+/**
+ * @brief Encola nuevos objetivos del tremolo.
+ * @param rate_chz Frecuencia del LFO en centésimas de Hz.
+ * @param depth_q15 Profundidad en Q15 (0 desactiva el efecto).
+ */
+bool audio_engine_set_tremolo(uint16_t rate_chz, uint16_t depth_q15);
+
+/**
+ * @brief Encola la asignación de un instrumento a un slot.
+ * @param slot SLOT_H o SLOT_V.
+ * @param inst Índice en la tabla de instrumentos.
+ */
+bool audio_engine_set_instrument(uint8_t slot, uint8_t inst);
+
+/**
+ * @brief Encola el reinicio de los contadores de salud del audio.
+ */
+bool audio_engine_reset_health(void);
+
+/**
+ * @brief Encola el reinicio del perfil en ciclos del reproductor.
+ */
+bool audio_engine_reset_profile(void);
+
+/**
+ * @brief Extrae el siguiente evento publicado por core1.
+ * @return true si había un evento.
+ */
+bool audio_engine_poll_event(audio_engine_event_t *ev);
+
+/**
+ * @brief Extrae el siguiente mensaje de texto del reproductor en core1,
+ *        para que core0 lo imprima.
+ * @param line Buffer de AUDIO_LOG_LINE_LEN bytes.
+ * @return true si había un mensaje.
+ */
+bool audio_engine_poll_log(char *line);
+
+/**
+ * @brief Copia coherente del último estado publicado por core1.
+ */
+audio_engine_status_t audio_engine_get_status(void);
+
+/**
+ * @brief Indica si core1 está reproduciendo (según el último estado publicado).
+ */
+bool audio_engine_is_playing(void);
+
+#endif // AUDIO_ENGINE_H
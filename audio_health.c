@@ -0,0 +1,142 @@
+/**
+ * @file audio_health.c
+ * @brief Implementación de los contadores de salud del audio.
+ *
+ * Cada registro es un par de sumas y comparaciones, así que puede quedar
+ * siempre activo, incluso dentro de la IRQ de mezcla. Los promedios se
+ * calculan al leer, a partir de sumas de 64 bits.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "audio_health.h"
+#include "i2s_output.h"
+#include "hardware/sync.h"
+#include <string.h>
+#include <stdio.h>
+
+/**
+ * @brief Acumulador de una latencia.
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+} latency_acc_t;
+
+static uint32_t      i2s_underruns = 0;
+static uint8_t       ring_min_fill = I2S_RING_BLOCKS;
+static latency_acc_t read_acc;
+static uint32_t      read_hist[AUDIO_HEALTH_HIST_BINS];
+static uint32_t      read_misses   = 0;
+static uint32_t      swap_misses   = 0;
+static latency_acc_t note_acc;
+
+/**
+ * @brief Suma una muestra a un acumulador de latencia.
+ */
+static void latency_add(latency_acc_t *acc, uint32_t us) {
+    if (acc->count == 0 || us < acc->min_us) acc->min_us = us;
+    if (us > acc->max_us) acc->max_us = us;
+    acc->sum_us += us;
+    acc->count++;
+}
+
+/**
+ * @brief Resume un acumulador en mínimo, promedio y máximo.
+ */
+static audio_health_latency_t latency_get(const latency_acc_t *acc) {
+    audio_health_latency_t l = {
+        .count  = acc->count,
+        .min_us = acc->min_us,
+        .avg_us = acc->count ? (uint32_t)(acc->sum_us / acc->count) : 0,
+        .max_us = acc->max_us
+    };
+    return l;
+}
+
+void audio_health_reset(void) {
+    uint32_t irq = save_and_disable_interrupts();
+
+    i2s_underruns = 0;
+    ring_min_fill = I2S_RING_BLOCKS;
+    memset(&read_acc, 0, sizeof(read_acc));
+    memset(read_hist, 0, sizeof(read_hist));
+    read_misses   = 0;
+    swap_misses   = 0;
+    memset(&note_acc, 0, sizeof(note_acc));
+
+    restore_interrupts(irq);
+}
+
+audio_health_t audio_health_get(void) {
+    audio_health_t h;
+    uint32_t irq = save_and_disable_interrupts();
+
+    h.i2s_underruns = i2s_underruns;
+    h.ring_min_fill = ring_min_fill;
+    h.read          = latency_get(&read_acc);
+    memcpy(h.read_hist, read_hist, sizeof(read_hist));
+    h.read_misses   = read_misses;
+    h.swap_misses   = swap_misses;
+    h.note          = latency_get(&note_acc);
+
+    restore_interrupts(irq);
+    return h;
+}
+
+void audio_health_ring(uint32_t queued, uint32_t underruns) {
+    if (queued < ring_min_fill) ring_min_fill = (uint8_t)queued;
+    i2s_underruns += underruns;
+}
+
+void audio_health_read(uint32_t us, bool late) {
+    // Intervalo i: [2^i, 2^(i+1)) us; 0 y 1 us caen en el primero
+    uint32_t bin = (us > 1) ? (31u - (uint32_t)__builtin_clz(us)) : 0;
+    if (bin >= AUDIO_HEALTH_HIST_BINS) bin = AUDIO_HEALTH_HIST_BINS - 1;
+
+    latency_add(&read_acc, us);
+    read_hist[bin]++;
+    if (late) read_misses++;
+}
+
+void audio_health_swap_miss(void) {
+    swap_misses++;
+}
+
+void audio_health_note_start(uint32_t us) {
+    latency_add(&note_acc, us);
+}
+
+void audio_health_print(const audio_health_t *h) {
+    printf("Salud del audio:\n");
+    printf("  I2S: %lu bloques de silencio en reproducción, anillo mínimo %u/%u bloques\n",
+           (unsigned long)h->i2s_underruns, h->ring_min_fill, I2S_RING_BLOCKS);
+    printf("  Lecturas SD: %lu (min %lu / prom %lu / max %lu us), %lu tarde\n",
+           (unsigned long)h->read.count,
+           (unsigned long)h->read.min_us,
+           (unsigned long)h->read.avg_us,
+           (unsigned long)h->read.max_us,
+           (unsigned long)h->read_misses);
+    for (int i = 0; i < AUDIO_HEALTH_HIST_BINS; i++) {
+        if (h->read_hist[i] == 0) continue;
+        if (i == AUDIO_HEALTH_HIST_BINS - 1) {
+            printf("    >= %lu us: %lu\n", 1ul << i, (unsigned long)h->read_hist[i]);
+        } else {
+            printf("    %lu..%lu us: %lu\n", 1ul << i, (2ul << i) - 1,
+                   (unsigned long)h->read_hist[i]);
+        }
+    }
+    printf("  Faltas de datos al cambiar de buffer: %lu\n",
+           (unsigned long)h->swap_misses);
+    printf("  Inicio de nota: %lu notas (min %lu / prom %lu / max %lu us)\n",
+           (unsigned long)h->note.count,
+           (unsigned long)h->note.min_us,
+           (unsigned long)h->note.avg_us,
+           (unsigned long)h->note.max_us);
+}
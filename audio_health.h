@@ -0,0 +1,98 @@
+/**
+ * @file audio_health.h
+ * @brief Contadores de salud del audio, siempre activos.
+ *
+ * Registra lo necesario para explicar un corte de audio con números:
+ *  - Bloques de silencio que el DMA tuvo que insertar mientras se
+ *    reproducía (el anillo I2S se vació) y el llenado mínimo del anillo.
+ *  - Latencia de las lecturas de la SD: mínimo, promedio, máximo e
+ *    histograma en potencias de 2, más las que llegaron tarde a su plazo.
+ *  - Faltas de datos al intercambiar buffers de una voz.
+ *  - Latencia de inicio de nota: desde que core1 acepta la nota hasta que
+ *    su primer bloque entra al anillo I2S.
+ *
+ * Lo escriben la IRQ de mezcla y el bucle de core1; core0 lo lee en la
+ * instantánea del motor (audio_engine_get_status()) y puede volcarlo por
+ * la consola USB con audio_health_print().
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef AUDIO_HEALTH_H
+#define AUDIO_HEALTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Intervalos del histograma: [2^i, 2^(i+1)) us; el último acumula el resto. */
+#define AUDIO_HEALTH_HIST_BINS 16
+
+/**
+ * @brief Mínimo, promedio y máximo de una latencia en microsegundos.
+ */
+typedef struct {
+    uint32_t count;   /**< Muestras registradas. */
+    uint32_t min_us;  /**< Mínimo (0 si no hay muestras). */
+    uint32_t avg_us;  /**< Promedio. */
+    uint32_t max_us;  /**< Máximo. */
+} audio_health_latency_t;
+
+/**
+ * @brief Contadores de salud desde el último reinicio.
+ */
+typedef struct {
+    uint32_t i2s_underruns;      /**< Bloques de silencio insertados durante la reproducción. */
+    uint8_t  ring_min_fill;      /**< Menor número de bloques en cola visto por la mezcla. */
+    audio_health_latency_t read; /**< Lecturas de la SD. */
+    uint32_t read_hist[AUDIO_HEALTH_HIST_BINS];  /**< Histograma log2 de las lecturas. */
+    uint32_t read_misses;        /**< Lecturas completadas después de su plazo. */
+    uint32_t swap_misses;        /**< Intercambios de buffer sin el siguiente listo. */
+    audio_health_latency_t note; /**< Inicio de nota hasta su primer bloque. */
+} audio_health_t;
+
+/**
+ * @brief Pone a cero todos los contadores.
+ */
+void audio_health_reset(void);
+
+/**
+ * @brief Devuelve una copia coherente de los contadores (llamar en core1).
+ */
+audio_health_t audio_health_get(void);
+
+/**
+ * @brief Imprime los contadores por la consola.
+ */
+void audio_health_print(const audio_health_t *h);
+
+/**
+ * @brief Registra el estado del anillo I2S al entrar la mezcla.
+ *
+ * @param queued Bloques en cola (escritos y aún no reproducidos).
+ * @param underruns Bloques de silencio insertados desde la llamada anterior.
+ */
+void audio_health_ring(uint32_t queued, uint32_t underruns);
+
+/**
+ * @brief Registra una lectura de la SD.
+ *
+ * @param us Duración de la lectura.
+ * @param late true si terminó después de su plazo.
+ */
+void audio_health_read(uint32_t us, bool late);
+
+/**
+ * @brief Registra un intercambio de buffer sin el siguiente listo.
+ */
+void audio_health_swap_miss(void);
+
+/**
+ * @brief Registra la latencia de inicio de una nota.
+ */
+void audio_health_note_start(uint32_t us);
+
+#endif // AUDIO_HEALTH_H
@@ -1,13 +1,52 @@
 /**
  * @file audio_player.c
- * @brief Implementación del reproductor de audio WAV con doble buffer e I2S.
- * 
+ * @brief Implementación del reproductor de audio WAV polifónico con I2S.
+ *
  * Este módulo gestiona:
- *  - Lectura del archivo WAV desde la SD usando FatFS.
- *  - Doble buffer para reproducción continua.
+ *  - Hasta AUDIO_MAX_VOICES voces simultáneas, cada una con su propio
+ *    archivo WAV abierto en la SD (FatFS) y su propio doble buffer.
+ *  - Caché de samples en RAM (sample_cache): las notas ya tocadas empiezan
+ *    desde memoria sin acceder a la SD, y el archivo solo se abre si el
+ *    audio continúa más allá de lo guardado.
+ *  - Producción de audio en la IRQ DMA del I2S (core1): cada vez que se
+ *    libera un bloque del anillo se mezcla el siguiente, sin esperar a la
+ *    SD. Las lecturas de la SD quedan como peticiones con plazo que
+ *    audio_player_process() atiende en segundo plano, la más urgente
+ *    primero; la mezcla solo comprueba si el buffer siguiente está listo.
+ *  - Mezcla de las voces en un acumulador de 32 bits con una única pasada
+ *    de saturación por bloque I2S. Cada voz suma sus frames con un kernel
+ *    especializado en su formato y ganancia (mix_kernels), elegido al
+ *    iniciar la nota.
+ *  - Envolvente ADSR en punto fijo por voz. Al soltar la tecla la voz
+ *    pasa a release; al llegar a cero se libera y su lectura de la SD se
+ *    cierra, aunque el sample no haya terminado. Mientras la envolvente
+ *    se mueve, la voz se mezcla en un acumulador aparte con la ganancia
+ *    interpolada frame a frame; en sostenido a 1.0 no cuesta nada.
+ *  - Lazo de sostenido: mientras la tecla sigue pulsada, una nota con
+ *    lazo (chunk "smpl" o banco) repite ese tramo. El final del lazo se
+ *    sustituye por un tramo fundido con el audio previo a su inicio,
+ *    calculado una vez por voz, así que la vuelta no tiene salto; si el
+ *    lazo está en el caché, la nota sostenida ya no lee la SD.
+ *  - Tremolo sobre la mezcla, con la ganancia interpolada
+ *    dentro de cada bloque para evitar escalones.
+ *  - Salida I2S a frecuencia fija (AUDIO_OUTPUT_RATE): cada voz con otra
+ *    frecuencia pasa por un remuestreador lineal en punto fijo, así que
+ *    tocar una nota nunca reprograma la PIO.
+ *  - Camino sin copia: si suena una sola voz PCM estéreo a la frecuencia
+ *    de salida, con ganancia efectiva 1.0 (banco pre-atenuado) y sin
+ *    tremolo, el DMA del I2S lee los bloques directamente de su buffer.
+ *    El buffer queda retenido hasta que el DMA lo suelta: no se recarga,
+ *    ni se devuelve su página al caché, ni se reutiliza la voz antes.
+ *  - Precarga en segundo plano del ataque de las notas de un instrumento
+ *    recién seleccionado (audio_player_prefetch_step).
+ *  - Robo de voz (la más silenciosa y, a igualdad, la más antigua) cuando
+ *    no quedan voces libres.
  *  - Control de estados (PLAY, PAUSE, STOP).
- *  - Decodificación simple de WAV PCM 16 bits.
- * 
+ *  - WAV PCM 16 bits e IMA ADPCM 4 bits; las cabeceras de las notas
+ *    vienen ya analizadas del índice (sample_index). El ADPCM se mantiene
+ *    comprimido en la SD y en el caché y se decodifica por tramos justo
+ *    antes de mezclar.
+ *
  * @authors
  *  - Mauricio Reyes Rosero
  *  - Reinaldo Marín Nieto
@@ -18,470 +57,1505 @@
 #include "audio_player.h"
 #include "i2s_output.h"
 #include "sd_manager.h"
+#include "sample_cache.h"
+#include "sample_index.h"
+#include "mix_kernels.h"
+#include "tremolo.h"
+#include "adpcm.h"
+#include "audio_health.h"
+#include "latency_probe.h"
 #include "ff.h"
 #include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
 
 
-#define AUDIO_VOLUME_SHIFT  3   
+#if SAMPLE_CACHE_PAGE_SIZE != AUDIO_VOICE_BUFFER_SIZE
+#error "La página del caché debe medir lo mismo que el buffer de una voz"
+#endif
 
-// Double buffering
-static uint8_t audio_buffer_0[AUDIO_BUFFER_SIZE] __attribute__((aligned(4)));
-static uint8_t audio_buffer_1[AUDIO_BUFFER_SIZE] __attribute__((aligned(4)));
+/** Nivel máximo de la envolvente (Q30). */
+#define ENV_ONE  (1 << 30)
 
-static uint8_t *current_buffer = audio_buffer_0;
-static uint8_t *next_buffer    = audio_buffer_1;
-static uint32_t buffer_position    = 0;
-static uint32_t buffer_size        = 0;
-static uint32_t next_buffer_size   = 0;
-static bool     need_load_next_buf = false;
+/**
+ * @brief Fases de la envolvente ADSR de una voz.
+ */
+typedef enum {
+    ENV_ATTACK,
+    ENV_DECAY,
+    ENV_SUSTAIN,
+    ENV_RELEASE,
+    ENV_DONE
+} env_stage_t;
+
+/**
+ * @brief Estado de una voz: archivo, doble buffer y posición de lectura.
+ *
+ * Cada buffer apunta a la memoria propia de la voz o a una página del caché.
+ */
+typedef struct {
+    uint8_t  storage[2][AUDIO_VOICE_BUFFER_SIZE] __attribute__((aligned(4)));
+    const uint8_t *buffer[2];
+    FIL      file;
+    FIL     *bank;                // banco abierto compartido (índice), o NULL
+    DWORD   *linkmap;             // mapa de clusters compartido (índice), o NULL
+    DWORD    local_map[SAMPLE_LINKMAP_WORDS];  // mapa propio si no hay compartido
+    char     path[SAMPLE_CACHE_KEY_LEN];
+    int      cache_id;            // entrada del caché (-1 si no tiene)
+    uint32_t data_offset;         // offset del chunk data en el archivo
+    volatile bool active;         // lo apaga también la IRQ al terminar la voz
+    bool     file_open;
+    uint8_t  current;             // índice del buffer en reproducción
+    volatile bool need_load_next_buf;  // petición de lectura pendiente
+    uint32_t refill_due_us;       // plazo de la petición: fin del buffer actual
+    uint32_t buffer_us;           // duración aproximada de un buffer lleno (us)
+    uint32_t buffer_position;
+    uint32_t buffer_size;
+    uint32_t next_buffer_size;
+    uint32_t bytes_played;        // bytes mezclados
+    uint32_t total_bytes;         // tamaño del chunk data
+    uint32_t data_bytes_read;     // bytes del chunk data ya cargados (caché o SD)
+    uint32_t sample_rate;
+    uint16_t channels;
+    uint16_t bits;
+    uint16_t format;              // WAV_FORMAT_PCM o WAV_FORMAT_IMA_ADPCM
+    uint16_t block_align;         // bytes por bloque ADPCM
+    adpcm_channel_t adpcm[2];     // estado del decodificador por canal
+    int16_t  pcm[AUDIO_ADPCM_CHUNK_FRAMES * 2] __attribute__((aligned(4)));  // tramo decodificado
+    uint32_t pcm_pos;             // frames del tramo ya mezclados
+    uint32_t pcm_len;             // frames del tramo
+    uint32_t start_seq;           // orden de inicio, para robo de voz
+    uint32_t start_us;            // momento en que se aceptó la nota
+    bool     start_pending;       // aún no entró su primer bloque al anillo
+    uint16_t level;               // pico absoluto del último bloque
+    int32_t  gain_q8;             // ganancia de la voz (Q8)
+    mix_kernel_t render;          // kernel elegido según canales y ganancia
+    mix_resample_kernel_t resample;  // remuestreador, o NULL si va a la frecuencia de salida
+    mix_resampler_t rs;
+    bool     dma_held[2];         // buffer entregado al DMA sin copia y aún no reproducido
+    uint32_t dma_seq[2];          // secuencia I2S del último bloque entregado de cada buffer
+    uint8_t  key;                 // tecla que la inició (AUDIO_NO_KEY si ninguna)
+    volatile bool release_req;    // tecla soltada: la IRQ pasa la voz a release
+    uint8_t  env_stage;           // env_stage_t (solo la IRQ de mezcla)
+    int32_t  env_level;           // nivel de la envolvente, Q30
+    uint32_t loop_start;          // inicio del lazo en el chunk data (bytes)
+    uint32_t loop_end;            // fin del lazo (bytes), 0 si la voz no repite
+    uint32_t loop_xfade;          // bytes del fundido al final del lazo
+    uint32_t loop_resume;         // donde sigue la lectura tras el fundido (bytes)
+    bool     loop_tail_ready;     // loop_tail ya calculado
+    int16_t  loop_tail[AUDIO_LOOP_XFADE_FRAMES * 2] __attribute__((aligned(4)));  // final del lazo fundido
+} voice_t;
+
+static voice_t voices[AUDIO_MAX_VOICES];
+
+// Acumulador de mezcla (L/R intercalados)
+static int32_t mix_acc[I2S_BLOCK_FRAMES * 2];
+
+// Acumulador de una voz con la envolvente en movimiento
+static int32_t env_acc[I2S_BLOCK_FRAMES * 2];
+
+/**
+ * @brief Paso por frame (Q30) que recorre @p range en @p ms milisegundos.
+ */
+#define ENV_STEP(range, ms) \
+    ((int32_t)((range) / (((ms) * AUDIO_OUTPUT_RATE) / 1000 > 0 \
+                          ? ((ms) * AUDIO_OUTPUT_RATE) / 1000 : 1)))
+
+static const int32_t env_sustain      = (int32_t)(((int64_t)AUDIO_ENV_SUSTAIN_Q15 << 15));
+static const int32_t env_attack_step  = ENV_STEP((int64_t)ENV_ONE, AUDIO_ENV_ATTACK_MS);
+static const int32_t env_decay_step   = ENV_STEP((int64_t)ENV_ONE - ((int64_t)AUDIO_ENV_SUSTAIN_Q15 << 15),
+                                                 AUDIO_ENV_DECAY_MS);
+static const int32_t env_release_step = ENV_STEP((int64_t)ENV_ONE, AUDIO_ENV_RELEASE_MS);
 
 // Estado del reproductor
-static player_state_t player_state = PLAYER_IDLE;
-static FIL      audio_file;
-static bool     file_open          = false;
-static uint32_t bytes_played       = 0;  // bytes enviados a I2S
-static uint32_t total_bytes        = 0;  // tamaño del chunk data
-static uint32_t data_start_position = 0;
+static volatile player_state_t player_state = PLAYER_IDLE;
+static volatile int32_t master_gain_q8 = AUDIO_DEFAULT_GAIN_Q8;
+static int32_t  tremolo_gain   = TREMOLO_UNITY_Q15;   // ganancia al final del último bloque
+static uint32_t next_start_seq = 0;
+static int      last_voice     = -1;   // última voz iniciada (para info)
+
+// Archivo recién abierto, aún sin voz: se valida antes de robar ninguna
+static FIL open_file;
+
+// Mensajes para core0 (anillo SPSC: escribe el reproductor, lee core0)
+static char              log_lines[AUDIO_LOG_LINES][AUDIO_LOG_LINE_LEN];
+static volatile uint32_t log_head = 0;
+static volatile uint32_t log_tail = 0;
 
-// bytes del chunk data leído de la SD
-static uint32_t data_bytes_read = 0;
+// Métricas de mezcla
+static uint32_t mix_us_avg_q4   = 0;   // promedio exponencial, Q4
+static uint32_t mix_us_max      = 0;
+static uint32_t decode_us_block = 0;   // decodificación ADPCM del bloque en curso
+static uint32_t decode_us_avg_q4 = 0;
 
-// Información del WAV
-static uint32_t wav_sample_rate = 0;
-static uint16_t wav_channels    = 0;
-static uint16_t wav_bits        = 0;
+// Perfil en ciclos (SysTick de core1)
+static player_profile_t  profile;
+static volatile uint32_t irq_cycles = 0;   // ciclos acumulados en la IRQ de mezcla
 
+// Precarga
+static FIL      prefetch_file;          // WAV suelto en precarga (los bancos ya están abiertos)
+static bool     prefetch_open  = false;
+static uint32_t prefetch_pages = 0;
+static uint32_t voices_stolen   = 0;
 
+// Salud del anillo I2S (solo la IRQ de mezcla)
+static uint32_t ring_silence   = 0;       // bloques de silencio vistos en la IRQ anterior
+static bool     ring_streaming = false;   // la IRQ anterior dejó el anillo reproduciendo
+static uint32_t ring_first_seq = 0;       // primer bloque mezclado al pasar a reproducir
 
-/** 
- * @brief Cabecera RIFF del archivo WAV.
+
+
+// Mensajes
+
+void audio_player_vlog(const char *format, va_list args) {
+    uint32_t head = log_head;
+    if (head - log_tail >= AUDIO_LOG_LINES) {
+        return;
+    }
+
+    vsnprintf(log_lines[head % AUDIO_LOG_LINES], AUDIO_LOG_LINE_LEN, format, args);
+    __dmb();
+    log_head = head + 1;
+}
+
+/**
+ * @brief Deja un mensaje para que core0 lo imprima (se descarta si el
+ *        anillo está lleno: el audio nunca espera a la consola).
  */
-typedef struct {
-    char     riff[4];
-    uint32_t file_size;
-    char     wave[4];
-} wav_riff_header_t;
+static void player_log(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    audio_player_vlog(format, args);
+    va_end(args);
+}
+
+bool audio_player_pop_log(char *line) {
+    uint32_t tail = log_tail;
+    if (tail == log_head) {
+        return false;
+    }
+
+    __dmb();
+    memcpy(line, log_lines[tail % AUDIO_LOG_LINES], AUDIO_LOG_LINE_LEN);
+    __dmb();
+    log_tail = tail + 1;
+    return true;
+}
+
+
+// Voces
 
 /**
- * @brief Cabecera genérica de chunk WAV.
+ * @brief Indica si el DMA todavía puede leer el buffer @p index de la voz.
  */
-typedef struct {
-    char     chunk_id[4];
-    uint32_t chunk_size;
-} wav_chunk_header_t;
+static bool voice_buffer_busy(voice_t *v, uint8_t index) {
+    if (v->dma_held[index] && i2s_output_block_done(v->dma_seq[index])) {
+        v->dma_held[index] = false;
+    }
+    return v->dma_held[index];
+}
 
 /**
- * @brief Datos del chunk "fmt " del archivo WAV.
+ * @brief Suelta la entrada del caché de la voz.
  */
-typedef struct {
-    uint16_t audio_format;
-    uint16_t num_channels;
-    uint32_t sample_rate;
-    uint32_t byte_rate;
-    uint16_t block_align;
-    uint16_t bits_per_sample;
-} wav_fmt_data_t;
+static void voice_drop_cache(voice_t *v) {
+    if (v->cache_id >= 0) {
+        sample_cache_release(v->cache_id);
+        v->cache_id = -1;
+    }
+}
+
+/**
+ * @brief Libera una voz, cierra su archivo y suelta su entrada del caché.
+ *
+ * Solo desde fuera de la IRQ. La voz se desactiva primero, así la IRQ de
+ * mezcla deja de usarla antes de cerrar nada. Si el DMA aún lee alguno de
+ * sus buffers, la entrada del caché se suelta más tarde
+ * (audio_player_process) para que sus páginas no se reutilicen.
+ */
+static void voice_release(voice_t *v) {
+    v->active = false;
+    __dmb();
 
+    if (v->file_open) {
+        f_close(&v->file);
+        v->file_open = false;
+    }
+    if (!voice_buffer_busy(v, 0) && !voice_buffer_busy(v, 1)) {
+        voice_drop_cache(v);
+    }
+    v->bank = NULL;
+}
 
 /**
- * @brief Busca el chunk "data" dentro del archivo WAV.
- * @param file Puntero al archivo.
- * @param data_size Devuelve el tamaño del chunk.
- * @param data_position Devuelve el offset donde comienza el audio.
- * @return true si se encontró correctamente.
+ * @brief Número de voces activas.
  */
-static bool find_data_chunk(FIL *file, uint32_t *data_size, uint32_t *data_position) {
-    wav_chunk_header_t chunk;
-    UINT bytes_read;
-    FRESULT fr;
+static uint8_t voices_active_count(void) {
+    uint8_t n = 0;
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        if (voices[i].active) n++;
+    }
+    return n;
+}
 
-    while (true) {
-        fr = f_read(file, &chunk, sizeof(wav_chunk_header_t), &bytes_read);
-        if (fr != FR_OK || bytes_read != sizeof(wav_chunk_header_t)) {
-            return false;
+/**
+ * @brief Devuelve la única voz activa, o NULL si hay ninguna o varias.
+ */
+static voice_t *voice_solo(void) {
+    voice_t *solo = NULL;
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        if (!voices[i].active) continue;
+        if (solo) return NULL;
+        solo = &voices[i];
+    }
+    return solo;
+}
+
+/**
+ * @brief Obtiene una voz libre o roba la más silenciosa (a igualdad, la más antigua).
+ *
+ * Nunca entrega una voz cuyos buffers siga leyendo el DMA (camino sin
+ * copia): la nota nueva los sobrescribiría mientras suenan.
+ *
+ * @return Índice de la voz asignada, o -1 si el DMA retiene todas.
+ */
+static int voice_alloc(void) {
+    int victim = -1;
+
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        voice_t *v = &voices[i];
+        if (!v->active) {
+            // Puede haberla terminado la IRQ: cerrar lo que quede abierto
+            voice_release(v);
+        }
+        if (voice_buffer_busy(v, 0) || voice_buffer_busy(v, 1)) {
+            continue;
+        }
+        if (!v->active) {
+            voice_drop_cache(v);
+            return i;
         }
 
-        if (memcmp(chunk.chunk_id, "data", 4) == 0) {
-            *data_size     = chunk.chunk_size;
-            *data_position = f_tell(file);
-            printf("   Chunk 'data' en offset %lu, tamaño: %lu bytes\n",
-                   *data_position, *data_size);
-            return true;
+        voice_t *w = (victim >= 0) ? &voices[victim] : NULL;
+        if (!w || v->level < w->level ||
+            (v->level == w->level &&
+             (int32_t)(v->start_seq - w->start_seq) < 0)) {
+            victim = i;
         }
+    }
+
+    if (victim >= 0) {
+        voice_release(&voices[victim]);
+        voices_stolen++;
+    }
+    return victim;
+}
+
+/**
+ * @brief Instala el mapa de clusters en el archivo recién abierto de la voz.
+ *
+ * Usa el mapa del índice si existe; si no, crea uno propio de la voz. Con
+ * el mapa, las lecturas y saltos posteriores no vuelven a leer la FAT.
+ */
+static void voice_attach_linkmap(voice_t *v) {
+    if (v->linkmap) {
+        v->file.cltbl = v->linkmap;
+    } else {
+        sample_index_create_linkmap(&v->file, v->local_map,
+                                    SAMPLE_LINKMAP_WORDS, NULL);
+    }
+}
+
+/**
+ * @brief Archivo del que lee la voz: su banco o su propio archivo.
+ */
+static FIL *voice_fp(voice_t *v) {
+    return v->bank ? v->bank : &v->file;
+}
 
-        fr = f_lseek(file, f_tell(file) + chunk.chunk_size);
+/**
+ * @brief Abre el archivo de la voz (si hace falta) y lo posiciona en el
+ *        offset dado del chunk data.
+ *
+ * Las notas de un banco leen del banco ya abierto, compartido con las
+ * demás voces del instrumento: basta con el salto.
+ */
+static bool voice_seek_file(voice_t *v, uint32_t offset) {
+    if (!v->bank && !v->file_open) {
+        FRESULT fr = f_open(&v->file, v->path, FA_READ);
         if (fr != FR_OK) {
+            player_log("Error al abrir archivo: %d\n", fr);
+            return false;
+        }
+        v->file_open = true;
+        voice_attach_linkmap(v);
+    }
+
+    FIL     *fp  = voice_fp(v);
+    uint32_t pos = v->data_offset + offset;
+    if (f_tell(fp) != pos) {
+        if (f_lseek(fp, pos) != FR_OK) {
             return false;
         }
     }
+    return true;
 }
 
+/**
+ * @brief Copia @p bytes del chunk data desde @p offset, del caché si ya
+ *        están en él o de la SD si no.
+ *
+ * Lo que se lee de la SD a continuación del prefijo del caché se guarda
+ * también en él, de modo que la siguiente nota lo encuentra en RAM.
+ */
+static bool voice_copy_data(voice_t *v, uint32_t offset, uint8_t *dst, uint32_t bytes) {
+    while (bytes > 0) {
+        uint32_t chunk = SAMPLE_CACHE_PAGE_SIZE - offset % SAMPLE_CACHE_PAGE_SIZE;
+        if (chunk > bytes) {
+            chunk = bytes;
+        }
 
-// API
+        uint8_t *page = NULL;
+        bool     hit  = false;
+        if (v->cache_id >= 0) {
+            uint32_t valid = sample_cache_valid_bytes(v->cache_id);
+            hit = (offset + chunk <= valid);
+            if (hit || (offset == valid &&
+                        offset + chunk <= sample_cache_capacity(v->cache_id))) {
+                page = sample_cache_page(v->cache_id, offset);
+            }
+        }
 
-bool audio_player_init() {
-    printf("Iniciando reproductor de audio.\n");
-    player_state = PLAYER_IDLE;
-    file_open    = false;
-    bytes_played = 0;
-    total_bytes  = 0;
+        if (!hit) {
+            UINT bytes_read;
+            if (!voice_seek_file(v, offset) ||
+                f_read(voice_fp(v), page ? page : dst, chunk, &bytes_read) != FR_OK ||
+                bytes_read != chunk) {
+                return false;
+            }
+            if (page) {
+                sample_cache_commit(v->cache_id, offset, chunk);
+            }
+        }
+        if (page) {
+            memcpy(dst, page, chunk);
+        }
+
+        offset += chunk;
+        dst    += chunk;
+        bytes  -= chunk;
+    }
     return true;
 }
 
-bool audio_player_play(const char *filename) {
-    if (player_state == PLAYER_PLAYING) {
-        printf("Ya hay un archivo reproduciéndose\n");
+/**
+ * @brief Calcula el final del lazo fundido con el audio previo a su inicio.
+ *
+ * loop_tail sustituye a los últimos frames del lazo: empieza igual que
+ * ellos y termina en los frames que preceden a loop_resume, así que al
+ * volver al lazo la forma de onda continúa sin salto. Usa el buffer
+ * @p index de la voz (el que se va a cargar) como memoria temporal.
+ */
+static bool voice_build_loop_tail(voice_t *v, uint8_t index) {
+    uint8_t *pre   = v->storage[index];
+    uint32_t bytes = v->loop_xfade;
+
+    if (!voice_copy_data(v, v->loop_end - bytes, (uint8_t *)v->loop_tail, bytes) ||
+        !voice_copy_data(v, v->loop_resume - bytes, pre, bytes)) {
         return false;
     }
 
-    if (!sd_manager_is_ready()) {
-        printf("SD no está lista\n");
-        return false;
+    const int16_t *in     = (const int16_t *)pre;
+    int32_t        frames = (int32_t)(bytes / ((uint32_t)v->channels * 2u));
+
+    for (int32_t i = 0; i < frames; i++) {
+        for (uint16_t c = 0; c < v->channels; c++) {
+            uint32_t k = (uint32_t)i * v->channels + c;
+            v->loop_tail[k] = (int16_t)((v->loop_tail[k] * (frames - i) + in[k] * i) / frames);
+        }
+    }
+
+    v->loop_tail_ready = true;
+    return true;
+}
+
+/**
+ * @brief Carga en un buffer de la voz el siguiente tramo del chunk data.
+ *
+ * Si el tramo ya está en el caché, el buffer apunta a la página sin leer
+ * la SD. Si no, se lee de la SD: sobre la página del caché cuando el tramo
+ * continúa el prefijo guardado y aún hay páginas reservadas, o sobre la
+ * memoria propia de la voz en caso contrario.
+ *
+ * Mientras la tecla de una voz con lazo sigue pulsada, la lectura se
+ * detiene donde empieza el fundido: el buffer siguiente es loop_tail y
+ * la lectura vuelve a loop_resume. Un tramo nunca cruza un límite de
+ * página, así que tras la vuelta las lecturas se realinean con el caché.
+ *
+ * @param v Voz.
+ * @param index Buffer destino (0 o 1).
+ * @param size Devuelve los bytes disponibles (0 si no queda audio).
+ * @return false si hubo error de lectura.
+ */
+static bool voice_read_buffer(voice_t *v, uint8_t index, uint32_t *size) {
+    bool     looping = (v->loop_end > 0 && !v->release_req);
+    uint32_t end     = looping ? v->loop_end - v->loop_xfade : v->total_bytes;
+
+    *size = 0;
+    if (looping && v->data_bytes_read >= end) {
+        if (v->loop_xfade > 0) {
+            if (!v->loop_tail_ready && !voice_build_loop_tail(v, index)) {
+                return false;
+            }
+            v->buffer[index]   = (const uint8_t *)v->loop_tail;
+            *size              = v->loop_xfade;
+            v->data_bytes_read = v->loop_resume;
+            return true;
+        }
+        v->data_bytes_read = v->loop_start;
+    }
+
+    uint32_t offset     = v->data_bytes_read;
+    uint32_t bytes_left = (end > offset) ? (end - offset) : 0;
+    uint32_t room       = AUDIO_VOICE_BUFFER_SIZE - offset % AUDIO_VOICE_BUFFER_SIZE;
+
+    uint32_t bytes_to_read = (bytes_left > room) ? room : bytes_left;
+
+    if (bytes_to_read == 0) {
+        return true;
     }
 
-    player_state = PLAYER_LOADING;
-    printf("Cargando %s\n", filename);
+    uint8_t *dst      = v->storage[index];
+    bool     to_cache = false;
+
+    if (v->cache_id >= 0) {
+        uint32_t valid = sample_cache_valid_bytes(v->cache_id);
+
+        if (offset < valid) {
+            uint32_t n = valid - offset;
+            v->buffer[index]    = sample_cache_page(v->cache_id, offset);
+            *size               = (n < bytes_to_read) ? n : bytes_to_read;
+            v->data_bytes_read += *size;
+            return true;
+        }
+
+        if (offset == valid && offset < sample_cache_capacity(v->cache_id)) {
+            dst      = sample_cache_page(v->cache_id, offset);
+            to_cache = true;
+        }
+    }
 
-    FRESULT fr;
-    UINT    bytes_read;
+    if (!voice_seek_file(v, offset)) {
+        return false;
+    }
 
-    fr = f_open(&audio_file, filename, FA_READ);
+    UINT     bytes_read;
+    uint32_t i0 = irq_cycles;
+    uint32_t c0 = benchmark_cycles();
+    uint32_t t0 = time_us_32();
+    FRESULT  fr = f_read(voice_fp(v), dst, bytes_to_read, &bytes_read);
+    uint32_t t1 = time_us_32();
+    uint32_t c1 = benchmark_cycles();
     if (fr != FR_OK) {
-        printf("Error al abrir archivo: %d\n", fr);
-        player_state = PLAYER_ERROR;
         return false;
     }
-    file_open = true;
 
-    // Leer RIFF header
-    wav_riff_header_t riff;
-    fr = f_read(&audio_file, &riff, sizeof(wav_riff_header_t), &bytes_read);
-    if (fr != FR_OK || bytes_read != sizeof(wav_riff_header_t)) {
-        printf("Error al leer RIFF\n");
-        f_close(&audio_file);
-        file_open    = false;
-        player_state = PLAYER_ERROR;
+    if (bytes_read > 0) {
+        uint32_t kb = (bytes_read + 512u) / 1024u;
+        benchmark_stat_add(&profile.read,
+                           benchmark_elapsed(c0, c1) - (irq_cycles - i0),
+                           kb ? kb : 1u);
+    }
+
+    // Solo las recargas tienen plazo; las lecturas al iniciar la nota no
+    audio_health_read(t1 - t0, v->need_load_next_buf &&
+                               (int32_t)(t1 - v->refill_due_us) > 0);
+
+    if (to_cache) {
+        sample_cache_commit(v->cache_id, offset, bytes_read);
+    }
+
+    v->buffer[index]    = dst;
+    *size               = bytes_read;
+    v->data_bytes_read += bytes_read;
+    return true;
+}
+
+/**
+ * @brief Indica si el siguiente tramo de la voz ya está en el caché.
+ */
+static bool voice_next_is_cached(const voice_t *v) {
+    return v->cache_id >= 0 &&
+           v->data_bytes_read < sample_cache_valid_bytes(v->cache_id);
+}
+
+/**
+ * @brief Indica si a la voz le queda audio por leer: el resto del archivo
+ *        o, mientras repite su lazo, la vuelta al inicio del lazo.
+ */
+static bool voice_has_more(const voice_t *v) {
+    return (v->loop_end > 0 && !v->release_req) ||
+           v->data_bytes_read < v->total_bytes;
+}
+
+/**
+ * @brief Garantiza @p need bytes en el buffer actual de la voz.
+ *
+ * Si el buffer se agota y el siguiente ya está cargado, los intercambia y
+ * deja una petición de lectura para audio_player_process(), con plazo en
+ * el momento en que se agotará el buffer nuevo. Corre en la IRQ de mezcla:
+ * al terminar el archivo solo desactiva la voz, y audio_player_process()
+ * cierra luego su archivo y suelta su caché.
+ *
+ * @return false si no hay datos (falta de datos o fin de la voz).
+ */
+static bool voice_ensure_data(voice_t *v, uint32_t need) {
+    while (v->buffer_position + need > v->buffer_size) {
+        if (v->need_load_next_buf) {
+            // El siguiente buffer aún no llegó desde la SD
+            audio_health_swap_miss();
+            return false;
+        }
+        if (v->next_buffer_size == 0) {
+            v->active = false;
+            return false;
+        }
+
+        // Intercambiar buffers
+        v->current         ^= 1;
+        v->buffer_size      = v->next_buffer_size;
+        v->next_buffer_size = 0;
+        v->buffer_position  = 0;
+        // Tras el último tramo del archivo no se pide nada: la voz termina
+        // al agotarlo en vez de contar una falta de datos
+        if (voice_has_more(v)) {
+            v->refill_due_us    = time_us_32() +
+                                  (uint32_t)(((uint64_t)v->buffer_us * v->buffer_size) /
+                                             AUDIO_VOICE_BUFFER_SIZE);
+            v->need_load_next_buf = true;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Decodifica el siguiente tramo ADPCM de la voz en v->pcm.
+ *
+ * Los buffers empiezan siempre en un límite de bloque (el bloque divide al
+ * buffer), así que la posición dentro del bloque sale del buffer_position.
+ */
+static bool voice_decode_chunk(voice_t *v) {
+    if (!voice_ensure_data(v, 1)) {
         return false;
     }
 
-    if (memcmp(riff.riff, "RIFF", 4) != 0 ||
-        memcmp(riff.wave, "WAVE", 4) != 0) {
-        printf("Archivo no es WAV válido\n");
-        f_close(&audio_file);
-        file_open    = false;
-        player_state = PLAYER_ERROR;
+    uint32_t pos      = v->buffer_position;
+    uint32_t in_block = pos % v->block_align;
+    const uint8_t *p  = &v->buffer[v->current][pos];
+
+    if (in_block == 0) {
+        // Cabecera: su predictor es el primer frame del bloque
+        uint32_t hdr = ADPCM_HEADER_BYTES * v->channels;
+        if (!voice_ensure_data(v, hdr)) {
+            return false;
+        }
+        p = &v->buffer[v->current][v->buffer_position];
+
+        v->pcm[0] = adpcm_block_header(&v->adpcm[0], p);
+        if (v->channels == 2) {
+            v->pcm[1] = adpcm_block_header(&v->adpcm[1], p + ADPCM_HEADER_BYTES);
+        }
+        v->buffer_position += hdr;
+        v->bytes_played    += hdr;
+        v->pcm_pos = 0;
+        v->pcm_len = 1;
+    } else {
+        uint32_t block_end = pos - in_block + v->block_align;
+        if (block_end > v->buffer_size) {
+            block_end = v->buffer_size;   // último bloque incompleto
+        }
+        uint32_t bytes = block_end - pos;
+
+        if (v->channels == 1) {
+            if (bytes > AUDIO_ADPCM_CHUNK_FRAMES / 2) {
+                bytes = AUDIO_ADPCM_CHUNK_FRAMES / 2;
+            }
+            adpcm_decode_mono(&v->adpcm[0], p, bytes, v->pcm);
+            v->pcm_len = 2 * bytes;
+        } else {
+            uint32_t groups = bytes / ADPCM_STEREO_GROUP;
+            if (groups > AUDIO_ADPCM_CHUNK_FRAMES / 8) {
+                groups = AUDIO_ADPCM_CHUNK_FRAMES / 8;
+            }
+            if (groups == 0) {
+                // Resto de bloque truncado: se descarta
+                v->buffer_position = block_end;
+                return voice_decode_chunk(v);
+            }
+            bytes = groups * ADPCM_STEREO_GROUP;
+            adpcm_decode_stereo(v->adpcm, p, groups, v->pcm);
+            v->pcm_len = 8 * groups;
+        }
+        v->buffer_position += bytes;
+        v->bytes_played    += bytes;
+        v->pcm_pos = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief voice_decode_chunk() con su tiempo sumado a la métrica del bloque
+ *        (una sola vez, aunque salte un resto de bloque truncado).
+ */
+static bool voice_decode(voice_t *v) {
+    uint32_t t0 = time_us_32();
+    bool     ok = voice_decode_chunk(v);
+
+    decode_us_block += time_us_32() - t0;
+    return ok;
+}
+
+/**
+ * @brief Entrega el siguiente tramo contiguo de frames PCM de la voz.
+ *
+ * En PCM es un puntero al buffer actual; en ADPCM, al tramo decodificado.
+ *
+ * @param v Voz.
+ * @param src Devuelve el primer frame.
+ * @param frames Devuelve los frames disponibles.
+ * @return false si la voz no tiene datos en este momento o terminó.
+ */
+static bool voice_fetch(voice_t *v, const uint8_t **src, uint32_t *frames) {
+    if (v->format == WAV_FORMAT_IMA_ADPCM) {
+        if (v->pcm_pos >= v->pcm_len && !voice_decode(v)) {
+            return false;
+        }
+        *src    = (const uint8_t *)&v->pcm[v->pcm_pos * v->channels];
+        *frames = v->pcm_len - v->pcm_pos;
+        return true;
+    }
+
+    uint32_t frame_bytes = (uint32_t)v->channels * 2u;
+    if (!voice_ensure_data(v, frame_bytes)) {
         return false;
     }
+    *src    = &v->buffer[v->current][v->buffer_position];
+    *frames = (v->buffer_size - v->buffer_position) / frame_bytes;
+    return true;
+}
 
-    // Buscar chunk 'fmt '
-    wav_chunk_header_t chunk;
-    wav_fmt_data_t     fmt;
-    bool               fmt_found = false;
+/**
+ * @brief Avanza la voz los frames consumidos por el kernel.
+ */
+static void voice_consume(voice_t *v, uint32_t frames) {
+    if (v->format == WAV_FORMAT_IMA_ADPCM) {
+        v->pcm_pos += frames;
+        return;
+    }
 
-    while (true) {
-        fr = f_read(&audio_file, &chunk, sizeof(wav_chunk_header_t), &bytes_read);
-        if (fr != FR_OK || bytes_read != sizeof(wav_chunk_header_t)) {
-            break;
+    uint32_t bytes = frames * (uint32_t)v->channels * 2u;
+    v->buffer_position += bytes;
+    v->bytes_played    += bytes;
+}
+
+/**
+ * @brief Avanza la envolvente de la voz @p frames frames.
+ *
+ * Recorre las fases que se completen dentro del tramo; la mezcla
+ * interpola linealmente entre el nivel inicial y el final.
+ */
+static void voice_env_advance(voice_t *v, uint32_t frames) {
+    int64_t left = frames;
+
+    while (left > 0) {
+        int32_t level = v->env_level;
+        int32_t step;
+        int32_t target;
+
+        switch (v->env_stage) {
+            case ENV_ATTACK:  step = env_attack_step;   target = ENV_ONE;     break;
+            case ENV_DECAY:   step = -env_decay_step;   target = env_sustain; break;
+            case ENV_RELEASE: step = -env_release_step; target = 0;           break;
+            default:          return;   // sostenido o terminada: nivel fijo
         }
 
-        if (memcmp(chunk.chunk_id, "fmt ", 4) == 0) {
-            uint32_t fmt_size = (chunk.chunk_size < sizeof(wav_fmt_data_t))
-                                ? chunk.chunk_size
-                                : sizeof(wav_fmt_data_t);
+        int64_t need = (step != 0) ? ((int64_t)target - level) / step : 0;
+        if (need > left) {
+            v->env_level = level + (int32_t)(step * left);
+            return;
+        }
 
-            fr = f_read(&audio_file, &fmt, fmt_size, &bytes_read);
-            if (fr == FR_OK) {
-                fmt_found = true;
+        v->env_level = target;
+        v->env_stage = (v->env_stage == ENV_ATTACK) ? ENV_DECAY :
+                       (v->env_stage == ENV_DECAY)  ? ENV_SUSTAIN : ENV_DONE;
+        left -= (need > 0) ? need : 1;
+    }
+}
 
-                if (chunk.chunk_size > fmt_size) {
-                    f_lseek(&audio_file,
-                            f_tell(&audio_file) + (chunk.chunk_size - fmt_size));
-                }
-            }
+/**
+ * @brief Suma @p frames frames de @p src al acumulador con la ganancia
+ *        pasando linealmente de @p from a @p to (Q15).
+ *
+ * La ganancia se aplica en Q12 para que el producto quepa en 32 bits con
+ * las voces amplificadas (bancos pre-atenuados).
+ */
+static void env_ramp_add(const int32_t *src, int32_t *acc, uint32_t frames,
+                         int32_t from, int32_t to) {
+    int32_t g_q8 = from << 8;   // ganancia Q15 con 8 bits extra
+    int32_t step = ((to - from) * 256) / (int32_t)frames;
+
+    for (uint32_t n = 0; n < frames; n++) {
+        g_q8 += step;
+        int32_t g = g_q8 >> 11;
+        acc[2 * n]     += (src[2 * n]     * g) >> 12;
+        acc[2 * n + 1] += (src[2 * n + 1] * g) >> 12;
+    }
+}
+
+/**
+ * @brief Mezcla hasta I2S_BLOCK_FRAMES frames de la voz en el acumulador.
+ *
+ * Entrega al kernel de la voz tramos contiguos de frames PCM (del buffer
+ * actual o del tramo recién decodificado). Si la envolvente se mueve en
+ * este bloque, la voz se mezcla antes en env_acc y se suma con la
+ * ganancia interpolada; al terminar su release la voz se desactiva.
+ */
+static void voice_mix(voice_t *v, int32_t *acc) {
+    uint16_t peak = 0;
+    uint32_t n = 0;
+
+    if (v->release_req && v->env_stage < ENV_RELEASE) {
+        v->env_stage = ENV_RELEASE;
+    }
+    int32_t env_from = v->env_level >> 15;
+    voice_env_advance(v, I2S_BLOCK_FRAMES);
+    int32_t env_to = v->env_level >> 15;
+
+    int32_t *dst = acc;
+    bool     ramp = (env_from != (ENV_ONE >> 15) || env_to != (ENV_ONE >> 15));
+    if (ramp) {
+        memset(env_acc, 0, sizeof(env_acc));
+        dst = env_acc;
+    }
+
+    while (n < I2S_BLOCK_FRAMES) {
+        const uint8_t *src;
+        uint32_t       avail;
+        uint32_t       used;
+
+        if (!voice_fetch(v, &src, &avail)) {
             break;
         }
 
-        // No era 'fmt ', saltar contenido
-        fr = f_lseek(&audio_file, f_tell(&audio_file) + chunk.chunk_size);
-        if (fr != FR_OK) {
+        if (v->resample) {
+            // Produce hasta completar el bloque o agotar el tramo
+            n += v->resample(&v->rs, src, avail, &dst[2 * n],
+                             I2S_BLOCK_FRAMES - n, v->gain_q8, &used);
+            if (v->rs.peak > peak) peak = v->rs.peak;
+        } else {
+            used = I2S_BLOCK_FRAMES - n;
+            if (avail < used) used = avail;
+
+            uint16_t p = v->render(src, &dst[2 * n], used, v->gain_q8);
+            if (p > peak) peak = p;
+            n += used;
+        }
+
+        voice_consume(v, used);
+    }
+
+    if (ramp && n > 0) {
+        env_ramp_add(env_acc, acc, n, env_from, env_to);
+        int32_t env_max = (env_from > env_to) ? env_from : env_to;
+        peak = (uint16_t)(((uint32_t)peak * (uint32_t)env_max) >> 15);
+    }
+    v->level = peak;
+
+    if (v->env_stage == ENV_DONE) {
+        v->active = false;   // audio_player_process() cierra su archivo
+    }
+}
+
+/**
+ * @brief Intenta entregar el bloque al DMA directamente desde el buffer de la voz.
+ *
+ * Solo es posible si la salida sería idéntica a la muestra original: una
+ * única voz activa, PCM estéreo sin remuestrear, ganancia de la voz por la
+ * maestra igual a 1.0, envolvente sostenida en 1.0 y tremolo en reposo
+ * durante todo el bloque.
+ *
+ * @return Frames entregados, o NULL si el bloque se debe mezclar.
+ */
+static const uint32_t *voice_zero_copy(voice_t *v, int32_t trem_from, int32_t trem_to) {
+    const uint32_t bytes = I2S_BLOCK_FRAMES * 4u;
+
+    if (v->format != WAV_FORMAT_PCM || v->channels != 2 || v->resample ||
+        v->gain_q8 * master_gain_q8 != MIX_GAIN_UNITY_Q8 * MIX_GAIN_UNITY_Q8 ||
+        trem_from != TREMOLO_UNITY_Q15 || trem_to != TREMOLO_UNITY_Q15 ||
+        v->env_stage != ENV_SUSTAIN || v->env_level != ENV_ONE || v->release_req) {
+        return NULL;
+    }
+
+    // Cambia de buffer solo si el actual está agotado y el siguiente listo;
+    // las faltas de datos y el fin de la voz los resuelve la mezcla normal
+    if (v->buffer_position >= v->buffer_size &&
+        (v->need_load_next_buf || v->next_buffer_size == 0)) {
+        return NULL;
+    }
+    if (!voice_ensure_data(v, 4) || v->buffer_size - v->buffer_position < bytes) {
+        return NULL;
+    }
+
+    // Solo buffers completos: los dos de la voz cubren el anillo entero. Uno
+    // corto (final del archivo o del prefijo en caché, fundido del lazo,
+    // vuelta a su inicio) se mezcla, así no queda retenido y la voz se
+    // recarga con margen
+    if (v->buffer_size != AUDIO_VOICE_BUFFER_SIZE) {
+        return NULL;
+    }
+
+    const uint8_t *src = &v->buffer[v->current][v->buffer_position];
+    if (((uintptr_t)src & 3u) != 0) {
+        return NULL;
+    }
+
+    if (!i2s_output_commit_external((const uint32_t *)src, &v->dma_seq[v->current])) {
+        return NULL;
+    }
+    v->dma_held[v->current] = true;
+    voice_consume(v, I2S_BLOCK_FRAMES);
+    return (const uint32_t *)src;
+}
+
+/**
+ * @brief Convierte el acumulador en frames I2S aplicando ganancia y saturación.
+ *
+ * El tremolo se aplica tras la saturación (su ganancia nunca supera 1),
+ * pasando linealmente de @p trem_from a @p trem_to a lo largo del bloque.
+ */
+static void mix_to_block(const int32_t *acc, uint32_t *block,
+                         int32_t trem_from, int32_t trem_to) {
+    int32_t gain  = master_gain_q8;
+    bool    trem  = (trem_from != TREMOLO_UNITY_Q15 || trem_to != TREMOLO_UNITY_Q15);
+    int32_t g_q8  = trem_from << 8;   // ganancia del tremolo con 8 bits extra
+    int32_t step  = ((trem_to - trem_from) * 256) / (int32_t)I2S_BLOCK_FRAMES;
+
+    for (uint32_t n = 0; n < I2S_BLOCK_FRAMES; n++) {
+        int32_t l = (acc[2 * n]     * gain) >> 8;
+        int32_t r = (acc[2 * n + 1] * gain) >> 8;
+
+        if (l >  32767) l =  32767;
+        if (l < -32768) l = -32768;
+        if (r >  32767) r =  32767;
+        if (r < -32768) r = -32768;
+
+        if (trem) {
+            g_q8 += step;
+            int32_t g = g_q8 >> 8;
+            l = (l * g) >> 15;
+            r = (r * g) >> 15;
+        }
+
+        block[n] = i2s_output_pack_frame((int16_t)l, (int16_t)r);
+    }
+}
+
+/**
+ * @brief Mezcla los bloques libres del anillo I2S.
+ *
+ * Callback de bloque liberado: corre en la IRQ DMA del I2S en core1, así
+ * que la producción de audio nunca espera a una lectura de la SD en curso.
+ * No toca la SD ni el caché: una voz sin su buffer siguiente cuenta una
+ * falta de datos y sigue en el próximo bloque.
+ */
+static void player_fill_ring(void) {
+    uint32_t *block;
+
+    // Silencio insertado con el anillo en reproducción = el anillo se vació.
+    // Al arrancar desde reposo los canales DMA aún tienen cargado silencio:
+    // no cuenta hasta que el DMA suelte el primer bloque mezclado
+    uint32_t silence = i2s_output_get_info().silence_blocks;
+    if (ring_streaming && i2s_output_block_done(ring_first_seq)) {
+        audio_health_ring(I2S_RING_BLOCKS - i2s_output_free_blocks(),
+                          silence - ring_silence);
+    }
+    ring_silence = silence;
+    latency_probe_service();
+
+    if (!ring_streaming) {
+        ring_first_seq = i2s_output_block_seq();
+    }
+
+    while (player_state == PLAYER_PLAYING &&
+           (block = i2s_output_get_block()) != NULL) {
+        // Una voz sola sin copia agota su buffer antes de poder recargar el
+        // otro, que el DMA suelta justo en esta IRQ: mientras el anillo aún
+        // tenga audio pendiente se espera a la recarga en vez de mezclarla
+        // en silencio
+        voice_t *solo = voice_solo();
+        if (solo && solo->need_load_next_buf &&
+            i2s_output_free_blocks() < I2S_RING_BLOCKS &&
+            solo->buffer_size - solo->buffer_position < I2S_BLOCK_FRAMES * 4u) {
             break;
         }
+
+        uint32_t c0 = benchmark_cycles();
+        uint32_t t0 = time_us_32();
+
+        decode_us_block = 0;
+        int32_t trem = tremolo_next_gain(I2S_BLOCK_FRAMES);
+
+        uint32_t        seq = i2s_output_block_seq();
+        const uint32_t *out = solo ? voice_zero_copy(solo, tremolo_gain, trem) : NULL;
+        if (!out) {
+            memset(mix_acc, 0, sizeof(mix_acc));
+            for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+                if (voices[i].active) voice_mix(&voices[i], mix_acc);
+            }
+            mix_to_block(mix_acc, block, tremolo_gain, trem);
+            i2s_output_commit_block();
+            out = block;
+        }
+        tremolo_gain = trem;
+        latency_probe_block(out, seq);
+
+        uint32_t now = time_us_32();
+        for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+            voice_t *v = &voices[i];
+            if (v->start_pending && v->active) {
+                audio_health_note_start(now - v->start_us);
+                v->start_pending = false;
+            }
+        }
+
+        uint32_t dc = benchmark_elapsed(c0, benchmark_cycles());
+        benchmark_stat_add(&profile.mix, dc, I2S_BLOCK_FRAMES);
+        irq_cycles += dc;
+
+        uint32_t dt = now - t0;
+        if (dt > mix_us_max) mix_us_max = dt;
+        mix_us_avg_q4    = mix_us_avg_q4 - (mix_us_avg_q4 >> 4) + dt;
+        decode_us_avg_q4 = decode_us_avg_q4 - (decode_us_avg_q4 >> 4) + decode_us_block;
     }
 
-    if (!fmt_found) {
-        printf("No se encontró chunk 'fmt'\n");
-        f_close(&audio_file);
-        file_open    = false;
-        player_state = PLAYER_ERROR;
-        return false;
+    ring_streaming = (player_state == PLAYER_PLAYING);
+}
+
+
+// API
+
+bool audio_player_init() {
+    player_log("Iniciando reproductor de audio.\n");
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        voices[i].active    = false;
+        voices[i].file_open = false;
+        voices[i].bank      = NULL;
+        voices[i].cache_id  = -1;
+        voices[i].dma_held[0] = false;
+        voices[i].dma_held[1] = false;
     }
+    sample_cache_init();
+    player_log("Caché de samples: %u páginas x %u bytes (%u KB)\n",
+               SAMPLE_CACHE_PAGES, SAMPLE_CACHE_PAGE_SIZE,
+               (SAMPLE_CACHE_PAGES * SAMPLE_CACHE_PAGE_SIZE) / 1024);
+    audio_health_reset();
+    benchmark_cycles_init();
+    audio_player_reset_profile();
+    tremolo_init(AUDIO_OUTPUT_RATE);
+    i2s_output_set_block_callback(player_fill_ring);
+    tremolo_gain = TREMOLO_UNITY_Q15;
+    player_state = PLAYER_IDLE;
+    last_voice   = -1;
+    player_log("   Voces: %d (buffer %u bytes x2 por voz)\n",
+               AUDIO_MAX_VOICES, AUDIO_VOICE_BUFFER_SIZE);
+    return true;
+}
 
-    // Validar formato
-    if (fmt.audio_format != 1) {
-        printf("Formato no PCM (%u)\n", fmt.audio_format);
-        f_close(&audio_file);
-        file_open    = false;
-        player_state = PLAYER_ERROR;
+/**
+ * @brief Inicia una voz nueva para el archivo dado.
+ *
+ * @param path Ruta del archivo (clave del caché).
+ * @param known Formato ya conocido (del índice), o NULL para leer la cabecera.
+ * @param key Tecla que la inicia, o AUDIO_NO_KEY.
+ * @return true si pudo comenzar la reproducción.
+ */
+static bool voice_start(const char *path, const sample_format_t *known, uint8_t key) {
+    uint32_t t_start = time_us_32();
+
+    if (!sd_manager_is_ready()) {
+        player_log("SD no está lista\n");
         return false;
     }
 
-    if (fmt.bits_per_sample != 16) {
-        printf("Solo 16 bits soportados (archivo: %u bits)\n",
-               fmt.bits_per_sample);
-        f_close(&audio_file);
-        file_open    = false;
-        player_state = PLAYER_ERROR;
+    if (strlen(path) >= SAMPLE_CACHE_KEY_LEN) {
+        player_log("Ruta demasiado larga: %s\n", path);
         return false;
     }
 
-    if (fmt.num_channels != 1 && fmt.num_channels != 2) {
-        printf("Solo 1 o 2 canales (archivo: %u)\n", fmt.num_channels);
-        f_close(&audio_file);
-        file_open    = false;
-        player_state = PLAYER_ERROR;
+    sample_format_t fmt;
+    int  cache_id = sample_cache_lookup(path);
+    bool hit      = (cache_id >= 0);
+    bool opened   = false;
+
+    if (hit) {
+        fmt = *sample_cache_format(cache_id);
+        player_log("Cargando %s (en caché: %lu/%lu bytes)\n",
+                   path, sample_cache_valid_bytes(cache_id), fmt.total_bytes);
+    } else if (known) {
+        // Cabecera indexada: el archivo se abre ya posicionado en el audio
+        fmt = *known;
+        player_log("Cargando %s (cabecera indexada)\n", path);
+    } else {
+        player_log("Cargando %s\n", path);
+
+        FRESULT fr = f_open(&open_file, path, FA_READ);
+        if (fr != FR_OK) {
+            player_log("Error al abrir archivo: %d\n", fr);
+            return false;
+        }
+
+        if (!sample_index_read_header(&open_file, &fmt)) {
+            f_close(&open_file);
+            return false;
+        }
+        opened = true;
+
+        player_log("WAV válido: %lu Hz, %u canales, %u bits%s, %lu bytes (%.2f s)\n",
+                   fmt.sample_rate, fmt.channels, fmt.bits,
+                   (fmt.format == WAV_FORMAT_IMA_ADPCM) ? " IMA ADPCM" : "",
+                   fmt.total_bytes,
+                   (float)fmt.total_bytes * 8.0f /
+                   ((float)fmt.sample_rate * fmt.channels * fmt.bits));
+    }
+
+    // El I2S queda a AUDIO_OUTPUT_RATE; otras frecuencias se remuestrean
+    if (fmt.sample_rate == 0 ||
+        fmt.sample_rate > AUDIO_OUTPUT_RATE * AUDIO_MAX_RESAMPLE_RATIO) {
+        player_log("Sample rate no soportado: %lu Hz\n", fmt.sample_rate);
+        if (opened) f_close(&open_file);
         return false;
     }
 
-    // Buscar chunk 'data'
-    uint32_t data_size = 0;
-    if (!find_data_chunk(&audio_file, &data_size, &data_start_position)) {
-        printf(" No se encontró chunk 'data'\n");
-        f_close(&audio_file);
-        file_open    = false;
-        player_state = PLAYER_ERROR;
+    // Un bloque ADPCM nunca debe cruzar de un buffer (o página) al siguiente
+    if (fmt.format == WAV_FORMAT_IMA_ADPCM &&
+        AUDIO_VOICE_BUFFER_SIZE % fmt.block_align != 0) {
+        player_log("Bloque ADPCM de %u bytes no divide el buffer\n", fmt.block_align);
+        if (opened) f_close(&open_file);
         return false;
     }
 
-    printf("WAV válido:\n");
-    printf("   Sample rate: %lu Hz\n", fmt.sample_rate);
-    printf("   Canales:     %u\n", fmt.num_channels);
-    printf("   Bits:        %u\n", fmt.bits_per_sample);
-    printf("   Data size:   %lu bytes (%.2f KB)\n",
-           data_size, data_size / 1024.0f);
-    printf("   Duración:    %.2f s\n",
-           (float)data_size /
-           (fmt.sample_rate * fmt.num_channels * (fmt.bits_per_sample / 8)));
-
-    wav_sample_rate = fmt.sample_rate;
-    wav_channels    = fmt.num_channels;
-    wav_bits        = fmt.bits_per_sample;
-    total_bytes     = data_size;
-    bytes_played    = 0;
-    data_bytes_read = 0;
-
-    // Preparar buffers
-    current_buffer     = audio_buffer_0;
-    next_buffer        = audio_buffer_1;
-    buffer_position    = 0;
-    buffer_size        = 0;
-    next_buffer_size   = 0;
-    need_load_next_buf = false;
-
-    // Reconfigurar I2S al sample rate del archivo
-    i2s_output_stop();
-    if (!i2s_output_init(wav_sample_rate)) {
-        printf("Error al reinicializar I2S\n");
-        f_close(&audio_file);
-        file_open    = false;
-        player_state = PLAYER_ERROR;
+    // Solo con el archivo validado se toma (o se roba) una voz
+    int vi = voice_alloc();
+    if (vi < 0) {
+        player_log("Sin voz libre: el DMA aún lee los buffers de todas\n");
+        if (hit) sample_cache_release(cache_id);
+        if (opened) f_close(&open_file);
         return false;
     }
+    voice_t *v = &voices[vi];
+    strcpy(v->path, path);
+
+    if (opened) {
+        v->file      = open_file;
+        v->file_open = true;
+        v->linkmap   = NULL;
+        voice_attach_linkmap(v);
+    }
+    if (!hit) {
+        cache_id = sample_cache_reserve(path, &fmt, SAMPLE_CACHE_MAX_PAGES_PER_ENTRY);
+    }
+    v->cache_id = cache_id;
+    v->bank     = fmt.bank;
+
+    v->sample_rate     = fmt.sample_rate;
+    v->channels        = fmt.channels;
+    v->bits            = fmt.bits;
+    v->format          = fmt.format;
+    v->block_align     = fmt.block_align;
+    v->pcm_pos         = 0;
+    v->pcm_len         = 0;
+    v->data_offset     = fmt.data_offset;
+    v->linkmap         = fmt.linkmap;
+    v->total_bytes     = fmt.total_bytes;
+    v->bytes_played    = 0;
+    v->data_bytes_read = 0;
+    v->current         = 0;
+    v->buffer_position = 0;
+    v->level           = 0xFFFF;   // recién iniciada: no es candidata a robo
+    // Compensar la atenuación con que se guardó el audio (bancos pre-atenuados)
+    v->gain_q8         = (MIX_GAIN_UNITY_Q8 * MIX_GAIN_UNITY_Q8 + fmt.atten_q8 / 2) / fmt.atten_q8;
+    v->render          = mix_kernels_select(v->channels, v->gain_q8);
+    v->resample        = NULL;
+
+    if (fmt.sample_rate != AUDIO_OUTPUT_RATE) {
+        v->resample = mix_kernels_select_resampler(v->channels);
+        mix_resampler_init(&v->rs, fmt.sample_rate, AUDIO_OUTPUT_RATE);
+    }
 
-    // Cargar primer buffer
-    uint32_t bytes_to_read = (total_bytes > AUDIO_BUFFER_SIZE)
-                             ? AUDIO_BUFFER_SIZE
-                             : total_bytes;
-    if (bytes_to_read > 0) {
-        fr = f_read(&audio_file, current_buffer, bytes_to_read, &bytes_read);
-        if (fr != FR_OK || bytes_read == 0) {
-            printf("Error al leer datos (buffer 0)\n");
-            f_close(&audio_file);
-            file_open    = false;
-            player_state = PLAYER_ERROR;
-            return false;
-        }
-        buffer_size     = bytes_read;
-        buffer_position = 0;
-        data_bytes_read += bytes_read;
+    // Duración de un buffer lleno, para el plazo de las lecturas (en ADPCM
+    // se ignoran las cabeceras de bloque: el plazo queda algo holgado)
+    uint32_t buffer_frames = (AUDIO_VOICE_BUFFER_SIZE * 8u) / ((uint32_t)v->bits * v->channels);
+    v->buffer_us = (uint32_t)(((uint64_t)buffer_frames * 1000000u) / v->sample_rate);
+
+    // Lazo de sostenido solo para las notas tocadas con una tecla. El
+    // fundido se acorta si la mitad del lazo no da para tanto. Si antes del
+    // lazo no hay audio suficiente (lazo desde el principio del sample), el
+    // fundido termina en los primeros frames del lazo y la vuelta sigue
+    // tras ellos
+    uint32_t frame_bytes = (uint32_t)v->channels * 2u;
+    uint32_t xfade       = AUDIO_LOOP_XFADE_FRAMES;
+    v->loop_end        = 0;
+    v->loop_tail_ready = false;
+    if (key != AUDIO_NO_KEY && fmt.loop_end > 0) {
+        uint32_t half = (fmt.loop_end - fmt.loop_start) / frame_bytes / 2;
+        if (xfade > half) xfade = half;
+
+        v->loop_start  = fmt.loop_start;
+        v->loop_end    = fmt.loop_end;
+        v->loop_xfade  = xfade * frame_bytes;
+        v->loop_resume = (v->loop_start > v->loop_xfade) ? v->loop_start : v->loop_xfade;
+        player_log("Lazo de sostenido: bytes %lu-%lu (fundido de %lu frames)\n",
+                   (unsigned long)v->loop_start, (unsigned long)v->loop_end,
+                   (unsigned long)xfade);
     }
+    v->key         = key;
+    v->release_req = false;
+
+    // Cargar el primer buffer; el segundo solo si está en caché o el
+    // archivo (o su banco) ya está abierto, si no queda para audio_player_process()
+    v->next_buffer_size   = 0;
+    v->need_load_next_buf = false;
 
-    // Cargar segundo buffer
-    bytes_to_read = total_bytes - data_bytes_read;
-    if (bytes_to_read > AUDIO_BUFFER_SIZE) {
-        bytes_to_read = AUDIO_BUFFER_SIZE;
+    if (!voice_read_buffer(v, 0, &v->buffer_size)) {
+        player_log("Error al leer datos iniciales\n");
+        voice_release(v);
+        return false;
     }
 
-    if (bytes_to_read > 0) {
-        fr = f_read(&audio_file, next_buffer, bytes_to_read, &bytes_read);
-        if (fr != FR_OK) {
-            printf("Error al leer datos (buffer 1)\n");
-            f_close(&audio_file);
-            file_open    = false;
-            player_state = PLAYER_ERROR;
+    if (v->file_open || v->bank || voice_next_is_cached(v)) {
+        if (!voice_read_buffer(v, 1, &v->next_buffer_size)) {
+            player_log("Error al leer datos iniciales\n");
+            voice_release(v);
             return false;
         }
-        next_buffer_size = bytes_read;
-        data_bytes_read += bytes_read;
-    } else {
-        next_buffer_size = 0;
+    } else if (voice_has_more(v)) {
+        v->refill_due_us = time_us_32() +
+                           (uint32_t)(((uint64_t)v->buffer_us * v->buffer_size) /
+                                      AUDIO_VOICE_BUFFER_SIZE);
+        v->need_load_next_buf = true;
     }
 
-    need_load_next_buf = false;
-    player_state       = PLAYER_PLAYING;
+    v->start_seq     = next_start_seq++;
+    v->start_us      = t_start;
+    v->start_pending = true;
+    v->env_stage     = ENV_ATTACK;
+    v->env_level     = 0;
+
+    // Publicar la voz a la IRQ de mezcla solo con todo su estado escrito
+    latency_probe_mark(LATENCY_VOICE);
+    __dmb();
+    v->active    = true;
+    last_voice   = vi;
 
-    printf("Reproduciendo. (%lu bytes)\n", total_bytes);
+    if (player_state != PLAYER_PAUSED) {
+        player_state = PLAYER_PLAYING;
+    }
+
+    player_log("Reproduciendo en la voz %d. (%lu bytes, %u voces activas)\n",
+               vi, v->total_bytes, voices_active_count());
     return true;
 }
 
+bool audio_player_play(const char *filename) {
+    return voice_start(filename, NULL, AUDIO_NO_KEY);
+}
+
+bool audio_player_play_note(uint8_t inst, char variant, uint8_t note) {
+    char path[SAMPLE_CACHE_KEY_LEN];
+    if (!sample_index_path(path, sizeof(path), inst, variant, note)) {
+        return false;
+    }
+
+    const sample_format_t *fmt = sample_index_get(inst, variant, note);
+    if (!fmt) {
+        player_log("Sin cabecera válida para %s\n", path);
+        return false;
+    }
+
+    return voice_start(path, fmt, note);
+}
+
+bool audio_player_release_note(uint8_t note) {
+    bool found = false;
+
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        voice_t *v = &voices[i];
+        if (v->active && v->key == note && !v->release_req) {
+            v->release_req = true;
+            found = true;
+        }
+    }
+    return found;
+}
+
 void audio_player_stop() {
     if (player_state != PLAYER_PLAYING && player_state != PLAYER_PAUSED) {
         return;
     }
 
-    if (file_open) {
-        f_close(&audio_file);
-        file_open = false;
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        if (voices[i].active) voice_release(&voices[i]);
     }
 
-    player_state    = PLAYER_IDLE;
-    bytes_played    = 0;
-    buffer_position = 0;
-    buffer_size     = 0;
-    next_buffer_size = 0;
+    player_state = PLAYER_IDLE;
 
-    printf("Reproducción detenida\n");
+    player_log("Reproducción detenida\n");
 }
 
 void audio_player_pause() {
     if (player_state == PLAYER_PLAYING) {
         player_state = PLAYER_PAUSED;
-        printf("Pausado\n");
+        player_log("Pausado\n");
     }
 }
 
 void audio_player_resume() {
     if (player_state == PLAYER_PAUSED) {
         player_state = PLAYER_PLAYING;
-        printf("Reanudado\n");
+        player_log("Reanudado\n");
     }
 }
 
-void audio_player_process() {
-    if (player_state != PLAYER_PLAYING) {
-        return;
+/**
+ * @brief Atiende la petición de lectura más urgente.
+ *
+ * Elige, entre las voces que esperan su buffer siguiente, la de plazo más
+ * próximo (las que el DMA aún lee sin copia esperan a que las suelte). La
+ * lectura bloquea solo este contexto: la IRQ sigue mezclando mientras tanto.
+ *
+ * @return true si quedan peticiones que se pueden atender ya.
+ */
+static bool player_service_reads(void) {
+    voice_t *next    = NULL;
+    int      pending = 0;
+
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        voice_t *v = &voices[i];
+        if (!v->active || !v->need_load_next_buf) continue;
+        if (voice_buffer_busy(v, v->current ^ 1)) continue;
+
+        pending++;
+        if (!next || (int32_t)(v->refill_due_us - next->refill_due_us) < 0) {
+            next = v;
+        }
     }
-
-    if (bytes_played >= total_bytes) {
-        audio_player_stop();
-        printf("Reproducción completada (%lu/%lu bytes)\n",
-               bytes_played, total_bytes);
-        return;
+    if (!next) {
+        return false;
     }
 
-    if (!i2s_output_can_send()) {
-        return;
+    uint32_t size;
+    if (!voice_read_buffer(next, next->current ^ 1, &size)) {
+        player_log("Error al recargar buffer desde SD (voz %d)\n", (int)(next - voices));
+        voice_release(next);
+        return pending > 1;
     }
 
-    // Se acabó el buffer?
-    if (buffer_position >= buffer_size) {
-        if (next_buffer_size == 0) {
-            audio_player_stop();
-            printf("Reproducción completada (%lu/%lu bytes)\n",
-                   bytes_played, total_bytes);
-            return;
-        }
+    // Publicar el buffer antes de retirar la petición
+    next->next_buffer_size = size;
+    __dmb();
+    next->need_load_next_buf = false;
+    return pending > 1;
+}
 
-        // Intercambiar buffers
-        uint8_t *tmp = current_buffer;
-        current_buffer   = next_buffer;
-        next_buffer      = tmp;
-        buffer_size      = next_buffer_size;
-        buffer_position  = 0;
-        need_load_next_buf = true;
-    }
-
-    // Cargar próximo buffer desde SD si hace falta
-    if (need_load_next_buf) {
-        UINT bytes_read;
-        uint32_t bytes_left = (total_bytes > data_bytes_read)
-                              ? (total_bytes - data_bytes_read)
-                              : 0;
-
-        uint32_t bytes_to_read = (bytes_left > AUDIO_BUFFER_SIZE)
-                                 ? AUDIO_BUFFER_SIZE
-                                 : bytes_left;
-
-        if (bytes_to_read > 0) {
-            FRESULT fr = f_read(&audio_file, next_buffer, bytes_to_read, &bytes_read);
-            if (fr != FR_OK) {
-                printf("Error al recargar buffer desde SD\n");
-                audio_player_stop();
-                return;
-            }
-            next_buffer_size = bytes_read;
-            data_bytes_read += bytes_read;
-        } else {
-            next_buffer_size = 0;
+/**
+ * @brief Trabajo de audio_player_process(), sin la medición.
+ */
+static bool player_process(void) {
+    // Cerrar las voces que terminó la IRQ y soltar el caché de las
+    // liberadas cuando el DMA ya no las lee
+    for (int i = 0; i < AUDIO_MAX_VOICES; i++) {
+        voice_t *v = &voices[i];
+        if (v->active) continue;
+        if (v->file_open) {
+            voice_release(v);
+        }
+        if (v->cache_id >= 0 && !voice_buffer_busy(v, 0) && !voice_buffer_busy(v, 1)) {
+            voice_drop_cache(v);
         }
+    }
+
+    if (player_state != PLAYER_PLAYING) {
+        return false;
+    }
 
-        need_load_next_buf = false;
+    if (voices_active_count() == 0) {
+        player_state = PLAYER_IDLE;
+        player_log("Reproducción completada\n");
+        return false;
     }
 
-    if (wav_bits == 16) {
-        int16_t left  = 0;
-        int16_t right = 0;
+    return player_service_reads();
+}
+
+bool audio_player_process() {
+    uint32_t i0 = irq_cycles;
+    uint32_t c0 = benchmark_cycles();
+    bool     pending = player_process();
+    uint32_t c1 = benchmark_cycles();
 
-        if (wav_channels == 2) {
-            if (buffer_position + 4 > buffer_size) {
-                return;
-            }
+    benchmark_stat_add(&profile.process, benchmark_elapsed(c0, c1) - (irq_cycles - i0), 1);
+    return pending;
+}
 
-            left  = (int16_t)( current_buffer[buffer_position] |
-                              (current_buffer[buffer_position + 1] << 8));
-            right = (int16_t)( current_buffer[buffer_position + 2] |
-                              (current_buffer[buffer_position + 3] << 8));
+// Precarga
 
-            buffer_position += 4;
-            bytes_played    += 4;
-        } else if (wav_channels == 1) {
-            if (buffer_position + 2 > buffer_size) {
-                return;
+/**
+ * @brief Cierra el archivo suelto usado por la precarga.
+ */
+static void prefetch_close(void) {
+    if (prefetch_open) {
+        f_close(&prefetch_file);
+        prefetch_open = false;
+    }
+}
+
+/**
+ * @brief Lee desde la SD la página del caché que sigue al prefijo válido.
+ */
+static bool prefetch_read_page(const char *path, const sample_format_t *fmt,
+                               int id, uint32_t offset) {
+    FIL *fp = fmt->bank;
+
+    if (!fp) {
+        if (!prefetch_open) {
+            if (f_open(&prefetch_file, path, FA_READ) != FR_OK) {
+                return false;
+            }
+            prefetch_open = true;
+            if (fmt->linkmap) {
+                prefetch_file.cltbl = fmt->linkmap;
             }
+        }
+        fp = &prefetch_file;
+    }
 
-            left = (int16_t)( current_buffer[buffer_position] |
-                             (current_buffer[buffer_position + 1] << 8));
-            right = left;
+    // Hasta el final de la página (el prefijo puede acabar a mitad de una)
+    uint32_t size = fmt->total_bytes - offset;
+    if (size > SAMPLE_CACHE_PAGE_SIZE - offset % SAMPLE_CACHE_PAGE_SIZE) {
+        size = SAMPLE_CACHE_PAGE_SIZE - offset % SAMPLE_CACHE_PAGE_SIZE;
+    }
 
-            buffer_position += 2;
-            bytes_played    += 2;
-        } else {
-            return;
+    UINT bytes_read;
+    if (f_lseek(fp, fmt->data_offset + offset) != FR_OK) {
+        return false;
+    }
+    uint32_t t0 = time_us_32();
+    if (f_read(fp, sample_cache_page(id, offset), size, &bytes_read) != FR_OK) {
+        return false;
+    }
+    audio_health_read(time_us_32() - t0, false);
+
+    sample_cache_commit(id, offset, bytes_read);
+    prefetch_pages++;
+    return bytes_read > 0;
+}
+
+bool audio_player_prefetch_step(uint8_t inst, uint8_t *cursor) {
+    while (*cursor < SAMPLE_INDEX_NOTES) {
+        char path[SAMPLE_CACHE_KEY_LEN];
+        const sample_format_t *fmt = NULL;
+
+        if (sample_index_path(path, sizeof(path), inst, AUDIO_PREFETCH_VARIANT, *cursor)) {
+            fmt = sample_index_get(inst, AUDIO_PREFETCH_VARIANT, *cursor);
+        }
+        if (!fmt) {
+            (*cursor)++;
+            continue;
+        }
+
+        int id = sample_cache_find(path);
+        if (id < 0) {
+            id = sample_cache_reserve(path, fmt, AUDIO_PREFETCH_PAGES);
+        }
+        if (id < 0) {
+            // Caché lleno de entradas en uso: no insistir
+            prefetch_close();
+            return false;
         }
 
+        uint32_t target = AUDIO_PREFETCH_PAGES * SAMPLE_CACHE_PAGE_SIZE;
+        uint32_t cap    = sample_cache_capacity(id);
+        uint32_t valid  = sample_cache_valid_bytes(id);
+        if (target > cap) {
+            target = cap;
+        }
 
-        // APLICAR VOLUMEN
+        if (valid >= target) {
+            // Nota lista
+            sample_cache_release(id);
+            prefetch_close();
+            (*cursor)++;
+            continue;
+        }
 
-        if (AUDIO_VOLUME_SHIFT > 0) {
-            left  = (int16_t)( ((int32_t)left)  >> AUDIO_VOLUME_SHIFT );
-            right = (int16_t)( ((int32_t)right) >> AUDIO_VOLUME_SHIFT );
+        bool ok = prefetch_read_page(path, fmt, id, valid);
+        sample_cache_release(id);
+        if (!ok) {
+            prefetch_close();
+            (*cursor)++;
         }
+        return *cursor < SAMPLE_INDEX_NOTES;
+    }
 
-        i2s_output_send_frame(left, right);
+    prefetch_close();
+    return false;
+}
+
+void audio_player_prefetch_cancel(void) {
+    prefetch_close();
+}
+
+void audio_player_set_gain(uint16_t gain_q8) {
+    // Límite para que acumulador * ganancia no desborde 32 bits
+    if (gain_q8 > AUDIO_MAX_GAIN_Q8) {
+        gain_q8 = AUDIO_MAX_GAIN_Q8;
     }
+    master_gain_q8 = gain_q8;
+}
+
+void audio_player_set_tremolo(uint16_t rate_chz, uint16_t depth_q15) {
+    tremolo_set(rate_chz, depth_q15);
 }
 
 player_info_t audio_player_get_info() {
+    const voice_t *v = (last_voice >= 0) ? &voices[last_voice] : NULL;
+
+    uint32_t sample_rate  = i2s_output_get_info().sample_rate;
+    uint32_t mix_us_avg   = mix_us_avg_q4 >> 4;
+    uint32_t block_us     = (sample_rate > 0)
+                            ? (I2S_BLOCK_FRAMES * 1000000u) / sample_rate
+                            : 0;
+
     player_info_t info = {
         .state            = player_state,
-        .bytes_played     = bytes_played,
-        .total_bytes      = total_bytes,
-        .sample_rate      = wav_sample_rate,
-        .num_channels     = wav_channels,
-        .bits_per_sample  = wav_bits,
-        .progress_percent = (total_bytes > 0)
-                            ? ((float)bytes_played / (float)total_bytes * 100.0f)
+        .bytes_played     = v ? v->bytes_played : 0,
+        .total_bytes      = v ? v->total_bytes  : 0,
+        .sample_rate      = v ? v->sample_rate  : 0,
+        .num_channels     = v ? v->channels     : 0,
+        .bits_per_sample  = v ? v->bits         : 0,
+        .progress_percent = (v && v->total_bytes > 0)
+                            ? ((float)v->bytes_played / (float)v->total_bytes * 100.0f)
+                            : 0.0f,
+        .active_voices    = voices_active_count(),
+        .voices_stolen    = voices_stolen,
+        .mix_us_avg       = mix_us_avg,
+        .mix_us_max       = mix_us_max,
+        .decode_us_avg    = decode_us_avg_q4 >> 4,
+        .prefetch_pages   = prefetch_pages,
+        .mix_load_percent = (block_us > 0)
+                            ? ((float)mix_us_avg * 100.0f / (float)block_us)
                             : 0.0f
     };
     return info;
@@ -490,3 +1564,16 @@ player_info_t audio_player_get_info() {
 bool audio_player_is_playing() {
     return player_state == PLAYER_PLAYING;
 }
+
+player_profile_t audio_player_get_profile(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    player_profile_t copy = profile;
+    restore_interrupts(irq);
+    return copy;
+}
+
+void audio_player_reset_profile(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    memset(&profile, 0, sizeof(profile));
+    restore_interrupts(irq);
+}
@@ -1,6 +1,6 @@
 /**
  * @file audio_player.h
- * @brief Módulo de reproducción de audio WAV usando doble buffer e I2S.
+ * @brief Módulo de reproducción de audio WAV polifónico usando I2S.
  * @authors 
  *  - Mauricio Reyes Rosero
  *  - Reinaldo Marín Nieto
@@ -13,9 +13,60 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include "benchmark.h"
 
-/** Tamaño de cada buffer de audio (8 KB). */
-#define AUDIO_BUFFER_SIZE 8192
+/** Número máximo de voces simultáneas. */
+#define AUDIO_MAX_VOICES 6
+
+/** Frecuencia fija de salida I2S; las voces se remuestrean a ella. */
+#define AUDIO_OUTPUT_RATE 44100
+
+/** Relación máxima entre la frecuencia de un sample y la de salida. */
+#define AUDIO_MAX_RESAMPLE_RATIO 4
+
+/** Tamaño de cada uno de los dos buffers de una voz (2 KB). */
+#define AUDIO_VOICE_BUFFER_SIZE 2048
+
+/** Páginas del caché precargadas por nota al cambiar de instrumento (ataque, 4 KB). */
+#define AUDIO_PREFETCH_PAGES 2
+
+/** Variante que se precarga (la que tocan los botones). */
+#define AUDIO_PREFETCH_VARIANT 'a'
+
+/** Frames ADPCM decodificados por tramo (múltiplo de 8). */
+#define AUDIO_ADPCM_CHUNK_FRAMES 64
+
+/** Ganancia maestra por defecto en Q8 (32/256 = 1/8, atenúa la suma de voces). */
+#define AUDIO_DEFAULT_GAIN_Q8   32
+
+/** Ganancia maestra máxima en Q8 (4.0). */
+#define AUDIO_MAX_GAIN_Q8       1024
+
+/** Mensajes del reproductor pendientes de imprimir (potencia de 2). */
+#define AUDIO_LOG_LINES         16
+
+/** Longitud máxima de un mensaje del reproductor, con el '\0'. */
+#define AUDIO_LOG_LINE_LEN      96
+
+/** Envolvente ADSR de cada nota: ataque desde silencio (ms). */
+#define AUDIO_ENV_ATTACK_MS     1
+
+/** Envolvente ADSR: caída desde el máximo hasta el sostenido (ms). */
+#define AUDIO_ENV_DECAY_MS      80
+
+/** Envolvente ADSR: nivel de sostenido en Q15 (32768 = 1.0, la nota
+ *  conserva la envolvente grabada en el sample). */
+#define AUDIO_ENV_SUSTAIN_Q15   32768
+
+/** Envolvente ADSR: release tras soltar el botón, desde el máximo (ms). */
+#define AUDIO_ENV_RELEASE_MS    150
+
+/** Fundido al final del lazo de sostenido de un sample (frames, ~6 ms). */
+#define AUDIO_LOOP_XFADE_FRAMES 256
+
+/** Tecla de las voces que no salen de un botón (audio_player_play). */
+#define AUDIO_NO_KEY            0xFF
 
 /**
  * @brief Estados posibles del reproductor de audio.
@@ -30,6 +81,9 @@ typedef enum {
 
 /**
  * @brief Estructura con información del reproductor.
+ *
+ * Los campos de archivo (bytes, formato, progreso) corresponden a la
+ * última voz iniciada; los de mezcla, al motor completo.
  */
 typedef struct {
     player_state_t state;      /**< Estado actual del reproductor. */
@@ -37,25 +91,83 @@ typedef struct {
     uint32_t total_bytes;      /**< Tamaño total del audio. */
     uint32_t sample_rate;      /**< Frecuencia de muestreo del archivo WAV. */
     uint16_t num_channels;     /**< Número de canales (1 o 2). */
-    uint16_t bits_per_sample;  /**< Resolución en bits (solo 16). */
+    uint16_t bits_per_sample;  /**< Resolución en bits (16 PCM, 4 ADPCM). */
     float progress_percent;    /**< Porcentaje de progreso. */
+    uint8_t  active_voices;    /**< Voces sonando en este momento. */
+    uint32_t voices_stolen;    /**< Voces robadas por falta de voces libres. */
+    uint32_t mix_us_avg;       /**< Tiempo medio de mezcla por bloque I2S (us). */
+    uint32_t mix_us_max;       /**< Tiempo máximo de mezcla por bloque I2S (us). */
+    uint32_t decode_us_avg;    /**< Parte media de la mezcla dedicada a decodificar ADPCM (us). */
+    uint32_t prefetch_pages;   /**< Páginas cargadas en segundo plano por la precarga. */
+    float mix_load_percent;    /**< Costo medio de mezcla respecto a la duración del bloque. */
 } player_info_t;
 
+/**
+ * @brief Perfil en ciclos del reproductor, medido en core1 (siempre activo).
+ *
+ * Las mediciones del bucle de core1 descuentan las IRQ de mezcla que las
+ * interrumpen, así que cada caso cuenta solo su propio trabajo.
+ */
+typedef struct {
+    benchmark_stat_t process;  /**< audio_player_process(), por llamada. */
+    benchmark_stat_t read;     /**< Lecturas de la SD de las voces (f_read), por KB. */
+    benchmark_stat_t mix;      /**< Bloques producidos en la IRQ del I2S, por frame. */
+} player_profile_t;
+
 /**
  * @brief Inicializa el reproductor y su estado interno.
+ *
+ * Registra la mezcla como callback de bloque del I2S: debe llamarse en el
+ * núcleo que inicializó i2s_output, después de i2s_output_init().
+ *
  * @return true si la inicialización fue exitosa.
  */
 bool audio_player_init();
 
 /**
- * @brief Inicia la reproducción de un archivo WAV desde la SD.
+ * @brief Inicia la reproducción de un archivo WAV desde la SD en una voz nueva.
+ *
+ * Las voces que ya suenan continúan; si no hay voces libres se roba la
+ * más silenciosa (a igualdad, la más antigua). Si el archivo no está a
+ * AUDIO_OUTPUT_RATE, la voz se remuestrea; el I2S nunca se reconfigura.
+ *
  * @param filename Nombre del archivo en la tarjeta SD.
  * @return true si pudo comenzar la reproducción.
  */
 bool audio_player_play(const char *filename);
 
 /**
- * @brief Detiene la reproducción actual.
+ * @brief Inicia una nota de un instrumento usando el índice de cabeceras.
+ *
+ * No analiza la cabecera WAV: salta directamente al audio con los datos
+ * guardados en sample_index.
+ *
+ * La voz queda asociada a la tecla @p note hasta que
+ * audio_player_release_note() la pase a su fase de release. Si el sample
+ * tiene lazo de sostenido (chunk "smpl" o banco), mientras tanto se repite
+ * ese tramo, con un fundido de AUDIO_LOOP_XFADE_FRAMES en el punto de
+ * vuelta; al soltar, el audio sigue desde donde iba hasta el final.
+ *
+ * @param inst Índice del instrumento en la tabla de instrumentos.
+ * @param variant Variante de sonido ('a' o 'b').
+ * @param note Índice de nota 0..6 (do..si).
+ * @return true si pudo comenzar la reproducción.
+ */
+bool audio_player_play_note(uint8_t inst, char variant, uint8_t note);
+
+/**
+ * @brief Suelta la tecla @p note: sus voces pasan a la fase de release.
+ *
+ * Cuando la envolvente llega a cero la IRQ de mezcla desactiva la voz y
+ * audio_player_process() cierra su archivo y suelta su caché, aunque el
+ * sample no haya terminado.
+ *
+ * @return true si alguna voz sonaba con esa tecla.
+ */
+bool audio_player_release_note(uint8_t note);
+
+/**
+ * @brief Detiene todas las voces.
  */
 void audio_player_stop();
 
@@ -69,6 +181,42 @@ void audio_player_pause();
  */
 void audio_player_resume();
 
+/**
+ * @brief Ajusta la ganancia maestra aplicada a la mezcla.
+ * @param gain_q8 Ganancia en Q8 (256 = 1.0), limitada a AUDIO_MAX_GAIN_Q8.
+ */
+void audio_player_set_gain(uint16_t gain_q8);
+
+/**
+ * @brief Fija frecuencia y profundidad del tremolo aplicado a la mezcla.
+ *
+ * Los valores se alcanzan de forma suave bloque a bloque, también sobre
+ * las notas que ya están sonando.
+ *
+ * @param rate_chz Frecuencia del LFO en centésimas de Hz.
+ * @param depth_q15 Profundidad en Q15 (0 desactiva el efecto).
+ */
+void audio_player_set_tremolo(uint16_t rate_chz, uint16_t depth_q15);
+
+/**
+ * @brief Precarga en el caché un tramo del ataque de las notas de un instrumento.
+ *
+ * Cada llamada hace como mucho una lectura de una página del caché, de modo
+ * que puede intercalarse con la mezcla en los tiempos libres del audio.
+ * Recorre las notas de la variante AUDIO_PREFETCH_VARIANT hasta dejar
+ * AUDIO_PREFETCH_PAGES páginas de cada una en el caché.
+ *
+ * @param inst Índice en la tabla de instrumentos.
+ * @param cursor Nota en curso; se avanza al completar cada nota (empezar en 0).
+ * @return true si queda trabajo pendiente para este instrumento.
+ */
+bool audio_player_prefetch_step(uint8_t inst, uint8_t *cursor);
+
+/**
+ * @brief Abandona la precarga en curso y cierra su archivo si lo tenía abierto.
+ */
+void audio_player_prefetch_cancel(void);
+
 /**
  * @brief Obtiene la información actual del reproductor.
  * @return player_info_t con datos del estado.
@@ -82,9 +230,45 @@ player_info_t audio_player_get_info();
 bool audio_player_is_playing();
 
 /**
- * @brief Proceso continuo que se debe llamar frecuentemente
- * para enviar frames al I2S y realizar gestión de buffers.
+ * @brief Copia del perfil en ciclos (llamar en core1).
+ */
+player_profile_t audio_player_get_profile(void);
+
+/**
+ * @brief Pone a cero el perfil en ciclos (llamar en core1).
+ */
+void audio_player_reset_profile(void);
+
+/**
+ * @brief Tarea de fondo que atiende las lecturas de la SD de las voces.
+ *
+ * La mezcla corre en la IRQ del I2S y solo pide buffers; cada llamada
+ * hace como mucho una lectura, la de plazo más próximo, y cierra las voces
+ * terminadas. Las lecturas que llegan tarde se cuentan en audio_health.
+ *
+ * @return true si quedan lecturas pendientes que se pueden atender ya.
+ */
+bool audio_player_process();
+
+/**
+ * @brief Extrae el siguiente mensaje del reproductor.
+ *
+ * El reproductor no imprime: corre en core1 y sus mensajes (nota cargada,
+ * errores de lectura, cambios de estado) quedan en un anillo que vacía
+ * otro núcleo.
+ *
+ * @param line Buffer de AUDIO_LOG_LINE_LEN bytes.
+ * @return true si había un mensaje.
+ */
+bool audio_player_pop_log(char *line);
+
+/**
+ * @brief Deja un mensaje en el anillo de mensajes del reproductor (se
+ *        descarta si está lleno).
+ *
+ * Los demás módulos que corren en core1 (I2S, índice de samples) la
+ * registran como su destino de mensajes.
  */
-void audio_player_process();
+void audio_player_vlog(const char *format, va_list args);
 
 #endif // AUDIO_PLAYER_H
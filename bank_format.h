@@ -0,0 +1,111 @@
+/**
+ * @file bank_format.h
+ * @brief Formato en disco de los bancos de instrumento ("0:/i<id>.bnk").
+ *
+ * Un banco reúne en un solo archivo las 14 notas (7 notas x variantes
+ * 'a'/'b') de un instrumento:
+ *  - Sector 0: cabecera con la tabla de notas.
+ *  - Desde el sector 1: el audio de cada nota (contenido del chunk "data"
+ *    del WAV original), contiguo y empezando en un límite de sector.
+ *
+ * Todos los campos son little-endian y se leen/escriben byte a byte, de
+ * modo que el formato no depende del empaquetado de estructuras ni del
+ * compilador. Lo comparten el firmware (sample_index.c) y el empaquetador
+ * de PC (tools/bank_packer.c).
+ *
+ * Cabecera (BANK_HEADER_SIZE bytes):
+ *  | Offset | Tamaño | Campo                                  |
+ *  |--------|--------|----------------------------------------|
+ *  | 0      | 4      | "HBNK"                                 |
+ *  | 4      | 2      | Versión (BANK_VERSION)                 |
+ *  | 6      | 2      | Entradas (BANK_ENTRIES)                |
+ *  | 8      | 8      | Reservado (0)                          |
+ *  | 16     | 32 x N | Entradas, índice = variante * 7 + nota |
+ *
+ * Entrada (BANK_ENTRY_SIZE bytes):
+ *  | Offset | Tamaño | Campo                                        |
+ *  |--------|--------|----------------------------------------------|
+ *  | 0      | 4      | Offset del audio en el banco (0 = no existe) |
+ *  | 4      | 4      | Bytes de audio                               |
+ *  | 8      | 4      | Sample rate                                  |
+ *  | 12     | 2      | Canales                                      |
+ *  | 14     | 2      | Bits por muestra                             |
+ *  | 16     | 2      | Formato WAV (1 = PCM, 0x11 = IMA ADPCM)      |
+ *  | 18     | 2      | Block align                                  |
+ *  | 20     | 2      | Atenuación aplicada al audio, Q8 (0 = no)    |
+ *  | 22     | 2      | Reservado (0)                                |
+ *  | 24     | 4      | Inicio del lazo de sostenido (bytes)         |
+ *  | 28     | 4      | Fin del lazo, excluido (0 = sin lazo)        |
+ *
+ * El lazo sale del chunk "smpl" del WAV original (primer lazo, pasado de
+ * frames a bytes). Los bancos de la versión 1 tienen entradas de 24 bytes,
+ * sin los campos del lazo, y se siguen aceptando.
+ *
+ * Una entrada PCM puede guardarse ya atenuada (el empaquetador multiplica
+ * las muestras por la atenuación): el firmware compensa con la ganancia de
+ * la voz, y con la ganancia efectiva en 1.0 una nota sola va del buffer de
+ * la SD al I2S sin pasar por la CPU.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef BANK_FORMAT_H
+#define BANK_FORMAT_H
+
+/** Firma al inicio del banco. */
+#define BANK_MAGIC        "HBNK"
+
+/** Versión del formato. */
+#define BANK_VERSION      2
+
+/** Versión anterior, sin lazo de sostenido (entradas de BANK_ENTRY_SIZE_V1). */
+#define BANK_VERSION_V1   1
+
+/** Alineación del audio de cada nota (un sector de la SD). */
+#define BANK_SECTOR       512
+
+/** Tamaño de la cabecera (un sector). */
+#define BANK_HEADER_SIZE  512
+
+/** Notas por variante. */
+#define BANK_NOTES        7
+
+/** Variantes por nota ('a' y 'b'). */
+#define BANK_VARIANTS     2
+
+/** Entradas de la tabla. */
+#define BANK_ENTRIES      (BANK_NOTES * BANK_VARIANTS)
+
+/** Offset de la primera entrada dentro de la cabecera. */
+#define BANK_TABLE_OFFSET 16
+
+/** Tamaño de una entrada. */
+#define BANK_ENTRY_SIZE   32
+
+/** Tamaño de una entrada en la versión 1. */
+#define BANK_ENTRY_SIZE_V1  24
+
+// Campos de una entrada
+#define BANK_E_OFFSET       0
+#define BANK_E_LENGTH       4
+#define BANK_E_SAMPLE_RATE  8
+#define BANK_E_CHANNELS     12
+#define BANK_E_BITS         14
+#define BANK_E_FORMAT       16
+#define BANK_E_BLOCK_ALIGN  18
+#define BANK_E_ATTEN        20
+#define BANK_E_LOOP_START   24
+#define BANK_E_LOOP_END     28
+
+/** Atenuación mínima admitida en Q8 (1/16): acota la ganancia de compensación. */
+#define BANK_MIN_ATTEN_Q8   16
+
+#if BANK_TABLE_OFFSET + BANK_ENTRIES * BANK_ENTRY_SIZE > BANK_HEADER_SIZE
+#error "La tabla del banco no cabe en la cabecera"
+#endif
+
+#endif // BANK_FORMAT_H
@@ -0,0 +1,206 @@
+/**
+ * @file benchmark.c
+ * @brief Casos de medición de los caminos críticos y salida CSV.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "benchmark.h"
+#include "audio_engine.h"
+#include "mix_kernels.h"
+#include "mpu6050.h"
+#include "imu_fusion.h"
+#include "LCD.h"
+#include "sistema.h"
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+#include <math.h>
+
+/** Lecturas del MPU6050 medidas. */
+#define BENCH_IMU_READS     32
+
+/** Llamadas medidas a calc_pitch() y calc_roll(). */
+#define BENCH_ANGLE_CALLS   256
+
+/** Muestras medidas de la fusión de orientación (un cuarto de segundo a 1 kHz). */
+#define BENCH_FUSION_SAMPLES 256
+
+/** Actualizaciones de la LCD medidas (cada una tarda decenas de ms). */
+#define BENCH_LCD_UPDATES   4
+
+/** Separación entre las notas de la carga del motor de audio (ms). */
+#define BENCH_NOTE_GAP_MS   100
+
+/** Duración total de la carga del motor de audio (ms). */
+#define BENCH_ENGINE_MS     1500
+
+/** Evita que el compilador descarte los resultados medidos. */
+static volatile float bench_sink;
+
+/**
+ * @brief Lectura cruda del MPU6050 por I2C.
+ */
+static void bench_imu(void) {
+    benchmark_stat_t s = {0};
+
+    for (uint32_t i = 0; i < BENCH_IMU_READS; i++) {
+        mpu6050_raw_t raw;
+        uint32_t t0 = benchmark_cycles();
+        mpu6050_read_raw(&raw);
+        benchmark_stat_add(&s, benchmark_elapsed(t0, benchmark_cycles()), 1);
+        bench_sink = (float)raw.az;
+    }
+    benchmark_report("mpu6050_read_raw", "llamada", &s);
+}
+
+/**
+ * @brief calc_pitch() y calc_roll() sobre un barrido de orientaciones.
+ *
+ * Se miden con las interrupciones deshabilitadas: son cómputo puro y su
+ * costo depende solo de la coma flotante por software.
+ */
+static void bench_angles(void) {
+    benchmark_stat_t pitch = {0};
+    benchmark_stat_t roll  = {0};
+
+    for (uint32_t i = 0; i < BENCH_ANGLE_CALLS; i++) {
+        // Vector de gravedad que recorre los cuatro cuadrantes
+        float ax = mpu6050_calc_g((int16_t)((int32_t)i * 128 - 16384));
+        float ay = mpu6050_calc_g((int16_t)(16384 - (int32_t)i * 97));
+        float az = mpu6050_calc_g((int16_t)((int32_t)(i & 63) * 512 - 8192));
+
+        uint32_t irq = save_and_disable_interrupts();
+        uint32_t t0  = benchmark_cycles();
+        float    p   = calc_pitch(ax, ay, az);
+        uint32_t t1  = benchmark_cycles();
+        float    r   = calc_roll(ay, az);
+        uint32_t t2  = benchmark_cycles();
+        restore_interrupts(irq);
+
+        benchmark_stat_add(&pitch, benchmark_elapsed(t0, t1), 1);
+        benchmark_stat_add(&roll,  benchmark_elapsed(t1, t2), 1);
+        bench_sink = p + r;
+    }
+    benchmark_report("calc_pitch", "llamada", &pitch);
+    benchmark_report("calc_roll",  "llamada", &roll);
+}
+
+/**
+ * @brief imu_fusion_update() por muestra e imu_fusion_euler() por llamada.
+ *
+ * La gravedad da una vuelta en el plano Y-Z a 1 g con el giroscopio
+ * acompañando: la primera mitad quieta (ganancia de quieto), la segunda
+ * con 100 °/s extra en Z (ganancia de movimiento). Las entradas se
+ * generan fuera de la medición.
+ */
+static void bench_fusion(void) {
+    benchmark_stat_t update = {0};
+    benchmark_stat_t euler  = {0};
+    imu_fusion_t     f;
+
+    imu_fusion_init(&f);
+    for (uint32_t i = 0; i < BENCH_FUSION_SAMPLES; i++) {
+        float a = 6.2831853f * (float)i / BENCH_FUSION_SAMPLES;
+        mpu6050_raw_t raw = {
+            .ax = 200,
+            .ay = (int16_t)(16384.0f * sinf(a)),
+            .az = (int16_t)(16384.0f * cosf(a)),
+            .gx = 3,
+            .gy = -5,
+            .gz = (int16_t)(i < BENCH_FUSION_SAMPLES / 2 ? 2 : 13100),
+        };
+
+        uint32_t irq = save_and_disable_interrupts();
+        uint32_t t0  = benchmark_cycles();
+        imu_fusion_update(&f, &raw);
+        uint32_t t1  = benchmark_cycles();
+        imu_euler_t e = imu_fusion_euler(&f);
+        uint32_t t2  = benchmark_cycles();
+        restore_interrupts(irq);
+
+        benchmark_stat_add(&update, benchmark_elapsed(t0, t1), 1);
+        benchmark_stat_add(&euler,  benchmark_elapsed(t1, t2), 1);
+        bench_sink = (float)(e.pitch + e.roll + e.yaw);
+    }
+    benchmark_report("imu_fusion_update", "muestra", &update);
+    benchmark_report("imu_fusion_euler",  "llamada", &euler);
+}
+
+/**
+ * @brief Redibujo completo de la LCD (borrado y dos líneas por I2C).
+ */
+static void bench_lcd(void) {
+    benchmark_stat_t s = {0};
+
+    for (uint32_t i = 0; i < BENCH_LCD_UPDATES; i++) {
+        uint32_t t0 = benchmark_cycles();
+        lcd_mostrar_estado();
+        benchmark_stat_add(&s, benchmark_elapsed(t0, benchmark_cycles()), 1);
+    }
+    benchmark_report("lcd_mostrar_estado", "llamada", &s);
+}
+
+/**
+ * @brief Carga fija del motor de audio y lectura de su perfil en core1.
+ *
+ * Toca las siete notas del instrumento del slot horizontal, una cada
+ * BENCH_NOTE_GAP_MS (la séptima roba una voz), y deja sonar la mezcla
+ * hasta completar BENCH_ENGINE_MS.
+ */
+static void bench_engine(void) {
+    audio_engine_stop_all();
+    audio_engine_reset_profile();
+
+    uint32_t waited = 0;
+    for (uint8_t note = 0; note < 7; note++) {
+        if (!audio_engine_play_note(SLOT_H, 'a', note)) {
+            printf("Advertencia: cola de audio llena durante la medición\n");
+        }
+        sleep_ms(BENCH_NOTE_GAP_MS);
+        waited += BENCH_NOTE_GAP_MS;
+    }
+    sleep_ms(BENCH_ENGINE_MS - waited);
+
+    audio_engine_status_t st = audio_engine_get_status();
+    audio_engine_stop_all();
+
+    benchmark_report("audio_player_process", "llamada", &st.profile.process);
+    benchmark_report("lectura_sd_voz",       "KB",      &st.profile.read);
+    benchmark_report("mezcla_bloque_i2s",    "frame",   &st.profile.mix);
+}
+
+void benchmark_print_header(void) {
+    printf("bench,plataforma,caso,unidad,muestras,prom,min,max  (ciclos por unidad, clk_sys %lu Hz)\n",
+           (unsigned long)clock_get_hz(clk_sys));
+}
+
+void benchmark_report(const char *name, const char *unit, const benchmark_stat_t *s) {
+    uint32_t avg_x100 = (s->units > 0) ? (uint32_t)((s->cycles * 100u) / s->units) : 0;
+
+    printf("bench,%s,%s,%s,%lu,%lu.%02lu,%lu,%lu\n",
+           BENCHMARK_PLATFORM, name, unit,
+           (unsigned long)s->samples,
+           (unsigned long)(avg_x100 / 100), (unsigned long)(avg_x100 % 100),
+           (unsigned long)s->min, (unsigned long)s->max);
+}
+
+void benchmark_run(void) {
+    printf("Medición de caminos críticos\n");
+    benchmark_cycles_init();
+    benchmark_print_header();
+
+    bench_imu();
+    bench_angles();
+    bench_fusion();
+    bench_lcd();
+    bench_engine();
+    mix_kernels_benchmark();
+
+    printf("Fin de la medición\n");
+}
@@ -0,0 +1,130 @@
+/**
+ * @file benchmark.h
+ * @brief Medición en ciclos de los caminos críticos del firmware.
+ *
+ * Cada caso se mide con el SysTick del núcleo que lo ejecuta (contador
+ * de 24 bits al reloj del sistema, cada núcleo del RP2040 tiene el suyo)
+ * y se informa en ciclos por unidad de trabajo: por llamada, por frame de
+ * audio o por KB leído de la SD.
+ *
+ *  - En core0 se llaman directamente: lectura del MPU6050, cálculo de
+ *    pitch y roll (atan2f en coma flotante por software), la fusión de
+ *    orientación en punto fijo que los reemplaza (por muestra a 1 kHz y
+ *    la conversión a ángulos) y actualización de la LCD.
+ *  - Lo que corre en core1 (audio_player_process(), recargas de la SD y
+ *    mezcla de bloques en la IRQ del I2S) se mide allí mismo, siempre
+ *    activo (player_profile_t); el caso toca unas notas fijas y lee el
+ *    perfil acumulado durante esa carga.
+ *  - Los kernels de mezcla, remuestreo y ADPCM los mide
+ *    mix_kernels_benchmark() y se informan por la misma vía.
+ *
+ * Los resultados se imprimen como CSV, una línea por caso con el prefijo
+ * "bench,", para poder compararlos entre compilaciones:
+ *
+ *   bench,<plataforma>,<caso>,<unidad>,<muestras>,<prom>,<min>,<max>
+ *
+ * con prom/min/max en ciclos por unidad. La plataforma es "rp2040" en la
+ * placa y "host" en la simulación para PC, cuyo SysTick cuenta el tiempo
+ * de CPU del PC de cada núcleo simulado convertido a ciclos del reloj del
+ * sistema: sirve para comparar compilaciones entre sí, no con la placa.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/structs/systick.h"
+
+/** Nombre de la plataforma en las líneas CSV. */
+#ifndef BENCHMARK_PLATFORM
+#define BENCHMARK_PLATFORM "rp2040"
+#endif
+
+/** 1 para ejecutar benchmark_run() al terminar el arranque (objetivos *_bench). */
+#ifndef BENCHMARK_AT_BOOT
+#define BENCHMARK_AT_BOOT 0
+#endif
+
+/** Máscara del contador SysTick (24 bits, cuenta hacia abajo). */
+#define BENCHMARK_SYSTICK_MASK 0x00FFFFFFu
+
+/**
+ * @brief Resultado de un caso, en ciclos.
+ */
+typedef struct {
+    uint32_t samples;   /**< Mediciones (llamadas o bloques). */
+    uint32_t units;     /**< Unidades de trabajo en total (frames, KB...). */
+    uint64_t cycles;    /**< Ciclos en total. */
+    uint32_t min;       /**< Menor medición, en ciclos por unidad. */
+    uint32_t max;       /**< Mayor medición, en ciclos por unidad. */
+} benchmark_stat_t;
+
+/**
+ * @brief Deja corriendo el SysTick del núcleo actual, sin IRQ.
+ *
+ * Una medición no debe superar 2^24 ciclos (134 ms a 125 MHz).
+ */
+static inline void benchmark_cycles_init(void) {
+    systick_hw->rvr = BENCHMARK_SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;   // habilitado, reloj del procesador, sin IRQ
+}
+
+/**
+ * @brief Lectura del contador de ciclos del núcleo actual.
+ */
+static inline uint32_t benchmark_cycles(void) {
+    return systick_hw->cvr;
+}
+
+/**
+ * @brief Ciclos transcurridos entre dos lecturas de benchmark_cycles().
+ */
+static inline uint32_t benchmark_elapsed(uint32_t t0, uint32_t t1) {
+    return (t0 - t1) & BENCHMARK_SYSTICK_MASK;
+}
+
+/**
+ * @brief Acumula una medición de @p cycles ciclos sobre @p units unidades.
+ */
+static inline void benchmark_stat_add(benchmark_stat_t *s, uint32_t cycles, uint32_t units) {
+    uint32_t per = (units > 0) ? cycles / units : cycles;
+
+    if (s->samples == 0 || per < s->min) s->min = per;
+    if (per > s->max) s->max = per;
+    s->samples++;
+    s->units  += units;
+    s->cycles += cycles;
+}
+
+/**
+ * @brief Imprime la cabecera CSV de los resultados.
+ */
+void benchmark_print_header(void);
+
+/**
+ * @brief Imprime la línea CSV de un caso.
+ *
+ * @param name Identificador del caso (sin comas ni espacios).
+ * @param unit Unidad de trabajo: "llamada", "frame", "KB"...
+ * @param s Resultado acumulado.
+ */
+void benchmark_report(const char *name, const char *unit, const benchmark_stat_t *s);
+
+/**
+ * @brief Ejecuta todos los casos e imprime los resultados.
+ *
+ * Llamar desde core0 con el motor de audio, la IMU y la LCD ya
+ * inicializados. Toca notas del instrumento del slot horizontal y
+ * reinicia el perfil del reproductor; tarda alrededor de 2 s.
+ */
+void benchmark_run(void);
+
+#endif // BENCHMARK_H
@@ -6,7 +6,9 @@
  *  - Lectura de 7 botones correspondientes a notas musicales.
  *  - Debounce individual.
  *  - Asociación GPIO -> nota -> archivo WAV.
- *  - Detección de eventos y entrega del índice de nota.
+ *  - Detección de pulsaciones (flanco de bajada, sin espera) y de
+ *    sueltas (flanco de subida, confirmadas tras BUTTON_RELEASE_SETTLE_MS
+ *    con el pin en alto) y entrega del índice de nota.
  * 
  * Este módulo trabaja en conjunto con el reproductor WAV.
  * 
@@ -38,6 +40,17 @@
 /** GPIO nota SI. */
 #define BTN_SI    6
 
+/** Tiempo que el pin debe seguir en alto para aceptar una suelta (ms). */
+#define BUTTON_RELEASE_SETTLE_MS 20
+
+/**
+ * @brief Tipo de evento de un botón de nota.
+ */
+typedef enum {
+    BUTTON_PRESS,    /**< Se pulsó: empieza la nota. */
+    BUTTON_RELEASE   /**< Se soltó: la nota pasa a su fase de release. */
+} button_edge_t;
+
 /**
  * @brief Estructura que define un botón musical.
  */
@@ -45,7 +58,7 @@ typedef struct {
     uint32_t    gpio;        /**< GPIO asociado al botón. */
     const char *note_name;   /**< Nombre de la nota musical. */
     const char *wav_file;    /**< Ruta base del archivo WAV. */
-    bool        was_pressed; /**< Estado previo para debounce. */
+    bool        was_pressed; /**< Pulsación aceptada y aún sin suelta. */
 } button_t;
 
 /**
@@ -54,11 +67,29 @@ typedef struct {
 void button_controller_init(void);
 
 /**
- * @brief Procesa los botones y detecta si alguno fue presionado.
- * 
- * @return Índice 0..6 del botón presionado o -1 si no hubo evento.
+ * @brief Procesa los botones y detecta si alguno fue presionado o soltado.
+ *
+ * Entrega un evento por llamada; las pulsaciones tienen prioridad.
+ *
+ * @param edge Devuelve el tipo de evento (si lo hubo).
+ * @return Índice 0..6 del botón o -1 si no hubo evento.
+ */
+int button_controller_process(button_edge_t *edge);
+
+/**
+ * @brief Máscara de GPIO de todos los botones (notas y selector), para
+ *        despertar del bajo consumo.
+ */
+uint32_t button_controller_wake_pins(void);
+
+/**
+ * @brief Tras despertar del bajo consumo, toma como pulsado cada botón
+ *        que ya está en bajo y avisa al bucle principal.
+ *
+ * En dormant el flanco llega con los relojes detenidos y su IRQ puede no
+ * registrarse; así la pulsación que despertó al instrumento también suena.
  */
-int button_controller_process(void);
+void button_controller_wake(void);
 
 /**
  * @brief Obtiene el nombre de la nota asociada a un índice.
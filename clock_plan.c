@@ -0,0 +1,214 @@
+/**
+ * @file clock_plan.c
+ * @brief Elección del reloj del sistema según las frecuencias de audio.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "clock_plan.h"
+#include "power_manager.h"
+#include "i2s_output.h"
+#include "hw_config.h"
+#include "mpu6050.h"
+#include "LCD.h"
+#include "hardware/clocks.h"
+#include <stdio.h>
+
+// Límites del PLL (datasheet RP2040, 2.18.2)
+#define PLL_VCO_MIN_HZ   (750u * MHZ)
+#define PLL_VCO_MAX_HZ   (1600u * MHZ)
+#define PLL_FBDIV_MIN    16u
+#define PLL_FBDIV_MAX    320u
+#define PLL_POSTDIV_MAX  7u
+
+// Errores a menos de 1 ppm se consideran iguales al comparar planes
+#define PLAN_TIE_PPB     1000
+
+/**
+ * @brief Error (ppb) de la frecuencia que da el divisor @p div_q8 (1/256)
+ *        respecto de @p frame_hz ciclos PIO por segundo pedidos.
+ */
+static int32_t pio_error_ppb(uint32_t sys_hz, uint32_t frame_hz, uint32_t div_q8) {
+    int64_t want = (int64_t)div_q8 * frame_hz;
+    int64_t diff = (int64_t)sys_hz * 256 - want;
+    return (int32_t)(diff * 1000000000LL / want);
+}
+
+/**
+ * @brief Velocidad efectiva del SPI para @p baud, con la misma búsqueda
+ *        de prescala y divisor que spi_set_baudrate().
+ */
+static uint32_t spi_rate(uint32_t freq_in, uint32_t baud,
+                         uint8_t *prescale_out, uint16_t *postdiv_out) {
+    uint32_t prescale, postdiv;
+
+    for (prescale = 2; prescale <= 254; prescale += 2) {
+        if (freq_in < (prescale + 2) * 256 * (uint64_t)baud) break;
+    }
+    for (postdiv = 256; postdiv > 1; --postdiv) {
+        if (freq_in / (prescale * (postdiv - 1)) > baud) break;
+    }
+    *prescale_out = (uint8_t)prescale;
+    *postdiv_out  = (uint16_t)postdiv;
+    return freq_in / (prescale * postdiv);
+}
+
+/**
+ * @brief Velocidad efectiva del I2C para @p baud, como i2c_set_baudrate().
+ */
+static uint32_t i2c_rate(uint32_t freq_in, uint32_t baud) {
+    uint32_t period = (freq_in + baud / 2) / baud;
+    return freq_in / period;
+}
+
+/**
+ * @brief Completa el plan para una configuración del PLL.
+ */
+static void plan_fill(clock_plan_t *plan, uint32_t vco_hz, uint32_t pd1, uint32_t pd2,
+                      const uint32_t *rates, uint32_t count) {
+    uint32_t sys_hz = vco_hz / (pd1 * pd2);
+
+    plan->sys_hz     = sys_hz;
+    plan->vco_hz     = vco_hz;
+    plan->postdiv1   = (uint8_t)pd1;
+    plan->postdiv2   = (uint8_t)pd2;
+    plan->integer    = true;
+    plan->rate_count = count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        clock_plan_audio_t *a = &plan->audio[i];
+        uint32_t frame_hz = rates[i] * I2S_PIO_CYCLES_PER_FRAME;
+
+        a->rate = rates[i];
+        clock_plan_pio_div(sys_hz, rates[i], &a->div_int, &a->div_frac);
+
+        uint32_t div_q8 = (a->div_int << 8) | a->div_frac;
+        a->actual_mhz = (uint32_t)((uint64_t)sys_hz * 256 * 1000 /
+                                   ((uint64_t)div_q8 * I2S_PIO_CYCLES_PER_FRAME));
+        a->error_ppb  = pio_error_ppb(sys_hz, frame_hz, div_q8);
+        if (a->div_frac != 0) {
+            plan->integer = false;
+        }
+    }
+
+    plan->sd_spi_hz  = spi_rate(sys_hz, SD_SPI_BAUDRATE,
+                                &plan->sd_spi_prescale, &plan->sd_spi_postdiv);
+    plan->imu_i2c_hz = i2c_rate(sys_hz, MPU6050_I2C_BAUD);
+    plan->lcd_i2c_hz = i2c_rate(sys_hz, LCD_BAUD);
+}
+
+/**
+ * @brief Mayor error absoluto (ppb) entre las frecuencias del plan.
+ */
+static int32_t plan_worst_ppb(const clock_plan_t *plan) {
+    int32_t worst = 0;
+    for (uint32_t i = 0; i < plan->rate_count; i++) {
+        int32_t e = plan->audio[i].error_ppb;
+        if (e < 0) e = -e;
+        if (e > worst) worst = e;
+    }
+    return worst;
+}
+
+/**
+ * @brief true si @p a es mejor que @p b: menor error, luego SPI de la SD
+ *        más rápido, luego mayor reloj.
+ */
+static bool plan_better(const clock_plan_t *a, const clock_plan_t *b) {
+    int32_t ea = plan_worst_ppb(a);
+    int32_t eb = plan_worst_ppb(b);
+
+    if (ea + PLAN_TIE_PPB < eb) return true;
+    if (eb + PLAN_TIE_PPB < ea) return false;
+    if (a->sd_spi_hz != b->sd_spi_hz) return a->sd_spi_hz > b->sd_spi_hz;
+    return a->sys_hz > b->sys_hz;
+}
+
+void clock_plan_pio_div(uint32_t sys_hz, uint32_t rate,
+                        uint32_t *div_int, uint8_t *div_frac) {
+    uint32_t frame_hz = rate * I2S_PIO_CYCLES_PER_FRAME;
+    uint32_t whole    = (sys_hz + frame_hz / 2) / frame_hz;
+
+    if (whole >= 1) {
+        int32_t e = pio_error_ppb(sys_hz, frame_hz, whole << 8);
+        if (e < 0) e = -e;
+        if (e <= CLOCK_PLAN_MAX_PPM * 1000) {
+            *div_int  = whole;
+            *div_frac = 0;
+            return;
+        }
+    }
+
+    uint32_t div_q8 = (uint32_t)(((uint64_t)sys_hz * 256 + frame_hz / 2) / frame_hz);
+    if (div_q8 < 256) div_q8 = 256;
+    *div_int  = div_q8 >> 8;
+    *div_frac = (uint8_t)(div_q8 & 0xFF);
+}
+
+bool clock_plan_compute(const uint32_t *rates, uint32_t count, clock_plan_t *plan) {
+    if (count == 0 || count > CLOCK_PLAN_MAX_RATES) {
+        printf("Error: plan de relojes para %lu frecuencias\n", (unsigned long)count);
+        return false;
+    }
+
+    bool         found = false;
+    clock_plan_t cand;
+
+    for (uint32_t fbdiv = PLL_FBDIV_MIN; fbdiv <= PLL_FBDIV_MAX; fbdiv++) {
+        uint32_t vco_hz = fbdiv * XOSC_HZ;
+        if (vco_hz < PLL_VCO_MIN_HZ || vco_hz > PLL_VCO_MAX_HZ) continue;
+
+        for (uint32_t pd1 = 1; pd1 <= PLL_POSTDIV_MAX; pd1++) {
+            for (uint32_t pd2 = 1; pd2 <= pd1; pd2++) {
+                // Solo relojes exactos en Hz, como set_sys_clock_khz()
+                if (vco_hz % (pd1 * pd2) != 0) continue;
+                uint32_t khz = vco_hz / (pd1 * pd2) / KHZ;
+                if (khz < CLOCK_PLAN_MIN_KHZ || khz > CLOCK_PLAN_MAX_KHZ) continue;
+
+                plan_fill(&cand, vco_hz, pd1, pd2, rates, count);
+                if (!cand.integer) continue;
+
+                if (!found || plan_better(&cand, plan)) {
+                    *plan = cand;
+                    found = true;
+                }
+            }
+        }
+    }
+
+    if (!found) {
+        plan_fill(plan, PLL_SYS_VCO_FREQ_HZ, PLL_SYS_POSTDIV1, PLL_SYS_POSTDIV2,
+                  rates, count);
+    }
+    return true;
+}
+
+void clock_plan_apply(const clock_plan_t *plan) {
+    power_manager_set_sys_clock_pll(plan->vco_hz, plan->postdiv1, plan->postdiv2);
+}
+
+void clock_plan_print(const clock_plan_t *plan) {
+    printf("   clk_sys: %.3f MHz (VCO %lu MHz / %u / %u)%s\n",
+           plan->sys_hz / 1e6, (unsigned long)(plan->vco_hz / MHZ),
+           plan->postdiv1, plan->postdiv2,
+           plan->integer ? ", divisores PIO enteros" : ", divisores PIO fraccionarios");
+
+    for (uint32_t i = 0; i < plan->rate_count; i++) {
+        const clock_plan_audio_t *a = &plan->audio[i];
+        printf("   Audio %lu Hz: divisor PIO %lu + %u/256 -> %lu.%03lu Hz (%+.2f ppm)\n",
+               (unsigned long)a->rate, (unsigned long)a->div_int, a->div_frac,
+               (unsigned long)(a->actual_mhz / 1000), (unsigned long)(a->actual_mhz % 1000),
+               a->error_ppb / 1000.0);
+    }
+
+    printf("   SPI SD: %.3f MHz (pedido %.3f MHz, prescala %u x %u)\n",
+           plan->sd_spi_hz / 1e6, SD_SPI_BAUDRATE / 1e6,
+           plan->sd_spi_prescale, plan->sd_spi_postdiv);
+    printf("   I2C IMU: %lu Hz (pedido %u), I2C LCD: %lu Hz (pedido %u)\n",
+           (unsigned long)plan->imu_i2c_hz, MPU6050_I2C_BAUD,
+           (unsigned long)plan->lcd_i2c_hz, LCD_BAUD);
+}
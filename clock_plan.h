@@ -0,0 +1,111 @@
+/**
+ * @file clock_plan.h
+ * @brief Elección del reloj del sistema según las frecuencias de audio.
+ *
+ * El BCLK del I2S sale del PIO con divisor clk_sys / (rate * 96). Un
+ * divisor fraccionario alterna entre dos periodos de clk_sys (jitter en
+ * BCLK y LRCK): con 125 MHz y 44.1 kHz el divisor es 29,53. Este módulo
+ * recorre las configuraciones del PLL del sistema (VCO múltiplo de los
+ * 12 MHz del XOSC, 750-1600 MHz, dos divisores de salida 1-7) entre
+ * CLOCK_PLAN_MIN_KHZ y CLOCK_PLAN_MAX_KHZ y elige la que deja el divisor
+ * del PIO entero para cada frecuencia pedida con el menor error de
+ * frecuencia; entre iguales, la de mayor SPI de la SD y luego la de mayor
+ * reloj (más margen para la mezcla).
+ *
+ * Con el reloj elegido deriva los divisores del SPI de la SD y de los I2C
+ * de la IMU y de la LCD (clk_peri sigue a clk_sys) con las mismas cuentas
+ * que spi_set_baudrate() e i2c_set_baudrate(), para informar la velocidad
+ * efectiva de cada bus.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef CLOCK_PLAN_H
+#define CLOCK_PLAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Reloj mínimo considerado (kHz): el del arranque del SDK. */
+#define CLOCK_PLAN_MIN_KHZ 125000
+
+/** Reloj máximo considerado (kHz): 200 MHz certificados con 1,15 V. */
+#define CLOCK_PLAN_MAX_KHZ 200000
+
+/** Error máximo aceptado con divisor entero (ppm); si no, fraccionario. */
+#define CLOCK_PLAN_MAX_PPM 500
+
+/** Máximo de frecuencias de audio por plan. */
+#define CLOCK_PLAN_MAX_RATES 4
+
+/**
+ * @brief Divisor del PIO para una frecuencia de audio.
+ */
+typedef struct {
+    uint32_t rate;          /**< Frecuencia pedida (Hz). */
+    uint32_t div_int;       /**< Parte entera del divisor. */
+    uint8_t  div_frac;      /**< Parte fraccionaria (1/256); 0 sin jitter. */
+    uint32_t actual_mhz;    /**< Frecuencia efectiva (mHz). */
+    int32_t  error_ppb;     /**< Error de la frecuencia efectiva (ppb). */
+} clock_plan_audio_t;
+
+/**
+ * @brief Plan de relojes: PLL del sistema y divisores que resultan.
+ */
+typedef struct {
+    uint32_t sys_hz;        /**< clk_sys y clk_peri. */
+    uint32_t vco_hz;        /**< VCO del PLL del sistema. */
+    uint8_t  postdiv1;      /**< Primer divisor de salida del PLL. */
+    uint8_t  postdiv2;      /**< Segundo divisor de salida del PLL. */
+    bool     integer;       /**< Todos los divisores del PIO son enteros. */
+
+    uint32_t           rate_count;
+    clock_plan_audio_t audio[CLOCK_PLAN_MAX_RATES];
+
+    uint32_t sd_spi_hz;         /**< SPI de la SD efectivo. */
+    uint8_t  sd_spi_prescale;   /**< CPSDVSR del SPI (par, 2-254). */
+    uint16_t sd_spi_postdiv;    /**< SCR + 1 del SPI (1-256). */
+    uint32_t imu_i2c_hz;        /**< I2C de la IMU efectivo. */
+    uint32_t lcd_i2c_hz;        /**< I2C de la LCD efectivo. */
+} clock_plan_t;
+
+/**
+ * @brief Divisor del PIO para @p rate frames por segundo con @p sys_hz:
+ *        entero si su error no pasa de CLOCK_PLAN_MAX_PPM, si no el
+ *        fraccionario más cercano.
+ */
+void clock_plan_pio_div(uint32_t sys_hz, uint32_t rate,
+                        uint32_t *div_int, uint8_t *div_frac);
+
+/**
+ * @brief Busca el reloj del sistema para las frecuencias de audio dadas.
+ *
+ * Si ninguna configuración deja todos los divisores enteros dentro de
+ * CLOCK_PLAN_MAX_PPM, el plan queda con el reloj del arranque y divisores
+ * fraccionarios (integer = false).
+ *
+ * @param rates Frecuencias de audio (Hz).
+ * @param count Cantidad de frecuencias (1 a CLOCK_PLAN_MAX_RATES).
+ * @param plan Plan resultante.
+ * @return false si los argumentos no son válidos.
+ */
+bool clock_plan_compute(const uint32_t *rates, uint32_t count, clock_plan_t *plan);
+
+/**
+ * @brief Aplica el plan con power_manager_set_sys_clock_pll().
+ *
+ * Llamar antes de inicializar los periféricos o con ellos registrados
+ * para el aviso de cambio de reloj.
+ */
+void clock_plan_apply(const clock_plan_t *plan);
+
+/**
+ * @brief Imprime el plan y el error de cada frecuencia de audio.
+ */
+void clock_plan_print(const clock_plan_t *plan);
+
+#endif // CLOCK_PLAN_H
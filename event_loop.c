@@ -0,0 +1,69 @@
+/**
+ * @file event_loop.c
+ * @brief Eventos del bucle principal de core0 y espera en bajo consumo.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "event_loop.h"
+#include "mpu6050.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+static volatile uint32_t pending = 0;
+static bool              imu_running = false;
+
+/**
+ * @brief Aviso del flujo de la IMU: hay muestras nuevas en su anillo.
+ */
+static void imu_ready_cb(void) {
+    event_loop_post(EVENT_IMU);
+}
+
+/**
+ * @brief Aviso de stdio: hay caracteres en la consola USB.
+ */
+static void console_cb(void *param) {
+    (void)param;
+    event_loop_post(EVENT_CONSOLE);
+}
+
+void event_loop_init(void) {
+    pending = 0;
+    event_loop_set_imu(true);
+    stdio_set_chars_available_callback(console_cb, NULL);
+}
+
+void event_loop_set_imu(bool enable) {
+    if (enable == imu_running) return;
+
+    if (enable) {
+        imu_running = mpu6050_stream_start(imu_ready_cb);
+    } else {
+        mpu6050_stream_stop();
+        imu_running = false;
+    }
+}
+
+void event_loop_post(uint32_t events) {
+    uint32_t irq = save_and_disable_interrupts();
+    pending |= events;
+    restore_interrupts(irq);
+    __sev();
+}
+
+uint32_t event_loop_wait(uint32_t timeout_ms) {
+    if (pending == 0 && timeout_ms > 0) {
+        best_effort_wfe_or_timeout(make_timeout_time_ms(timeout_ms));
+    }
+
+    uint32_t irq    = save_and_disable_interrupts();
+    uint32_t events = pending;
+    pending = 0;
+    restore_interrupts(irq);
+    return events;
+}
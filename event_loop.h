@@ -0,0 +1,79 @@
+/**
+ * @file event_loop.h
+ * @brief Eventos del bucle principal de core0 y espera en bajo consumo.
+ *
+ * Las interrupciones de core0 no hacen el trabajo: marcan un bit de
+ * evento y el bucle principal, que duerme en __wfe() mientras no hay
+ * nada pendiente, lo atiende al despertar:
+ *  - EVENT_BUTTON: IRQ GPIO de cualquier botón, y la alarma que confirma
+ *    una suelta cuando vence BUTTON_RELEASE_SETTLE_MS.
+ *  - EVENT_IMU: la ráfaga de la FIFO de la IMU dejó muestras nuevas.
+ *  - EVENT_CONSOLE: llegaron caracteres por la consola USB.
+ *
+ * Cada evento emite __sev(), así que un evento que llega justo antes de
+ * dormir no se pierde: el __wfe() siguiente vuelve de inmediato. Core1
+ * despierta al bucle de la misma forma al publicar un evento del motor de
+ * audio (cuya IRQ DMA de bloque ya corre en core1), sin bit propio: la
+ * cola del motor se revisa en cada vuelta.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Flanco en un botón o suelta lista para confirmar. */
+#define EVENT_BUTTON   (1u << 0)
+
+/** Hay muestras de la IMU para sacar con mpu6050_stream_pop(). */
+#define EVENT_IMU      (1u << 1)
+
+/** Caracteres disponibles en la consola USB. */
+#define EVENT_CONSOLE  (1u << 2)
+
+/** Todos los eventos (primera vuelta del bucle). */
+#define EVENT_ALL      (EVENT_BUTTON | EVENT_IMU | EVENT_CONSOLE)
+
+/**
+ * @brief Arranca el flujo de la IMU y el aviso de la consola USB.
+ *
+ * Llamar desde core0, que atiende sus IRQ.
+ */
+void event_loop_init(void);
+
+/**
+ * @brief Detiene o reanuda el flujo de la IMU (la IMU dormida no tiene
+ *        nada que leer).
+ */
+void event_loop_set_imu(bool enable);
+
+/**
+ * @brief Marca eventos pendientes y despierta al bucle principal.
+ *
+ * Se puede llamar desde una IRQ de core0.
+ *
+ * @param events Máscara de EVENT_*.
+ */
+void event_loop_post(uint32_t events);
+
+/**
+ * @brief Duerme hasta un evento, un aviso de core1 o el plazo, y devuelve
+ *        los eventos pendientes.
+ *
+ * Si ya hay eventos pendientes no duerme. Puede volver sin eventos (aviso
+ * de core1 o plazo vencido): el bucle revisa entonces lo que depende del
+ * tiempo y de core1.
+ *
+ * @param timeout_ms Plazo máximo de espera.
+ * @return Máscara de EVENT_* pendientes, que quedan atendidos.
+ */
+uint32_t event_loop_wait(uint32_t timeout_ms);
+
+#endif // EVENT_LOOP_H
@@ -1,11 +1,26 @@
 /**
  * @file i2s_output.c
- * @brief Implementación de salida I2S usando PIO.
+ * @brief Implementación de salida I2S usando PIO y DMA.
+ *
+ * El audio se entrega en un anillo de I2S_RING_BLOCKS bloques. Dos canales
+ * DMA encadenados entre sí (A -> B -> A ...) y pacificados por el DREQ TX
+ * del PIO transfieren un bloque cada uno. Cuando un canal termina, el otro
+ * arranca solo y la IRQ reprograma el canal terminado con el siguiente
+ * bloque pendiente (o con un bloque de silencio si el productor no llegó),
+ * por lo que la CPU no toca cada frame.
+ *
+ * Cada lugar del anillo guarda la dirección que leerá el DMA: su propio
+ * bloque o, en los bloques externos, el buffer del productor, que así llega
+ * al PIO sin pasar por la CPU.
  */
 
 #include "i2s_output.h"
 #include "hw_config.h"
+#include "clock_plan.h"
 #include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
 #include <stdio.h>
 #include "i2s_tx.pio.h"
 
@@ -14,38 +29,206 @@ static uint i2s_sm          = 0;
 static uint i2s_offset      = 0;
 static bool i2s_initialized = false;
 static bool i2s_active      = false;
+static bool i2s_primed      = false;   // DMA detenido hasta el primer bloque
 static uint32_t current_sample_rate = 0;
 
-// 96 ciclos PIO por frame estéreo en i2s_tx.pio
-#define I2S_PIO_CYCLES_PER_FRAME 96.0f
+// Divisor actual del PIO (entero si el reloj lo permite, ver clock_plan.h)
+static uint32_t clkdiv_int  = 1;
+static uint8_t  clkdiv_frac = 0;
+
+// IRQ DMA usada por I2S (DMA_IRQ_0 queda para el driver SPI de la SD)
+#define I2S_DMA_IRQ DMA_IRQ_1
+
+// Anillo de bloques y bloque de silencio para cubrir faltas de datos
+static uint32_t ring[I2S_RING_BLOCKS][I2S_BLOCK_FRAMES] __attribute__((aligned(4)));
+static uint32_t silence_block[I2S_BLOCK_FRAMES] __attribute__((aligned(4)));
+
+// Dirección que leerá el DMA para cada lugar del anillo
+static const uint32_t *volatile ring_src[I2S_RING_BLOCKS];
+
+// Canales DMA encadenados y bloque que tiene cargado cada uno (-1 = silencio)
+static int dma_ch[2]    = {-1, -1};
+static int ch_block[2]  = {-1, -1};
+static uint32_t ch_seq[2];            // secuencia del bloque cargado en cada canal
+
+// Bloque vigilado para medir latencia
+static volatile bool     watch_armed = false;
+static volatile bool     watch_hit   = false;
+static volatile uint32_t watch_seq   = 0;
+static volatile uint32_t watch_us    = 0;
+
+// Contadores monotónicos del anillo (productor / IRQ)
+static volatile uint32_t blocks_written  = 0;
+static volatile uint32_t blocks_assigned = 0;
+static volatile uint32_t blocks_released = 0;
+static volatile uint32_t silence_blocks  = 0;
+static uint32_t          external_blocks = 0;
+
+static volatile i2s_block_callback_t block_callback = NULL;
+static i2s_log_callback_t            log_callback   = NULL;
+
+/**
+ * @brief Imprime un mensaje, o lo pasa al callback de mensajes si hay uno.
+ */
+static void i2s_log(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (log_callback) {
+        log_callback(format, args);
+    } else {
+        vprintf(format, args);
+    }
+    va_end(args);
+}
+
+/**
+ * @brief Carga en el canal k el siguiente bloque pendiente o silencio.
+ */
+static void i2s_dma_load_next(int k) {
+    uint ch = (uint)dma_ch[k];
+
+    if (blocks_assigned != blocks_written) {
+        ch_block[k] = (int)(blocks_assigned % I2S_RING_BLOCKS);
+        ch_seq[k]   = blocks_assigned;
+        blocks_assigned++;
+        dma_channel_set_read_addr(ch, ring_src[ch_block[k]], false);
+    } else {
+        ch_block[k] = -1;
+        dma_channel_set_read_addr(ch, silence_block, false);
+    }
+    dma_channel_set_trans_count(ch, I2S_BLOCK_FRAMES, false);
+}
+
+/**
+ * @brief IRQ de fin de bloque: libera el bloque consumido y rearma el canal.
+ */
+static void i2s_dma_irq_handler(void) {
+    for (int k = 0; k < 2; k++) {
+        uint ch = (uint)dma_ch[k];
+        if (!dma_channel_get_irq1_status(ch)) {
+            continue;
+        }
+        dma_channel_acknowledge_irq1(ch);
+
+        // El canal encadenado acaba de arrancar con su bloque
+        if (watch_armed && ch_block[k ^ 1] >= 0 && ch_seq[k ^ 1] == watch_seq) {
+            watch_us    = time_us_32();
+            watch_hit   = true;
+            watch_armed = false;
+        }
+
+        if (ch_block[k] >= 0) {
+            blocks_released++;
+        } else {
+            silence_blocks++;
+        }
+
+        i2s_dma_load_next(k);
+
+        if (block_callback) {
+            block_callback();
+        }
+    }
+}
+
+/**
+ * @brief Configura los dos canales DMA encadenados y, si @p run, arranca
+ *        el primero.
+ */
+static void i2s_dma_start(bool run) {
+    // Lo que quedara en el anillo se descarta, pero los contadores siguen
+    // creciendo: un bloque externo entregado antes cuenta ya como
+    // reproducido en i2s_output_block_done()
+    blocks_assigned = blocks_written;
+    blocks_released = blocks_written;
+
+    for (int k = 0; k < 2; k++) {
+        uint ch = (uint)dma_ch[k];
+        dma_channel_config c = dma_channel_get_default_config(ch);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, pio_get_dreq(i2s_pio, i2s_sm, true));
+        channel_config_set_chain_to(&c, (uint)dma_ch[k ^ 1]);
+
+        ch_block[k] = -1;
+        dma_channel_configure(ch, &c, &i2s_pio->txf[i2s_sm],
+                              silence_block, I2S_BLOCK_FRAMES, false);
+        dma_channel_set_irq1_enabled(ch, true);
+    }
+
+    if (run) {
+        dma_channel_start((uint)dma_ch[0]);
+    }
+}
+
+/**
+ * @brief Calcula el divisor del PIO para @p sample_rate con el clk_sys
+ *        actual.
+ */
+static void i2s_clkdiv_update(uint32_t sample_rate) {
+    clock_plan_pio_div(clock_get_hz(clk_sys), sample_rate, &clkdiv_int, &clkdiv_frac);
+}
+
+/**
+ * @brief Imprime el divisor actual del PIO.
+ */
+static void i2s_print_clkdiv(void) {
+    i2s_log("   Divider: %lu + %u/256%s\n", (unsigned long)clkdiv_int, clkdiv_frac,
+            clkdiv_frac == 0 ? " (entero, sin jitter)" : "");
+}
+
+/**
+ * @brief Reinicia el state machine desde el inicio del programa con el
+ *        divisor actual (queda detenido).
+ */
+static void i2s_sm_reset(void) {
+    pio_sm_config c = i2s_tx_program_get_default_config(i2s_offset);
+    sm_config_set_out_pins(&c, I2S_DIN_PIN, 1);
+    sm_config_set_sideset_pins(&c, I2S_BCLK_PIN);
+    sm_config_set_out_shift(&c, false, false, 32);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    sm_config_set_clkdiv_int_frac8(&c, clkdiv_int, clkdiv_frac);
+
+    pio_sm_init(i2s_pio, i2s_sm, i2s_offset, &c);
+}
+
+/**
+ * @brief Detiene ambos canales DMA sin disparar el encadenamiento.
+ */
+static void i2s_dma_abort(void) {
+    for (int k = 0; k < 2; k++) {
+        dma_channel_set_irq1_enabled((uint)dma_ch[k], false);
+    }
+    for (int k = 0; k < 2; k++) {
+        dma_channel_abort((uint)dma_ch[k]);
+        dma_channel_acknowledge_irq1((uint)dma_ch[k]);
+    }
+}
 
 bool i2s_output_init(uint sample_rate) {
-    printf("Inicializando salida I2S.\n");
+    i2s_log("Inicializando salida I2S.\n");
 
     if (i2s_initialized) {
+        if (i2s_active) {
+            i2s_dma_abort();
+        }
         pio_sm_set_enabled(i2s_pio, i2s_sm, false);
         pio_sm_clear_fifos(i2s_pio, i2s_sm);
 
-        uint32_t sys_clk = clock_get_hz(clk_sys);
-        float pio_clk = (float)sample_rate * I2S_PIO_CYCLES_PER_FRAME;
-        float div = (float)sys_clk / pio_clk;
-
-        pio_sm_config c = i2s_tx_program_get_default_config(i2s_offset);
-        sm_config_set_out_pins(&c, I2S_DIN_PIN, 1);
-        sm_config_set_sideset_pins(&c, I2S_BCLK_PIN);
-        sm_config_set_out_shift(&c, false, true, 32);
-        sm_config_set_clkdiv(&c, div);
-
-        pio_sm_init(i2s_pio, i2s_sm, i2s_offset, &c);
+        i2s_clkdiv_update(sample_rate);
+        i2s_sm_reset();
+        i2s_dma_start(true);
         pio_sm_set_enabled(i2s_pio, i2s_sm, true);
 
         i2s_active = true;
+        i2s_primed = false;
         current_sample_rate = sample_rate;
 
-        printf("  I2S reconfigurado:\n");
-        printf("   PIO: pio%d, SM: %u\n", pio_get_index(i2s_pio), i2s_sm);
-        printf("   Sample Rate: %lu Hz\n", sample_rate);
-        printf("   Divider: %.4f\n", div);
+        i2s_log("  I2S reconfigurado:\n");
+        i2s_log("   PIO: pio%d, SM: %u\n", pio_get_index(i2s_pio), i2s_sm);
+        i2s_log("   Sample Rate: %lu Hz\n", sample_rate);
+        i2s_print_clkdiv();
 
         return true;
     }
@@ -53,7 +236,14 @@ bool i2s_output_init(uint sample_rate) {
     i2s_pio = pio0;
 
     if (!pio_can_add_program(i2s_pio, &i2s_tx_program)) {
-        printf("Error: no hay espacio para programa PIO\n");
+        i2s_log("Error: no hay espacio para programa PIO\n");
+        return false;
+    }
+
+    dma_ch[0] = dma_claim_unused_channel(false);
+    dma_ch[1] = dma_claim_unused_channel(false);
+    if (dma_ch[0] < 0 || dma_ch[1] < 0) {
+        i2s_log("Error: no hay canales DMA libres para I2S\n");
         return false;
     }
 
@@ -62,44 +252,141 @@ bool i2s_output_init(uint sample_rate) {
 
     i2s_tx_program_init(i2s_pio, i2s_sm, i2s_offset, I2S_DIN_PIN, I2S_BCLK_PIN);
 
-    uint32_t sys_clk = clock_get_hz(clk_sys);
-    float pio_clk = (float)sample_rate * I2S_PIO_CYCLES_PER_FRAME;
-    float div = (float)sys_clk / pio_clk;
+    i2s_clkdiv_update(sample_rate);
+    pio_sm_set_clkdiv_int_frac8(i2s_pio, i2s_sm, clkdiv_int, clkdiv_frac);
 
-    pio_sm_set_clkdiv(i2s_pio, i2s_sm, div);
+    irq_add_shared_handler(I2S_DMA_IRQ, i2s_dma_irq_handler,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(I2S_DMA_IRQ, true);
+
+    i2s_dma_start(true);
     pio_sm_set_enabled(i2s_pio, i2s_sm, true);
 
     i2s_active = true;
     i2s_initialized = true;
     current_sample_rate = sample_rate;
 
-    printf(" I2S inicializado:\n");
-    printf("   PIO: pio%d, SM: %u\n", pio_get_index(i2s_pio), i2s_sm);
-    printf("   Sample Rate: %lu Hz\n", sample_rate);
-    printf("   Divider: %.4f\n", div);
+    i2s_log(" I2S inicializado:\n");
+    i2s_log("   PIO: pio%d, SM: %u\n", pio_get_index(i2s_pio), i2s_sm);
+    i2s_log("   DMA: canales %d y %d (%u bloques x %u frames)\n",
+            dma_ch[0], dma_ch[1], I2S_RING_BLOCKS, I2S_BLOCK_FRAMES);
+    i2s_log("   Sample Rate: %lu Hz\n", sample_rate);
+    i2s_print_clkdiv();
 
     return true;
 }
 
-void i2s_output_send_frame(int16_t left, int16_t right) {
+uint32_t *i2s_output_get_block() {
+    if (!i2s_active) return NULL;
+    if (blocks_written - blocks_released >= I2S_RING_BLOCKS) return NULL;
+
+    return ring[blocks_written % I2S_RING_BLOCKS];
+}
+
+void i2s_output_commit_block() {
     if (!i2s_active) return;
+    ring_src[blocks_written % I2S_RING_BLOCKS] = ring[blocks_written % I2S_RING_BLOCKS];
+    blocks_written++;
+}
+
+bool i2s_output_commit_external(const uint32_t *frames, uint32_t *seq) {
+    if (!i2s_active) return false;
+    if (blocks_written - blocks_released >= I2S_RING_BLOCKS) return false;
+
+    ring_src[blocks_written % I2S_RING_BLOCKS] = frames;
+    *seq = blocks_written;
+    external_blocks++;
+    blocks_written++;
+    return true;
+}
+
+uint32_t i2s_output_block_seq(void) {
+    return blocks_written;
+}
+
+void i2s_output_watch_block(uint32_t seq) {
+    watch_hit   = false;
+    watch_seq   = seq;
+    watch_armed = true;
+}
+
+bool i2s_output_watch_done(uint32_t *start_us) {
+    if (!watch_hit) return false;
+    watch_hit = false;
+    *start_us = watch_us;
+    return true;
+}
+
+bool i2s_output_block_done(uint32_t seq) {
+    return !i2s_active || (int32_t)(blocks_released - seq) > 0;
+}
 
-    uint32_t frame = ((uint32_t)(uint16_t)left << 16)
-                     | (uint16_t)right;
+uint i2s_output_free_blocks() {
+    if (!i2s_active) return 0;
+    return I2S_RING_BLOCKS - (blocks_written - blocks_released);
+}
 
-    pio_sm_put_blocking(i2s_pio, i2s_sm, frame);
+void i2s_output_set_block_callback(i2s_block_callback_t cb) {
+    block_callback = cb;
 }
 
-bool i2s_output_can_send() {
-    return i2s_active && !pio_sm_is_tx_fifo_full(i2s_pio, i2s_sm);
+void i2s_output_set_log_callback(i2s_log_callback_t cb) {
+    log_callback = cb;
 }
 
 void i2s_output_stop() {
     if (i2s_active) {
+        i2s_dma_abort();
         pio_sm_set_enabled(i2s_pio, i2s_sm, false);
         pio_sm_clear_fifos(i2s_pio, i2s_sm);
         i2s_active = false;
-        printf("I2S detenido\n");
+        i2s_primed = false;
+        i2s_log("I2S detenido\n");
+    }
+}
+
+bool i2s_output_start(void) {
+    if (!i2s_initialized) return false;
+    if (i2s_active) return true;
+
+    i2s_clkdiv_update(current_sample_rate);
+    i2s_sm_reset();
+    i2s_dma_start(false);
+
+    i2s_active = true;
+    i2s_primed = true;
+    return true;
+}
+
+bool i2s_output_prime(void) {
+    if (!i2s_primed) return false;
+
+    if (block_callback) {
+        block_callback();
+    }
+    if (blocks_written == blocks_assigned) {
+        return false;
+    }
+
+    // Los dos canales arrancan con bloques del anillo, no con silencio
+    i2s_dma_load_next(0);
+    i2s_dma_load_next(1);
+    if (watch_armed && ch_block[0] >= 0 && ch_seq[0] == watch_seq) {
+        watch_us    = time_us_32();
+        watch_hit   = true;
+        watch_armed = false;
+    }
+    dma_channel_start((uint)dma_ch[0]);
+    pio_sm_set_enabled(i2s_pio, i2s_sm, true);
+
+    i2s_primed = false;
+    return true;
+}
+
+void i2s_output_clock_changed(void) {
+    if (i2s_active) {
+        i2s_clkdiv_update(current_sample_rate);
+        pio_sm_set_clkdiv_int_frac8(i2s_pio, i2s_sm, clkdiv_int, clkdiv_frac);
     }
 }
 
@@ -108,7 +395,10 @@ i2s_info_t i2s_output_get_info() {
         .pio = i2s_pio,
         .sm = i2s_sm,
         .active = i2s_active,
-        .sample_rate = current_sample_rate
+        .sample_rate = current_sample_rate,
+        .blocks_played = blocks_released,
+        .silence_blocks = silence_blocks,
+        .external_blocks = external_blocks
     };
     return info;
 }
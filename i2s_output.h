@@ -1,12 +1,18 @@
 /**
  * @file i2s_output.h
- * @brief Interfaz de salida I2S basada en PIO.
- * 
+ * @brief Interfaz de salida I2S basada en PIO y alimentada por DMA.
+ *
  * Permite:
  *  - Inicializar transmisión I2S con frecuencia de muestreo variable.
- *  - Enviar frames estéreo de 32 bits (16L + 16R).
- *  - Consultar si el FIFO del PIO tiene espacio.
- *  - Detener la transmisión.
+ *  - Entregar audio en bloques de frames estéreo de 32 bits (16L + 16R)
+ *    que dos canales DMA encadenados llevan al FIFO del PIO.
+ *  - Entregar bloques externos sin copia: el DMA lee los frames
+ *    directamente de un buffer ajeno (por ejemplo, el de lectura de la SD),
+ *    ya que el formato del frame es el de un WAV estéreo de 16 bits.
+ *  - Consultar cuántos bloques del anillo están libres.
+ *  - Registrar un callback que se ejecuta cuando se libera un bloque.
+ *  - Detener y reanudar la transmisión, y recalcular el divisor del PIO
+ *    cuando cambia el reloj del sistema.
  */
 
 #ifndef I2S_OUTPUT_H
@@ -14,38 +20,170 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdarg.h>
 #include "hardware/pio.h"
 
+/** Frames estéreo por bloque DMA (128 frames = 2.9 ms a 44.1 kHz). */
+#define I2S_BLOCK_FRAMES  128
+
+/** Número de bloques del anillo DMA (8 bloques = 23 ms a 44.1 kHz). */
+#define I2S_RING_BLOCKS   8
+
+/** Ciclos PIO por frame estéreo en i2s_tx.pio (el divisor es clk_sys / (rate * 96)). */
+#define I2S_PIO_CYCLES_PER_FRAME 96
+
+/**
+ * @brief Callback invocado desde la IRQ DMA cada vez que se libera un bloque.
+ */
+typedef void (*i2s_block_callback_t)(void);
+
+/**
+ * @brief Destino de los mensajes del módulo (con formato de printf).
+ */
+typedef void (*i2s_log_callback_t)(const char *format, va_list args);
+
 /**
  * @brief Inicializa salida I2S con un sample rate dado.
+ *
+ * La primera llamada carga el programa PIO y reserva los canales DMA;
+ * las siguientes solo reconfiguran el divisor y reinician el anillo.
+ *
  * @param sample_rate Frecuencia de muestreo (ej. 44100 o 48000).
  * @return true si se inicializó correctamente.
  */
 bool i2s_output_init(uint sample_rate);
 
 /**
- * @brief Envía un frame I2S (bloqueante si FIFO está lleno).
+ * @brief Empaqueta un frame estéreo en el formato que consume i2s_tx.pio.
+ *
+ * Es el mismo orden que un WAV estéreo de 16 bits leído como palabra
+ * little-endian: izquierdo en la mitad baja, derecho en la alta.
+ */
+static inline uint32_t i2s_output_pack_frame(int16_t left, int16_t right) {
+    return ((uint32_t)(uint16_t)right << 16) | (uint16_t)left;
+}
+
+/**
+ * @brief Devuelve el siguiente bloque libre del anillo para escribir
+ *        I2S_BLOCK_FRAMES frames empaquetados.
+ *
+ * @return Puntero al bloque, o NULL si el anillo está lleno o I2S inactivo.
  */
-void i2s_output_send_frame(int16_t left, int16_t right);
+uint32_t *i2s_output_get_block();
 
 /**
- * @brief Indica si hay espacio en el FIFO TX del PIO.
+ * @brief Entrega al DMA el bloque obtenido con i2s_output_get_block().
  */
-bool i2s_output_can_send();
+void i2s_output_commit_block();
 
 /**
- * @brief Detiene la salida I2S.
+ * @brief Entrega al DMA un bloque externo de I2S_BLOCK_FRAMES frames sin copiarlo.
+ *
+ * Ocupa el siguiente lugar del anillo igual que i2s_output_commit_block()
+ * (debe haber uno libre), pero el DMA lee directamente de @p frames. El
+ * buffer debe estar alineado a 4 bytes y no puede modificarse hasta que
+ * i2s_output_block_done() confirme que el bloque se reprodujo.
+ *
+ * @param frames Frames en el formato de i2s_output_pack_frame().
+ * @param seq Devuelve el número de secuencia del bloque.
+ * @return false si el I2S está inactivo o el anillo lleno.
+ */
+bool i2s_output_commit_external(const uint32_t *frames, uint32_t *seq);
+
+/**
+ * @brief Indica si el bloque con número de secuencia @p seq ya se reprodujo
+ *        (o si la salida se detuvo o se reinició), de modo que su buffer
+ *        puede reutilizarse.
+ */
+bool i2s_output_block_done(uint32_t seq);
+
+/**
+ * @brief Número de secuencia que tendrá el próximo bloque entregado al DMA.
+ */
+uint32_t i2s_output_block_seq(void);
+
+/**
+ * @brief Pide registrar el instante en que el DMA empieza a leer el bloque @p seq.
+ *
+ * Es el momento en que su primer frame entra al FIFO del PIO. Solo hay un
+ * bloque vigilado a la vez; se usa para medir latencia.
+ */
+void i2s_output_watch_block(uint32_t seq);
+
+/**
+ * @brief Consulta el bloque vigilado.
+ * @param start_us Devuelve el instante en que el DMA empezó a leerlo.
+ * @return true si ya empezó (y la vigilancia termina).
+ */
+bool i2s_output_watch_done(uint32_t *start_us);
+
+/**
+ * @brief Número de bloques del anillo disponibles para escribir.
+ */
+uint i2s_output_free_blocks();
+
+/**
+ * @brief Registra el callback de bloque liberado (NULL para quitarlo).
+ *
+ * Se ejecuta en contexto de interrupción: debe ser corto.
+ */
+void i2s_output_set_block_callback(i2s_block_callback_t cb);
+
+/**
+ * @brief Registra el destino de los mensajes (NULL = printf).
+ *
+ * El núcleo que maneja el I2S puede no tener permitido imprimir (ver
+ * audio_engine.h): así sus mensajes van a quien los imprima por él.
+ */
+void i2s_output_set_log_callback(i2s_log_callback_t cb);
+
+/**
+ * @brief Detiene la salida I2S y los canales DMA.
  */
 void i2s_output_stop();
 
+/**
+ * @brief Reanuda la salida detenida con i2s_output_stop(), con el anillo
+ *        vacío y el divisor calculado para el reloj actual.
+ *
+ * El DMA queda detenido hasta que i2s_output_prime() tenga el primer
+ * bloque: así el audio no espera detrás de dos bloques de silencio.
+ *
+ * Llamar desde core1, dueño de la IRQ DMA.
+ *
+ * @return false si el I2S nunca se inicializó.
+ */
+bool i2s_output_start(void);
+
+/**
+ * @brief Tras i2s_output_start(), llena el anillo con el callback de
+ *        bloque y arranca el DMA si quedó al menos un bloque.
+ *
+ * Llamar desde core1; sin efecto si el DMA ya corre.
+ *
+ * @return true si arrancó el DMA.
+ */
+bool i2s_output_prime(void);
+
+/**
+ * @brief Recalcula el divisor del PIO tras un cambio de clk_sys.
+ *
+ * Aviso de cambio de reloj (ver power_manager.h); si la salida está
+ * detenida, i2s_output_start() lo aplica al reanudar.
+ */
+void i2s_output_clock_changed(void);
+
 /**
  * @brief Información del estado actual del módulo I2S.
  */
 typedef struct {
-    PIO pio;               /**< Instancia PIO usada. */
-    uint sm;               /**< State machine asignada. */
-    bool active;           /**< true si está transmitiendo. */
-    uint32_t sample_rate;  /**< Frecuencia actual. */
+    PIO pio;                 /**< Instancia PIO usada. */
+    uint sm;                 /**< State machine asignada. */
+    bool active;             /**< true si está transmitiendo. */
+    uint32_t sample_rate;    /**< Frecuencia actual. */
+    uint32_t blocks_played;  /**< Bloques de audio enviados por DMA. */
+    uint32_t silence_blocks; /**< Bloques de silencio insertados por falta de datos. */
+    uint32_t external_blocks;/**< Bloques leídos por el DMA sin copia desde un buffer externo. */
 } i2s_info_t;
 
 /**
@@ -0,0 +1,326 @@
+/**
+ * @file imu_fusion.c
+ * @brief Fusión de acelerómetro y giroscopio en punto fijo (filtro de
+ *        Mahony) para la orientación de la IMU.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "imu_fusion.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Escalas del MPU6050 (las de mpu6050_calc_g y del tremolo)
+#define ACCEL_LSB_PER_G   16384
+#define GYRO_LSB_PER_DPS  131
+
+#define Q30_ONE  (1 << IMU_FUSION_Q)
+#define PI_D     3.14159265358979323846
+
+// Ventanas de |a| (en LSB) para usar el acelerómetro y para considerarse quieto
+#define ACCEL_MIN       (ACCEL_LSB_PER_G * 3 / 4)
+#define ACCEL_MAX       (ACCEL_LSB_PER_G * 5 / 4)
+#define ACCEL_STILL_MIN (ACCEL_LSB_PER_G * 9 / 10)
+#define ACCEL_STILL_MAX (ACCEL_LSB_PER_G * 11 / 10)
+#define GYRO_STILL_LSB  (IMU_FUSION_STILL_DPS * GYRO_LSB_PER_DPS)
+
+/** Pasos del CORDIC (error de ángulo bajo 0,002°). */
+#define CORDIC_STEPS  16
+
+/** 1 / ganancia del CORDIC de 16 pasos, en Q30. */
+#define CORDIC_INV_GAIN_Q30  652032874
+
+/** atan(2^-i) en grados Q16.16. */
+static const int32_t cordic_atan[CORDIC_STEPS] = {
+    2949120, 1740967, 919879, 466945, 234379, 117304, 58666, 29335,
+    14668, 7334, 3667, 1833, 917, 458, 229, 115
+};
+
+/**
+ * Medio giro por muestra por LSB del giroscopio, (1 / ODR) / 2 en
+ * radianes, en Q38: el producto con la lectura cruda cabe en 32 bits y
+ * queda en Q30 tras desplazar 8.
+ */
+static const int32_t gyro_half_step_q38 =
+    (int32_t)(0.5 / MPU6050_ODR_HZ * PI_D / (180.0 * GYRO_LSB_PER_DPS) * 274877906944.0 + 0.5);
+
+/** Ganancias proporcionales por medio paso: Kp * T / 2, en Q30. */
+#define KP_STEP(kp)  ((int32_t)((kp) * 0.5 / MPU6050_ODR_HZ * 1073741824.0 + 0.5))
+
+static const int32_t kp_still_step  = KP_STEP(IMU_FUSION_KP_STILL);
+static const int32_t kp_motion_step = KP_STEP(IMU_FUSION_KP_MOTION);
+
+/** Integral por muestra: Ki * T² / 2, en Q46 (la corrección se guarda en Q46). */
+static const int64_t ki_step_q46 =
+    (int64_t)(IMU_FUSION_KI * 0.5 / ((double)MPU6050_ODR_HZ * MPU6050_ODR_HZ) * 70368744177664.0 + 0.5);
+
+/** Tope de la corrección integral (Q46 de medio paso). */
+static const int64_t max_bias_q46 =
+    ((int64_t)IMU_FUSION_MAX_BIAS_DPS * GYRO_LSB_PER_DPS * gyro_half_step_q38) << 8;
+
+/**
+ * @brief Producto en Q30.
+ */
+static inline int32_t mul30(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * b) >> IMU_FUSION_Q);
+}
+
+/**
+ * @brief Raíz cuadrada entera (bit a bit, sin divisiones).
+ */
+static uint32_t isqrt32(uint32_t v) {
+    uint32_t r   = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r  = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+/**
+ * @brief atan2(y, x) en grados Q16.16 por CORDIC; en @p mag (si no es
+ *        NULL) queda sqrt(x² + y²) en la escala de la entrada.
+ *
+ * |x| e |y| hasta 2^30: la ganancia del CORDIC (1,65) no desborda.
+ */
+static int32_t cordic_atan2(int32_t y, int32_t x, int32_t *mag) {
+    int32_t angle = 0;
+
+    // Al semiplano derecho con un giro de ±90°
+    if (x < 0) {
+        int32_t t = x;
+        if (y >= 0) {
+            x     = y;
+            y     = -t;
+            angle = IMU_FUSION_DEG(90);
+        } else {
+            x     = -y;
+            y     = t;
+            angle = -IMU_FUSION_DEG(90);
+        }
+    }
+
+    for (int i = 0; i < CORDIC_STEPS; i++) {
+        int32_t dx = x >> i;
+        int32_t dy = y >> i;
+        if (y > 0) {
+            x     += dy;
+            y     -= dx;
+            angle += cordic_atan[i];
+        } else {
+            x     -= dy;
+            y     += dx;
+            angle -= cordic_atan[i];
+        }
+    }
+
+    if (mag) *mag = mul30(x, CORDIC_INV_GAIN_Q30);
+    return angle;
+}
+
+/**
+ * @brief Gravedad estimada en ejes de la IMU (unitaria, Q30).
+ */
+static void quat_gravity(const imu_quat_t *q, int32_t *vx, int32_t *vy, int32_t *vz) {
+    *vx = 2 * (mul30(q->x, q->z) - mul30(q->w, q->y));
+    *vy = 2 * (mul30(q->w, q->x) + mul30(q->y, q->z));
+    *vz = mul30(q->w, q->w) - mul30(q->x, q->x) - mul30(q->y, q->y) + mul30(q->z, q->z);
+}
+
+/**
+ * @brief Orientación de menor giro que lleva la vertical a la gravedad
+ *        medida @p n (unitaria, Q30); el yaw de partida queda arbitrario.
+ *
+ * q = (1 + nz, ny, -nx, 0) / sqrt(2 (1 + nz)); cabeza abajo, 180° en X.
+ */
+static void quat_from_gravity(imu_quat_t *q, int32_t nx, int32_t ny, int32_t nz) {
+    if (nz >= Q30_ONE) nz = Q30_ONE - 1;
+
+    int32_t  c = Q30_ONE + nz;
+    uint32_t s = isqrt32((uint32_t)c * 2u);   // Q15
+
+    if (s < 64) {
+        q->w = 0;
+        q->x = Q30_ONE;
+        q->y = 0;
+        q->z = 0;
+        return;
+    }
+    q->w = (int32_t)(((int64_t)c << 15) / s);
+    q->x = (int32_t)(((int64_t)ny << 15) / s);
+    q->y = (int32_t)(((int64_t)-nx << 15) / s);
+    q->z = 0;
+}
+
+void imu_fusion_init(imu_fusion_t *f) {
+    f->q.w     = Q30_ONE;
+    f->q.x     = 0;
+    f->q.y     = 0;
+    f->q.z     = 0;
+    f->bias[0] = 0;
+    f->bias[1] = 0;
+    f->bias[2] = 0;
+    f->ready   = false;
+    f->still   = false;
+    f->samples = 0;
+}
+
+void imu_fusion_update(imu_fusion_t *f, const mpu6050_raw_t *raw) {
+    int32_t  ax  = raw->ax;
+    int32_t  ay  = raw->ay;
+    int32_t  az  = raw->az;
+    uint32_t mag = isqrt32((uint32_t)(ax * ax) + (uint32_t)(ay * ay) + (uint32_t)(az * az));
+    bool     accel_ok = mag > ACCEL_MIN && mag < ACCEL_MAX;
+
+    f->samples++;
+
+    // Gravedad medida, unitaria en Q30 (|a| < 2^15 y 2^30 / |a| < 2^16)
+    int32_t nx = 0, ny = 0, nz = 0;
+    if (accel_ok) {
+        int32_t inv = (int32_t)((uint32_t)Q30_ONE / mag);
+        nx = ax * inv;
+        ny = ay * inv;
+        nz = az * inv;
+    }
+
+    if (!f->ready) {
+        if (accel_ok) {
+            quat_from_gravity(&f->q, nx, ny, nz);
+            f->ready = true;
+        }
+        return;
+    }
+
+    // Medio giro de la muestra en Q30
+    int32_t hx = (raw->gx * gyro_half_step_q38) >> 8;
+    int32_t hy = (raw->gy * gyro_half_step_q38) >> 8;
+    int32_t hz = (raw->gz * gyro_half_step_q38) >> 8;
+
+    f->still = false;
+    if (accel_ok) {
+        int32_t vx, vy, vz;
+        quat_gravity(&f->q, &vx, &vy, &vz);
+
+        // Error: producto vectorial entre la gravedad medida y la estimada
+        int32_t ex = mul30(ny, vz) - mul30(nz, vy);
+        int32_t ey = mul30(nz, vx) - mul30(nx, vz);
+        int32_t ez = mul30(nx, vy) - mul30(ny, vx);
+
+        f->still = abs(raw->gx) < GYRO_STILL_LSB && abs(raw->gy) < GYRO_STILL_LSB &&
+                   abs(raw->gz) < GYRO_STILL_LSB &&
+                   mag > ACCEL_STILL_MIN && mag < ACCEL_STILL_MAX;
+
+        int32_t kp = f->still ? kp_still_step : kp_motion_step;
+        hx += mul30(ex, kp);
+        hy += mul30(ey, kp);
+        hz += mul30(ez, kp);
+
+        int32_t e[3] = { ex, ey, ez };
+        for (int i = 0; i < 3; i++) {
+            f->bias[i] += ((int64_t)e[i] * ki_step_q46) >> IMU_FUSION_Q;
+            if (f->bias[i] >  max_bias_q46) f->bias[i] =  max_bias_q46;
+            if (f->bias[i] < -max_bias_q46) f->bias[i] = -max_bias_q46;
+        }
+    }
+    hx += (int32_t)(f->bias[0] >> 16);
+    hy += (int32_t)(f->bias[1] >> 16);
+    hz += (int32_t)(f->bias[2] >> 16);
+
+    // q += q ⊗ (0, h)
+    imu_quat_t *q  = &f->q;
+    int32_t     qw = q->w, qx = q->x, qy = q->y, qz = q->z;
+
+    q->w += -mul30(qx, hx) - mul30(qy, hy) - mul30(qz, hz);
+    q->x +=  mul30(qw, hx) + mul30(qy, hz) - mul30(qz, hy);
+    q->y +=  mul30(qw, hy) - mul30(qx, hz) + mul30(qz, hx);
+    q->z +=  mul30(qw, hz) + mul30(qx, hy) - mul30(qy, hx);
+
+    // Normalización con un paso de Newton: 1/sqrt(n) ~ (3 - n) / 2 cerca de 1
+    int32_t n2  = mul30(q->w, q->w) + mul30(q->x, q->x) + mul30(q->y, q->y) + mul30(q->z, q->z);
+    int32_t inv = Q30_ONE + ((Q30_ONE - n2) >> 1);
+
+    q->w = mul30(q->w, inv);
+    q->x = mul30(q->x, inv);
+    q->y = mul30(q->y, inv);
+    q->z = mul30(q->z, inv);
+}
+
+imu_euler_t imu_fusion_euler(const imu_fusion_t *f) {
+    const imu_quat_t *q = &f->q;
+    imu_euler_t       e;
+    int32_t           vx, vy, vz, r;
+
+    quat_gravity(q, &vx, &vy, &vz);
+    e.roll  = cordic_atan2(vy, vz, &r);
+    e.pitch = cordic_atan2(-vx, r, NULL);
+
+    // atan2(2 (wz + xy), 1 - 2 (y² + z²)), a la mitad para no desbordar
+    int32_t sy = mul30(q->w, q->z) + mul30(q->x, q->y);
+    int32_t cy = (Q30_ONE >> 1) - mul30(q->y, q->y) - mul30(q->z, q->z);
+    e.yaw = cordic_atan2(sy, cy, NULL);
+    return e;
+}
+
+int32_t imu_fusion_gyro_dps(int16_t raw) {
+    // 65536 / 131 = 500,27 en Q7, sin desbordar con |raw| = 32768
+    return (raw * 64035) >> 7;
+}
+
+bool imu_fusion_is_vertical(const imu_euler_t *e) {
+    return abs(e->pitch) > IMU_FUSION_DEG(60) || abs(e->roll) > IMU_FUSION_DEG(60);
+}
+
+bool imu_fusion_is_horizontal(const imu_euler_t *e) {
+    return abs(e->pitch) < IMU_FUSION_DEG(30) && abs(e->roll) < IMU_FUSION_DEG(30);
+}
+
+/**
+ * @brief Grados Q16.16 a décimas, redondeando.
+ */
+static long deg_tenths(int32_t q16) {
+    return (long)(((int64_t)q16 * 10 + 32768) >> 16);
+}
+
+/**
+ * @brief Corrección integral a décimas de °/s.
+ */
+static long bias_tenths_dps(int64_t bias_q46) {
+    return (long)((bias_q46 >> 8) * 10 / ((int64_t)gyro_half_step_q38 * GYRO_LSB_PER_DPS));
+}
+
+void imu_fusion_print(const imu_fusion_t *f) {
+    if (!f->ready) {
+        printf("  Orientación: sin muestras válidas\n");
+        return;
+    }
+
+    imu_euler_t e = imu_fusion_euler(f);
+    long p = deg_tenths(e.pitch);
+    long r = deg_tenths(e.roll);
+    long y = deg_tenths(e.yaw);
+
+    printf("  Orientación: pitch %s%ld.%ld, roll %s%ld.%ld, yaw %s%ld.%ld grados (%s)\n",
+           p < 0 ? "-" : "", labs(p) / 10, labs(p) % 10,
+           r < 0 ? "-" : "", labs(r) / 10, labs(r) % 10,
+           y < 0 ? "-" : "", labs(y) / 10, labs(y) % 10,
+           f->still ? "quieta" : "en movimiento");
+
+    long bx = bias_tenths_dps(f->bias[0]);
+    long by = bias_tenths_dps(f->bias[1]);
+    printf("  Corrección integral del giroscopio: x %s%ld.%ld, y %s%ld.%ld grados/s, %lu muestras\n",
+           bx < 0 ? "-" : "", labs(bx) / 10, labs(bx) % 10,
+           by < 0 ? "-" : "", labs(by) / 10, labs(by) % 10,
+           (unsigned long)f->samples);
+}
@@ -0,0 +1,125 @@
+/**
+ * @file imu_fusion.h
+ * @brief Fusión de acelerómetro y giroscopio en punto fijo (filtro de
+ *        Mahony) para la orientación de la IMU.
+ *
+ * Cada muestra de la FIFO del MPU6050 avanza un cuaternión en Q2.30 con
+ * el giroscopio (paso fijo de 1 / MPU6050_ODR_HZ: el reloj de la IMU marca
+ * las muestras, no la hora de llegada) y lo corrige hacia la gravedad que
+ * mide el acelerómetro con una realimentación proporcional e integral. La
+ * parte integral estima el sesgo del giroscopio en pitch y roll; el yaw
+ * solo se integra (sin magnetómetro su deriva no se corrige).
+ *
+ * La ganancia proporcional depende del movimiento:
+ *  - Quieto (giroscopio bajo IMU_FUSION_STILL_DPS y |a| a menos de 10 %
+ *    de 1 g): IMU_FUSION_KP_STILL, el acelerómetro manda.
+ *  - En movimiento: IMU_FUSION_KP_MOTION, el giroscopio manda y el ruido
+ *    del acelerómetro apenas pasa.
+ *  - |a| a más de 25 % de 1 g: sin corrección.
+ *
+ * Solo usa multiplicaciones y desplazamientos enteros, una raíz entera y
+ * una división de 32 bits (divisor por hardware del RP2040) por muestra.
+ * Los ángulos salen en grados Q16.16 con un CORDIC de 16 pasos.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef IMU_FUSION_H
+#define IMU_FUSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mpu6050.h"
+
+/** Bits fraccionarios del cuaternión (Q2.30). */
+#define IMU_FUSION_Q  30
+
+/** Grados en Q16.16. */
+#define IMU_FUSION_DEG(d)  ((int32_t)((d) * 65536))
+
+/** Ganancia proporcional con la IMU quieta (1/s). */
+#define IMU_FUSION_KP_STILL   8.0
+
+/** Ganancia proporcional en movimiento (1/s). */
+#define IMU_FUSION_KP_MOTION  0.5
+
+/** Ganancia integral (estimación del sesgo del giroscopio, 1/s²). */
+#define IMU_FUSION_KI         0.05
+
+/** Velocidad angular por debajo de la cual la IMU se considera quieta (°/s). */
+#define IMU_FUSION_STILL_DPS  8
+
+/** Sesgo máximo que puede estimar la parte integral (°/s). */
+#define IMU_FUSION_MAX_BIAS_DPS  20
+
+/**
+ * @brief Cuaternión de orientación en Q2.30.
+ */
+typedef struct {
+    int32_t w, x, y, z;
+} imu_quat_t;
+
+/**
+ * @brief Ángulos de Tait-Bryan (ZYX) en grados Q16.16.
+ */
+typedef struct {
+    int32_t pitch;  /**< Giro en Y, de -90 a 90. */
+    int32_t roll;   /**< Giro en X, de -180 a 180. */
+    int32_t yaw;    /**< Giro en Z, de -180 a 180 (con deriva). */
+} imu_euler_t;
+
+/**
+ * @brief Estado del filtro.
+ */
+typedef struct {
+    imu_quat_t q;           /**< Orientación actual. */
+    int64_t    bias[3];     /**< Corrección integral por eje (medio paso, Q46). */
+    bool       ready;       /**< false hasta la primera muestra válida. */
+    bool       still;       /**< La última muestra usó la ganancia de quieto. */
+    uint32_t   samples;     /**< Muestras procesadas. */
+} imu_fusion_t;
+
+/**
+ * @brief Deja el filtro sin orientación: la primera muestra con |a|
+ *        válido la toma directamente del acelerómetro.
+ */
+void imu_fusion_init(imu_fusion_t *f);
+
+/**
+ * @brief Procesa una muestra de la IMU (escalas ±2 g y ±250 °/s).
+ */
+void imu_fusion_update(imu_fusion_t *f, const mpu6050_raw_t *raw);
+
+/**
+ * @brief Pitch, roll y yaw de la orientación actual.
+ *
+ * Pitch y roll son los de calc_pitch() y calc_roll() aplicados a la
+ * gravedad estimada en lugar de la medida.
+ */
+imu_euler_t imu_fusion_euler(const imu_fusion_t *f);
+
+/**
+ * @brief Velocidad angular cruda del giroscopio en °/s Q16.16.
+ */
+int32_t imu_fusion_gyro_dps(int16_t raw);
+
+/**
+ * @brief Vertical si |pitch| o |roll| superan 60° (como is_vertical()).
+ */
+bool imu_fusion_is_vertical(const imu_euler_t *e);
+
+/**
+ * @brief Horizontal si |pitch| y |roll| están bajo 30° (como is_horizontal()).
+ */
+bool imu_fusion_is_horizontal(const imu_euler_t *e);
+
+/**
+ * @brief Imprime la orientación y el modo del filtro.
+ */
+void imu_fusion_print(const imu_fusion_t *f);
+
+#endif // IMU_FUSION_H
@@ -13,6 +13,8 @@
 
 #include "button_controller.h"
 #include "botones.h"
+#include "latency_probe.h"
+#include "event_loop.h"
 
 /** Tabla de botones de notas musicales. */
 static button_t buttons[7] = {
@@ -27,6 +29,12 @@ static button_t buttons[7] = {
 
 /** Flags de interrupción para botones de nota. */
 static volatile bool note_irq_flags[7] = {0};
+/** Instante (us) del último flanco de subida de cada nota. */
+static volatile uint32_t note_rise_us[7] = {0};
+/** Último flanco de subida de cualquier nota. */
+static volatile uint32_t last_rise_us = 0;
+/** Alarma de asentamiento de sueltas en curso. */
+static volatile bool settle_armed = false;
 /** Timestamps para debounce de notas. */
 static uint32_t last_event_time_notas[7] = {0};
 
@@ -62,19 +70,52 @@ static int selector_index_from_gpio(uint gpio) {
     return -1;
 }
 
+/**
+ * @brief Alarma de asentamiento de las sueltas: avisa al bucle principal
+ *        cuando el último flanco de subida cumple BUTTON_RELEASE_SETTLE_MS.
+ *
+ * Si llegó otro flanco mientras tanto, se reprograma desde él.
+ */
+static int64_t settle_alarm_cb(alarm_id_t id, void *user_data) {
+    (void)id;
+    (void)user_data;
+
+    uint32_t elapsed = time_us_32() - last_rise_us;
+    if (elapsed < BUTTON_RELEASE_SETTLE_MS * 1000u) {
+        return -(int64_t)(BUTTON_RELEASE_SETTLE_MS * 1000u - elapsed);
+    }
+    settle_armed = false;
+    event_loop_post(EVENT_BUTTON);
+    return 0;
+}
+
 /**
  * @brief Callback de interrupción común para todos los botones.
- * Detecta flanco de bajada y establece flags correspondientes.
+ * Detecta flanco de bajada y establece flags correspondientes; en las
+ * notas registra además el último flanco de subida (suelta).
  */
 static void gpio_irq_handler(uint gpio, uint32_t events) {
-    if (!(events & GPIO_IRQ_EDGE_FALL)) return;
+    event_loop_post(EVENT_BUTTON);
 
     int n = note_index_from_gpio(gpio);
     if (n >= 0) {
-        note_irq_flags[n] = true;
+        if (events & GPIO_IRQ_EDGE_RISE) {
+            note_rise_us[n] = time_us_32();
+            last_rise_us    = note_rise_us[n];
+            if (!settle_armed) {
+                settle_armed = add_alarm_in_us(BUTTON_RELEASE_SETTLE_MS * 1000u,
+                                               settle_alarm_cb, NULL, true) > 0;
+            }
+        }
+        if (events & GPIO_IRQ_EDGE_FALL) {
+            latency_probe_mark(LATENCY_IRQ);
+            note_irq_flags[n] = true;
+        }
         return;
     }
 
+    if (!(events & GPIO_IRQ_EDGE_FALL)) return;
+
     int s = selector_index_from_gpio(gpio);
     if (s >= 0) {
         selector_irq_flags[s] = true;
@@ -94,11 +135,12 @@ void button_controller_init(void) {
         gpio_pull_up(buttons[i].gpio);
 
         note_irq_flags[i] = false;
+        buttons[i].was_pressed = false;
         last_event_time_notas[i] = now;
 
         gpio_set_irq_enabled_with_callback(
             buttons[i].gpio,
-            GPIO_IRQ_EDGE_FALL,
+            GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE,
             true,
             gpio_irq_handler
         );
@@ -106,10 +148,19 @@ void button_controller_init(void) {
 }
 
 /**
- * @brief Procesa las notas, aplicando debounce y devolviendo la nota presionada.
- * @return Índice 0..6 si hay nota válida, -1 si no.
+ * @brief Procesa las notas, aplicando debounce y devolviendo la nota
+ *        presionada o soltada.
+ *
+ * La pulsación se acepta en el primer flanco de bajada (sin esperar a que
+ * el contacto se asiente, para no sumar latencia). La suelta se acepta
+ * cuando el pin lleva BUTTON_RELEASE_SETTLE_MS en alto desde su último
+ * flanco de subida: los rebotes del contacto al pulsar lo devuelven a bajo
+ * antes de ese plazo.
+ *
+ * @param edge Devuelve BUTTON_PRESS o BUTTON_RELEASE.
+ * @return Índice 0..6 si hay evento válido, -1 si no.
  */
-int button_controller_process(void) {
+int button_controller_process(button_edge_t *edge) {
     const uint32_t DEBOUNCE_MS = 120;
     uint32_t now = to_ms_since_boot(get_absolute_time());
 
@@ -119,13 +170,50 @@ int button_controller_process(void) {
 
             if (now - last_event_time_notas[i] >= DEBOUNCE_MS) {
                 last_event_time_notas[i] = now;
+                buttons[i].was_pressed = true;
+                *edge = BUTTON_PRESS;
                 return i;
             }
         }
     }
+
+    uint32_t now_us = time_us_32();
+    for (int i = 0; i < 7; i++) {
+        if (buttons[i].was_pressed && gpio_get(buttons[i].gpio) &&
+            now_us - note_rise_us[i] >= BUTTON_RELEASE_SETTLE_MS * 1000u) {
+            buttons[i].was_pressed = false;
+            *edge = BUTTON_RELEASE;
+            return i;
+        }
+    }
     return -1;
 }
 
+uint32_t button_controller_wake_pins(void) {
+    uint32_t pins = (1u << BTN_SLOT) | (1u << BTN_NEXT) | (1u << BTN_PREV);
+
+    for (int i = 0; i < 7; i++) {
+        pins |= 1u << buttons[i].gpio;
+    }
+    return pins;
+}
+
+void button_controller_wake(void) {
+    uint selector_pins[3] = { BTN_SLOT, BTN_NEXT, BTN_PREV };
+
+    for (int i = 0; i < 7; i++) {
+        if (!gpio_get(buttons[i].gpio)) {
+            note_irq_flags[i] = true;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        if (!gpio_get(selector_pins[i])) {
+            selector_irq_flags[i] = true;
+        }
+    }
+    event_loop_post(EVENT_BUTTON);
+}
+
 /**
  * @brief Obtiene el nombre de una nota según su índice.
  * @param index Índice 0..6.
@@ -27,7 +27,7 @@
 
 #include "instrumentos.h"
 #include "sistema.h"
-#include "lcd.h"
+#include "LCD.h"
 #include "botones.h"
 
 
@@ -0,0 +1,340 @@
+/**
+ * @file latency_probe.c
+ * @brief Implementación de la sonda de latencia botón → sonido.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "latency_probe.h"
+#include "i2s_output.h"
+#include "audio_player.h"
+#include "button_controller.h"
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+
+static const char *stage_names[LATENCY_STAGES] = {
+    "disparo", "IRQ GPIO", "sondeo", "cola", "core1", "voz", "mezcla", "FIFO PIO"
+};
+
+static spin_lock_t *probe_lock = NULL;
+
+// Pulsación en curso
+static volatile bool in_flight  = false;
+static volatile int  next_stage = LATENCY_STAGES;
+static int           first_stage;
+static uint32_t      stamp[LATENCY_STAGES];
+static uint32_t      mix_offset;             // frame no silencioso dentro del bloque
+static bool          wake_flight = false;    // la pulsación en curso es un despertar
+
+// Despertares medidos (flanco -> FIFO), aparte de los percentiles
+static uint32_t wake_count = 0;
+static uint32_t wake_last  = 0;
+static uint32_t wake_max   = 0;
+
+// Pulsaciones completas: instante de cada etapa relativo a la primera
+static uint32_t samples[LATENCY_PROBE_MAX_PRESSES][LATENCY_STAGES];
+static uint8_t  sample_first[LATENCY_PROBE_MAX_PRESSES];
+static uint32_t sample_count = 0;
+static uint32_t dropped      = 0;
+
+// Modos
+static volatile bool     manual_mode      = false;
+static volatile bool     scripted_running = false;
+static volatile uint32_t scripted_left    = 0;
+static uint32_t          scripted_tick    = 0;
+static repeating_timer_t scripted_timer;
+
+/**
+ * @brief Descarta la pulsación en curso si superó el tiempo máximo.
+ *
+ * Llamar con el spinlock tomado.
+ */
+static void probe_expire(uint32_t now) {
+    if (in_flight && now - stamp[first_stage] > LATENCY_PROBE_TIMEOUT_MS * 1000u) {
+        in_flight  = false;
+        next_stage = LATENCY_STAGES;
+        if (wake_flight) {
+            wake_flight = false;
+        } else {
+            dropped++;
+        }
+    }
+}
+
+/**
+ * @brief Guarda la pulsación en curso, ya con todas sus etapas.
+ *
+ * Llamar con el spinlock tomado.
+ */
+static void probe_finish(void) {
+    if (wake_flight) {
+        wake_last = stamp[LATENCY_FIFO] - stamp[LATENCY_IRQ];
+        if (wake_last > wake_max) wake_max = wake_last;
+        wake_count++;
+        wake_flight = false;
+        in_flight   = false;
+        next_stage  = LATENCY_STAGES;
+        return;
+    }
+
+    uint32_t i = sample_count % LATENCY_PROBE_MAX_PRESSES;
+
+    for (int s = 0; s < LATENCY_STAGES; s++) {
+        samples[i][s] = (s >= first_stage) ? stamp[s] - stamp[first_stage] : 0;
+    }
+    sample_first[i] = (uint8_t)first_stage;
+    sample_count++;
+
+    in_flight  = false;
+    next_stage = LATENCY_STAGES;
+}
+
+/**
+ * @brief Tick del modo guiado: pulsa, suelta y espera al siguiente periodo.
+ */
+static bool scripted_tick_cb(repeating_timer_t *rt) {
+    (void)rt;
+    const uint32_t ticks = LATENCY_PROBE_PERIOD_MS / LATENCY_PROBE_HOLD_MS;
+
+    if (scripted_tick == 0) {
+        if (scripted_left == 0) {
+            scripted_running = false;
+            return false;
+        }
+        scripted_left--;
+        latency_probe_mark(LATENCY_TRIGGER);
+        gpio_set_inover(BTN_DO, GPIO_OVERRIDE_LOW);
+    } else if (scripted_tick == 1) {
+        gpio_set_inover(BTN_DO, GPIO_OVERRIDE_NORMAL);
+    }
+
+    scripted_tick = (scripted_tick + 1) % ticks;
+    return true;
+}
+
+/**
+ * @brief Percentil por rango más cercano de un arreglo ordenado.
+ */
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t p) {
+    uint32_t rank = (p * n + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * @brief Ordena de menor a mayor (inserción; n es pequeño).
+ */
+static void sort_u32(uint32_t *v, uint32_t n) {
+    for (uint32_t i = 1; i < n; i++) {
+        uint32_t x = v[i];
+        uint32_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+/**
+ * @brief Imprime una fila del informe.
+ */
+static void print_row(const char *from, const char *to, uint32_t *v, uint32_t n) {
+    if (n == 0) return;
+    sort_u32(v, n);
+    printf("  %-9s -> %-9s %4lu %7lu %7lu %7lu %7lu\n", from, to,
+           (unsigned long)n,
+           (unsigned long)percentile(v, n, 50),
+           (unsigned long)percentile(v, n, 90),
+           (unsigned long)percentile(v, n, 99),
+           (unsigned long)v[n - 1]);
+}
+
+
+// API
+
+void latency_probe_init(void) {
+    if (!probe_lock) {
+        probe_lock = spin_lock_instance((uint)spin_lock_claim_unused(true));
+    }
+    latency_probe_reset();
+}
+
+void latency_probe_set_manual(bool enable) {
+    manual_mode = enable;
+}
+
+bool latency_probe_manual(void) {
+    return manual_mode;
+}
+
+bool latency_probe_start_scripted(uint32_t presses) {
+    if (scripted_running || presses == 0) return false;
+
+    latency_probe_reset();
+    scripted_left    = presses;
+    scripted_tick    = 0;
+    scripted_running = true;
+
+    if (!add_repeating_timer_ms(LATENCY_PROBE_HOLD_MS, scripted_tick_cb, NULL, &scripted_timer)) {
+        printf("Error: sin temporizador para la medición guiada\n");
+        scripted_running = false;
+        return false;
+    }
+    return true;
+}
+
+bool latency_probe_scripted_running(void) {
+    return scripted_running;
+}
+
+void latency_probe_start_wake(uint32_t edge_us) {
+    if (!probe_lock) return;
+    uint32_t save = spin_lock_blocking(probe_lock);
+
+    first_stage         = LATENCY_IRQ;
+    stamp[LATENCY_IRQ]  = edge_us;
+    next_stage          = LATENCY_POLL;
+    in_flight           = true;
+    wake_flight         = true;
+
+    spin_unlock(probe_lock, save);
+}
+
+bool latency_probe_mark(latency_stage_t stage) {
+    uint32_t now = time_us_32();
+    bool     ok  = false;
+
+    if (!probe_lock) return false;
+    uint32_t save = spin_lock_blocking(probe_lock);
+
+    probe_expire(now);
+
+    if (!in_flight) {
+        bool start = (stage == LATENCY_TRIGGER && scripted_running) ||
+                     (stage == LATENCY_IRQ && manual_mode && !scripted_running);
+        if (start) {
+            first_stage   = (int)stage;
+            stamp[stage]  = now;
+            next_stage    = (int)stage + 1;
+            in_flight     = true;
+            ok = true;
+        }
+    } else if ((int)stage == next_stage && stage < LATENCY_MIX) {
+        stamp[stage] = now;
+        next_stage++;
+        ok = true;
+    }
+
+    spin_unlock(probe_lock, save);
+    return ok;
+}
+
+void latency_probe_block(const uint32_t *frames, uint32_t seq) {
+    if (!in_flight || next_stage != LATENCY_MIX) return;
+
+    uint32_t n;
+    for (n = 0; n < I2S_BLOCK_FRAMES; n++) {
+        int32_t l = (int16_t)(frames[n] & 0xFFFFu);
+        int32_t r = (int16_t)(frames[n] >> 16);
+        if (l > LATENCY_PROBE_THRESHOLD || l < -LATENCY_PROBE_THRESHOLD ||
+            r > LATENCY_PROBE_THRESHOLD || r < -LATENCY_PROBE_THRESHOLD) {
+            break;
+        }
+    }
+    if (n == I2S_BLOCK_FRAMES) return;
+
+    uint32_t now  = time_us_32();
+    uint32_t save = spin_lock_blocking(probe_lock);
+    if (in_flight && next_stage == LATENCY_MIX) {
+        stamp[LATENCY_MIX] = now;
+        mix_offset         = n;
+        next_stage         = LATENCY_FIFO;
+        i2s_output_watch_block(seq);
+    }
+    spin_unlock(probe_lock, save);
+}
+
+void latency_probe_service(void) {
+    uint32_t start_us;
+
+    if (!in_flight || next_stage != LATENCY_FIFO) return;
+    if (!i2s_output_watch_done(&start_us)) return;
+
+    uint32_t save = spin_lock_blocking(probe_lock);
+    if (in_flight && next_stage == LATENCY_FIFO) {
+        stamp[LATENCY_FIFO] = start_us +
+                              (uint32_t)(((uint64_t)mix_offset * 1000000u) / AUDIO_OUTPUT_RATE);
+        probe_finish();
+    }
+    spin_unlock(probe_lock, save);
+}
+
+void latency_probe_reset(void) {
+    if (!probe_lock) return;
+    uint32_t save = spin_lock_blocking(probe_lock);
+    in_flight    = false;
+    wake_flight  = false;
+    next_stage   = LATENCY_STAGES;
+    sample_count = 0;
+    dropped      = 0;
+    wake_count   = 0;
+    wake_last    = 0;
+    wake_max     = 0;
+    spin_unlock(probe_lock, save);
+}
+
+void latency_probe_print(void) {
+    static uint32_t copy[LATENCY_PROBE_MAX_PRESSES][LATENCY_STAGES];
+    static uint8_t  first[LATENCY_PROBE_MAX_PRESSES];
+    uint32_t        v[LATENCY_PROBE_MAX_PRESSES];
+
+    if (!probe_lock) return;
+
+    // Copia coherente; el ordenamiento se hace fuera del spinlock
+    uint32_t save = spin_lock_blocking(probe_lock);
+    probe_expire(time_us_32());
+    uint32_t total  = sample_count;
+    uint32_t lost   = dropped;
+    uint32_t wakes  = wake_count;
+    uint32_t w_last = wake_last;
+    uint32_t w_max  = wake_max;
+    uint32_t n     = (total < LATENCY_PROBE_MAX_PRESSES) ? total : LATENCY_PROBE_MAX_PRESSES;
+    for (uint32_t i = 0; i < n; i++) {
+        for (int s = 0; s < LATENCY_STAGES; s++) copy[i][s] = samples[i][s];
+        first[i] = sample_first[i];
+    }
+    spin_unlock(probe_lock, save);
+
+    printf("--- Latencia botón -> sonido (us) ---\n");
+    printf("Pulsaciones: %lu medidas (%lu en el informe), %lu descartadas%s%s\n",
+           (unsigned long)total, (unsigned long)n, (unsigned long)lost,
+           scripted_running ? " | medición guiada en curso" : "",
+           manual_mode ? " | modo manual" : "");
+    if (wakes > 0) {
+        printf("Despertar -> FIFO PIO: %lu veces, último %lu us, max %lu us\n",
+               (unsigned long)wakes, (unsigned long)w_last, (unsigned long)w_max);
+    }
+    if (n == 0) return;
+
+    printf("  %-9s    %-9s %4s %7s %7s %7s %7s\n", "etapa", "", "n", "p50", "p90", "p99", "max");
+    for (int s = LATENCY_IRQ; s < LATENCY_STAGES; s++) {
+        uint32_t m = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (first[i] < s) v[m++] = copy[i][s] - copy[i][s - 1];
+        }
+        print_row(stage_names[s - 1], stage_names[s], v, m);
+    }
+
+    // Total común a ambos modos: desde la IRQ GPIO
+    for (uint32_t i = 0; i < n; i++) {
+        v[i] = copy[i][LATENCY_FIFO] - copy[i][LATENCY_IRQ];
+    }
+    print_row(stage_names[LATENCY_IRQ], stage_names[LATENCY_FIFO], v, n);
+}
@@ -0,0 +1,157 @@
+/**
+ * @file latency_probe.h
+ * @brief Medición de la latencia entre pulsar un botón y oír la nota.
+ *
+ * Cada pulsación recorre el camino completo del instrumento y cada etapa
+ * marca su instante con el temporizador de hardware (time_us_32()):
+ *  - LATENCY_TRIGGER: el modo guiado fuerza el botón Do a nivel bajo.
+ *  - LATENCY_IRQ:     la IRQ GPIO ve el flanco de bajada.
+ *  - LATENCY_POLL:    el bucle principal acepta la pulsación (antirrebote).
+ *  - LATENCY_SEND:    la nota entra a la cola del motor de audio.
+ *  - LATENCY_CORE1:   core1 saca el comando de la cola.
+ *  - LATENCY_VOICE:   la voz queda publicada a la mezcla.
+ *  - LATENCY_MIX:     se entrega al anillo I2S el primer bloque con un
+ *                     frame no silencioso.
+ *  - LATENCY_FIFO:    ese frame entra al FIFO del PIO (inicio del bloque en
+ *                     el DMA más la posición del frame dentro del bloque).
+ *
+ * Solo hay una pulsación en curso a la vez; cada etapa se registra una vez
+ * y en orden, así que los rebotes y los botones pulsados durante la medición
+ * no la alteran. Una pulsación que no llega al FIFO en
+ * LATENCY_PROBE_TIMEOUT_MS se descarta y se cuenta.
+ *
+ * Dos modos:
+ *  - Manual: cada pulsación real de un botón de nota se mide desde la IRQ.
+ *  - Guiado: un temporizador repetitivo pulsa el botón Do mediante el
+ *    override de entrada del GPIO, con periodo fijo, para obtener números
+ *    reproducibles entre compilaciones (el instrumento y sus notas deben
+ *    ser los mismos en cada corrida).
+ *
+ * Además se mide siempre el despertar del bajo consumo: desde el flanco
+ * que despierta al chip hasta que la nota llega al FIFO
+ * (latency_probe_start_wake()). Se informa aparte y no entra en los
+ * percentiles.
+ *
+ * Las marcas pueden llegar desde ambos núcleos y desde IRQs; el estado se
+ * protege con un spinlock de hardware.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Pulsaciones guardadas para los percentiles (las más recientes). */
+#define LATENCY_PROBE_MAX_PRESSES  64
+
+/** Tiempo máximo desde el inicio de una pulsación hasta el FIFO. */
+#define LATENCY_PROBE_TIMEOUT_MS   1000
+
+/** Amplitud mínima para considerar un frame como no silencioso. */
+#define LATENCY_PROBE_THRESHOLD    64
+
+/** Periodo del modo guiado (mayor que el antirrebote de los botones). */
+#define LATENCY_PROBE_PERIOD_MS    300
+
+/** Tiempo que el modo guiado mantiene pulsado el botón. */
+#define LATENCY_PROBE_HOLD_MS      20
+
+/**
+ * @brief Etapas del camino botón → sonido, en orden.
+ */
+typedef enum {
+    LATENCY_TRIGGER = 0,
+    LATENCY_IRQ,
+    LATENCY_POLL,
+    LATENCY_SEND,
+    LATENCY_CORE1,
+    LATENCY_VOICE,
+    LATENCY_MIX,
+    LATENCY_FIFO,
+    LATENCY_STAGES
+} latency_stage_t;
+
+/**
+ * @brief Inicializa la sonda (sin medición activa).
+ */
+void latency_probe_init(void);
+
+/**
+ * @brief Activa o desactiva la medición de pulsaciones reales.
+ */
+void latency_probe_set_manual(bool enable);
+
+/**
+ * @brief Indica si la medición manual está activa.
+ */
+bool latency_probe_manual(void);
+
+/**
+ * @brief Inicia una corrida guiada de @p presses pulsaciones del botón Do.
+ *
+ * Borra las muestras anteriores. El audio debe estar funcionando y el
+ * instrumento seleccionado; al terminar se puede imprimir el informe.
+ *
+ * @return false si ya hay una corrida en curso.
+ */
+bool latency_probe_start_scripted(uint32_t presses);
+
+/**
+ * @brief Indica si la corrida guiada sigue en curso.
+ */
+bool latency_probe_scripted_running(void);
+
+/**
+ * @brief Inicia la medición del despertar: la pulsación que despertó al
+ *        chip, con LATENCY_IRQ en @p edge_us.
+ *
+ * Reemplaza la pulsación en curso, si la hay.
+ *
+ * @param edge_us Instante del flanco en la escala de time_us_32() (ver
+ *        power_manager_wake_us()).
+ */
+void latency_probe_start_wake(uint32_t edge_us);
+
+/**
+ * @brief Marca el instante de una etapa de la pulsación en curso.
+ *
+ * Se ignora si no hay pulsación en curso, si la etapa ya se registró o si
+ * la anterior aún no. En modo manual, LATENCY_IRQ inicia la pulsación.
+ *
+ * @return true si la marca se registró.
+ */
+bool latency_probe_mark(latency_stage_t stage);
+
+/**
+ * @brief Revisa un bloque recién entregado al anillo I2S (IRQ de mezcla).
+ *
+ * Con la voz ya publicada, busca el primer frame no silencioso; si lo
+ * encuentra marca LATENCY_MIX y vigila el bloque @p seq en el DMA.
+ */
+void latency_probe_block(const uint32_t *frames, uint32_t seq);
+
+/**
+ * @brief Completa LATENCY_FIFO cuando el DMA empezó el bloque vigilado.
+ *
+ * Se llama desde la IRQ de mezcla, antes de producir bloques.
+ */
+void latency_probe_service(void);
+
+/**
+ * @brief Borra las muestras y los contadores.
+ */
+void latency_probe_reset(void);
+
+/**
+ * @brief Imprime p50/p90/p99/máximo de cada etapa y del total.
+ */
+void latency_probe_print(void);
+
+#endif // LATENCY_PROBE_H
@@ -3,7 +3,7 @@
  * @brief Rutinas para manejo de LCD 16x2 mediante interface I2C PCF8574.
  */
 
-#include "lcd.h"
+#include "LCD.h"
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include <stdio.h>
@@ -17,6 +17,9 @@
 #define SCL_PIN  3
 #define LCD_ADDR 0x27
 
+/** Bit de luz de fondo del PCF8574 (0 con la pantalla apagada). */
+static uint8_t lcd_backlight = 0x08;
+
 /**
  * @brief Envía un byte crudo al LCD por I2C.
  */
@@ -29,7 +32,7 @@ static void lcd_send_raw(uint8_t data) {
  */
 static void lcd_pulse(uint8_t data) {
     const uint8_t EN = 0x04;
-    const uint8_t BL = 0x08;
+    const uint8_t BL = lcd_backlight;
 
     uint8_t a = data | EN | BL;
     uint8_t b = data | BL;
@@ -96,7 +99,7 @@ void lcd_clear() {
  * @brief Inicializa la LCD por I2C en modo 4 bits.
  */
 void lcd_init() {
-    i2c_init(I2C_PORT, 100000);
+    i2c_init(I2C_PORT, LCD_BAUD);
     gpio_set_function(SDA_PIN, GPIO_FUNC_I2C);
     gpio_set_function(SCL_PIN, GPIO_FUNC_I2C);
     gpio_pull_up(SDA_PIN);
@@ -114,6 +117,18 @@ void lcd_init() {
     printf("LCD inicializada\n");
 }
 
+/**
+ * @brief Display on/off (0x0C / 0x08) y luz de fondo.
+ */
+void lcd_set_power(bool on) {
+    lcd_backlight = on ? 0x08 : 0x00;
+    lcd_send(on ? 0x0C : 0x08, 0);
+}
+
+void lcd_clock_changed(void) {
+    i2c_set_baudrate(I2C_PORT, LCD_BAUD);
+}
+
 /**
  * @brief Muestra el estado actual de instrumentos en dos filas.
  */
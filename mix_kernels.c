@@ -0,0 +1,442 @@
+/**
+ * @file mix_kernels.c
+ * @brief Implementación de los kernels de mezcla y de su medición.
+ *
+ * Los kernels se ubican en RAM (__time_critical_func) para que su costo no
+ * dependa de los fallos de la caché XIP de la flash.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "mix_kernels.h"
+#include "adpcm.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "benchmark.h"
+#include "hardware/structs/systick.h"
+#include <string.h>
+
+/** Frames usados en la medición. */
+#define MIX_BENCH_FRAMES  256
+
+/** Muestra baja (L o primer frame mono) de una palabra. */
+#define LO16(w)  ((int32_t)(int16_t)(w))
+
+/** Muestra alta (R o segundo frame mono) de una palabra. */
+#define HI16(w)  ((int32_t)(w) >> 16)
+
+static inline int32_t abs32(int32_t s) {
+    return (s < 0) ? -s : s;
+}
+
+static inline uint16_t peak16(int32_t p) {
+    return (p > 0xFFFF) ? 0xFFFF : (uint16_t)p;
+}
+
+// Mono -> estéreo
+
+static uint16_t __time_critical_func(mix_mono)(const uint8_t *src, int32_t *acc,
+                                               uint32_t frames, int32_t gain_q8) {
+    (void)gain_q8;
+    const int16_t *s16  = (const int16_t *)src;
+    int32_t        peak = 0;
+
+    // Llevar la lectura a un límite de palabra
+    if (((uintptr_t)s16 & 2u) && frames > 0) {
+        int32_t s = *s16++;
+        acc[0] += s; acc[1] += s;
+        acc += 2; frames--;
+        peak = abs32(s);
+    }
+
+    const uint32_t *w = (const uint32_t *)s16;
+    while (frames >= 4) {
+        uint32_t w0 = w[0];
+        uint32_t w1 = w[1];
+        int32_t  s0 = LO16(w0), s1 = HI16(w0);
+        int32_t  s2 = LO16(w1), s3 = HI16(w1);
+
+        acc[0] += s0; acc[1] += s0;
+        acc[2] += s1; acc[3] += s1;
+        acc[4] += s2; acc[5] += s2;
+        acc[6] += s3; acc[7] += s3;
+
+        // Pico muestreado cada 4 frames: basta para elegir la voz a robar
+        int32_t a = abs32(s0);
+        if (a > peak) peak = a;
+
+        w += 2; acc += 8; frames -= 4;
+    }
+
+    s16 = (const int16_t *)w;
+    while (frames--) {
+        int32_t s = *s16++;
+        acc[0] += s; acc[1] += s;
+        acc += 2;
+    }
+    return peak16(peak);
+}
+
+static uint16_t __time_critical_func(mix_mono_gain)(const uint8_t *src, int32_t *acc,
+                                                    uint32_t frames, int32_t gain_q8) {
+    const int16_t *s16  = (const int16_t *)src;
+    int32_t        peak = 0;
+
+    if (((uintptr_t)s16 & 2u) && frames > 0) {
+        int32_t s = (*s16++ * gain_q8) >> 8;
+        acc[0] += s; acc[1] += s;
+        acc += 2; frames--;
+        peak = abs32(s);
+    }
+
+    const uint32_t *w = (const uint32_t *)s16;
+    while (frames >= 4) {
+        uint32_t w0 = w[0];
+        uint32_t w1 = w[1];
+        int32_t  s0 = (LO16(w0) * gain_q8) >> 8;
+        int32_t  s1 = (HI16(w0) * gain_q8) >> 8;
+        int32_t  s2 = (LO16(w1) * gain_q8) >> 8;
+        int32_t  s3 = (HI16(w1) * gain_q8) >> 8;
+
+        acc[0] += s0; acc[1] += s0;
+        acc[2] += s1; acc[3] += s1;
+        acc[4] += s2; acc[5] += s2;
+        acc[6] += s3; acc[7] += s3;
+
+        int32_t a = abs32(s0);
+        if (a > peak) peak = a;
+
+        w += 2; acc += 8; frames -= 4;
+    }
+
+    s16 = (const int16_t *)w;
+    while (frames--) {
+        int32_t s = (*s16++ * gain_q8) >> 8;
+        acc[0] += s; acc[1] += s;
+        acc += 2;
+    }
+    return peak16(peak);
+}
+
+// Estéreo
+
+static uint16_t __time_critical_func(mix_stereo)(const uint8_t *src, int32_t *acc,
+                                                 uint32_t frames, int32_t gain_q8) {
+    (void)gain_q8;
+    const uint32_t *w    = (const uint32_t *)src;
+    int32_t         peak = 0;
+
+    while (frames >= 4) {
+        uint32_t w0 = w[0], w1 = w[1], w2 = w[2], w3 = w[3];
+
+        acc[0] += LO16(w0); acc[1] += HI16(w0);
+        acc[2] += LO16(w1); acc[3] += HI16(w1);
+        acc[4] += LO16(w2); acc[5] += HI16(w2);
+        acc[6] += LO16(w3); acc[7] += HI16(w3);
+
+        int32_t a = abs32(LO16(w0));
+        if (a > peak) peak = a;
+
+        w += 4; acc += 8; frames -= 4;
+    }
+
+    while (frames--) {
+        uint32_t w0 = *w++;
+        acc[0] += LO16(w0); acc[1] += HI16(w0);
+        acc += 2;
+    }
+    return peak16(peak);
+}
+
+static uint16_t __time_critical_func(mix_stereo_gain)(const uint8_t *src, int32_t *acc,
+                                                      uint32_t frames, int32_t gain_q8) {
+    const uint32_t *w    = (const uint32_t *)src;
+    int32_t         peak = 0;
+
+    while (frames >= 4) {
+        uint32_t w0 = w[0], w1 = w[1], w2 = w[2], w3 = w[3];
+        int32_t  l0 = (LO16(w0) * gain_q8) >> 8;
+
+        acc[0] += l0;                           acc[1] += (HI16(w0) * gain_q8) >> 8;
+        acc[2] += (LO16(w1) * gain_q8) >> 8;    acc[3] += (HI16(w1) * gain_q8) >> 8;
+        acc[4] += (LO16(w2) * gain_q8) >> 8;    acc[5] += (HI16(w2) * gain_q8) >> 8;
+        acc[6] += (LO16(w3) * gain_q8) >> 8;    acc[7] += (HI16(w3) * gain_q8) >> 8;
+
+        int32_t a = abs32(l0);
+        if (a > peak) peak = a;
+
+        w += 4; acc += 8; frames -= 4;
+    }
+
+    while (frames--) {
+        uint32_t w0 = *w++;
+        acc[0] += (LO16(w0) * gain_q8) >> 8;
+        acc[1] += (HI16(w0) * gain_q8) >> 8;
+        acc += 2;
+    }
+    return peak16(peak);
+}
+
+// Remuestreo lineal
+
+void mix_resampler_init(mix_resampler_t *rs, uint32_t in_rate, uint32_t out_rate) {
+    rs->step_q16 = (uint32_t)(((uint64_t)in_rate << 16) / out_rate);
+    // Dos frames pendientes de consumir: el primero de salida es el primero de entrada
+    rs->frac_q16 = 2 * MIX_RESAMPLE_ONE;
+    rs->prev_l = rs->prev_r = 0;
+    rs->cur_l  = rs->cur_r  = 0;
+    rs->peak   = 0;
+}
+
+/** Interpolación lineal con fracción Q14 (la diferencia ocupa hasta 17 bits). */
+#define LERP(a, b, f14)  ((a) + ((((b) - (a)) * (f14)) >> 14))
+
+static uint32_t __time_critical_func(resample_mono)(mix_resampler_t *rs, const uint8_t *src,
+                                                    uint32_t in_frames, int32_t *acc,
+                                                    uint32_t out_frames, int32_t gain_q8,
+                                                    uint32_t *in_used) {
+    const int16_t *s    = (const int16_t *)src;
+    uint32_t       used = 0;
+    uint32_t       out  = 0;
+    uint32_t       frac = rs->frac_q16;
+    int32_t        prev = rs->prev_l, cur = rs->cur_l;
+    int32_t        peak = 0;
+
+    while (out < out_frames) {
+        while (frac >= MIX_RESAMPLE_ONE) {
+            if (used == in_frames) goto done;
+            prev  = cur;
+            cur   = s[used++];
+            frac -= MIX_RESAMPLE_ONE;
+        }
+
+        int32_t v = (LERP(prev, cur, (int32_t)(frac >> 2)) * gain_q8) >> 8;
+        acc[0] += v;
+        acc[1] += v;
+        acc    += 2;
+
+        if ((out & 3u) == 0) {
+            int32_t a = abs32(v);
+            if (a > peak) peak = a;
+        }
+
+        frac += rs->step_q16;
+        out++;
+    }
+
+done:
+    rs->frac_q16 = frac;
+    rs->prev_l   = prev;
+    rs->cur_l    = cur;
+    rs->peak     = peak16(peak);
+    *in_used     = used;
+    return out;
+}
+
+static uint32_t __time_critical_func(resample_stereo)(mix_resampler_t *rs, const uint8_t *src,
+                                                      uint32_t in_frames, int32_t *acc,
+                                                      uint32_t out_frames, int32_t gain_q8,
+                                                      uint32_t *in_used) {
+    const uint32_t *w    = (const uint32_t *)src;
+    uint32_t        used = 0;
+    uint32_t        out  = 0;
+    uint32_t        frac = rs->frac_q16;
+    int32_t         pl = rs->prev_l, pr = rs->prev_r;
+    int32_t         cl = rs->cur_l,  cr = rs->cur_r;
+    int32_t         peak = 0;
+
+    while (out < out_frames) {
+        while (frac >= MIX_RESAMPLE_ONE) {
+            if (used == in_frames) goto done;
+            uint32_t w0 = w[used++];
+            pl = cl; pr = cr;
+            cl = LO16(w0);
+            cr = HI16(w0);
+            frac -= MIX_RESAMPLE_ONE;
+        }
+
+        int32_t f = (int32_t)(frac >> 2);
+        int32_t l = (LERP(pl, cl, f) * gain_q8) >> 8;
+        int32_t r = (LERP(pr, cr, f) * gain_q8) >> 8;
+        acc[0] += l;
+        acc[1] += r;
+        acc    += 2;
+
+        if ((out & 3u) == 0) {
+            int32_t a = abs32(l);
+            if (a > peak) peak = a;
+        }
+
+        frac += rs->step_q16;
+        out++;
+    }
+
+done:
+    rs->frac_q16 = frac;
+    rs->prev_l = pl; rs->prev_r = pr;
+    rs->cur_l  = cl; rs->cur_r  = cr;
+    rs->peak     = peak16(peak);
+    *in_used     = used;
+    return out;
+}
+
+mix_resample_kernel_t mix_kernels_select_resampler(uint16_t channels) {
+    return (channels == 2) ? resample_stereo : resample_mono;
+}
+
+mix_kernel_t mix_kernels_select(uint16_t channels, int32_t gain_q8) {
+    bool unity = (gain_q8 == MIX_GAIN_UNITY_Q8);
+
+    if (channels == 2) {
+        return unity ? mix_stereo : mix_stereo_gain;
+    }
+    return unity ? mix_mono : mix_mono_gain;
+}
+
+
+// Medición
+
+static uint8_t bench_src[MIX_BENCH_FRAMES * 4] __attribute__((aligned(4)));
+static int32_t bench_acc[MIX_BENCH_FRAMES * 2];
+
+/**
+ * @brief Bucle anterior (byte a byte, con decisiones por frame), solo como
+ *        referencia de la medición.
+ */
+static uint16_t __attribute__((noinline)) mix_reference(const uint8_t *src, int32_t *acc,
+                                                         uint32_t frames, uint16_t channels) {
+    uint16_t peak = 0;
+
+    for (uint32_t n = 0; n < frames; n++) {
+        const uint8_t *p = src + n * channels * 2u;
+        int16_t left  = (int16_t)(p[0] | (p[1] << 8));
+        int16_t right = left;
+        if (channels == 2) {
+            right = (int16_t)(p[2] | (p[3] << 8));
+        }
+        acc[2 * n]     += left;
+        acc[2 * n + 1] += right;
+
+        uint16_t a = (uint16_t)(left < 0 ? -left : left);
+        if (a > peak) peak = a;
+    }
+    return peak;
+}
+
+/**
+ * @brief Ciclos de un kernel sobre MIX_BENCH_FRAMES - 1 frames.
+ *
+ * Sin kernel mide mix_reference() con los canales dados.
+ */
+static uint32_t bench_run(mix_kernel_t k, uint16_t channels, uint32_t offset,
+                          int32_t gain_q8) {
+    memset(bench_acc, 0, sizeof(bench_acc));
+
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t t0  = benchmark_cycles();
+    if (k) {
+        k(bench_src + offset, bench_acc, MIX_BENCH_FRAMES - 1, gain_q8);
+    } else {
+        mix_reference(bench_src + offset, bench_acc, MIX_BENCH_FRAMES - 1, channels);
+    }
+    uint32_t t1  = benchmark_cycles();
+    restore_interrupts(irq);
+
+    return benchmark_elapsed(t0, t1);
+}
+
+/**
+ * @brief Informa una única medición de @p cycles ciclos sobre @p frames frames.
+ */
+static void bench_report_frames(const char *name, uint32_t cycles, uint32_t frames) {
+    benchmark_stat_t s = {0};
+    benchmark_stat_add(&s, cycles, frames);
+    benchmark_report(name, "frame", &s);
+}
+
+void mix_kernels_benchmark(void) {
+    static const struct {
+        const char  *name;
+        mix_kernel_t kernel;     // NULL: bucle de referencia
+        uint16_t     channels;
+        uint32_t     offset;     // mono desalineado, para incluir el frame de ajuste
+        int32_t      gain_q8;
+    } cases[] = {
+        { "mezcla_mono_referencia",    NULL,            1, 2, MIX_GAIN_UNITY_Q8  },
+        { "mezcla_mono_x1",            mix_mono,        1, 2, MIX_GAIN_UNITY_Q8  },
+        { "mezcla_mono_q8",            mix_mono_gain,   1, 2, 200                },
+        { "mezcla_estereo_referencia", NULL,            2, 0, MIX_GAIN_UNITY_Q8  },
+        { "mezcla_estereo_x1",         mix_stereo,      2, 0, MIX_GAIN_UNITY_Q8  },
+        { "mezcla_estereo_q8",         mix_stereo_gain, 2, 0, 200                },
+    };
+
+    for (uint32_t i = 0; i < sizeof(bench_src) / 2; i++) {
+        ((int16_t *)bench_src)[i] = (int16_t)(i * 97);
+    }
+
+    uint32_t csr = systick_hw->csr;
+    uint32_t rvr = systick_hw->rvr;
+    benchmark_cycles_init();
+
+    for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint32_t c = bench_run(cases[i].kernel, cases[i].channels,
+                               cases[i].offset, cases[i].gain_q8);
+        bench_report_frames(cases[i].name, c, MIX_BENCH_FRAMES - 1);
+    }
+
+    // Remuestreo: ciclos por frame de salida
+    static const struct {
+        const char *name;
+        uint16_t    channels;
+        uint32_t    in_rate;
+    } rs_cases[] = {
+        { "remuestreo_mono_22050",   1, 22050 },
+        { "remuestreo_estereo_48000", 2, 48000 },
+    };
+
+    for (uint32_t i = 0; i < sizeof(rs_cases) / sizeof(rs_cases[0]); i++) {
+        mix_resampler_t       rs;
+        mix_resample_kernel_t k = mix_kernels_select_resampler(rs_cases[i].channels);
+        uint32_t              used;
+
+        mix_resampler_init(&rs, rs_cases[i].in_rate, 44100);
+        memset(bench_acc, 0, sizeof(bench_acc));
+
+        uint32_t irq  = save_and_disable_interrupts();
+        uint32_t t0   = benchmark_cycles();
+        uint32_t made = k(&rs, bench_src, MIX_BENCH_FRAMES / 2, bench_acc,
+                          MIX_BENCH_FRAMES / 2, MIX_GAIN_UNITY_Q8, &used);
+        uint32_t t1   = benchmark_cycles();
+        restore_interrupts(irq);
+
+        bench_report_frames(rs_cases[i].name, benchmark_elapsed(t0, t1), made);
+    }
+
+    // Decodificación IMA ADPCM: ciclos por frame decodificado (por voz)
+    for (uint16_t ch = 1; ch <= 2; ch++) {
+        adpcm_channel_t st[2] = { { 0, 0 }, { 0, 0 } };
+        int16_t        *dst   = (int16_t *)bench_acc;
+        uint32_t        bytes = MIX_BENCH_FRAMES / 2;   // 256 frames mono, 128 estéreo
+
+        uint32_t irq = save_and_disable_interrupts();
+        uint32_t t0  = benchmark_cycles();
+        if (ch == 1) {
+            adpcm_decode_mono(st, bench_src, bytes, dst);
+        } else {
+            adpcm_decode_stereo(st, bench_src, bytes / ADPCM_STEREO_GROUP, dst);
+        }
+        uint32_t t1  = benchmark_cycles();
+        restore_interrupts(irq);
+
+        uint32_t frames = (ch == 1) ? 2 * bytes : bytes;
+        bench_report_frames((ch == 1) ? "adpcm_mono" : "adpcm_estereo",
+                            benchmark_elapsed(t0, t1), frames);
+    }
+
+    systick_hw->rvr = rvr;
+    systick_hw->csr = csr;
+}
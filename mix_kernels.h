@@ -0,0 +1,116 @@
+/**
+ * @file mix_kernels.h
+ * @brief Kernels de mezcla especializados por formato de sample.
+ *
+ * Cada kernel suma un tramo de frames PCM 16 bits al acumulador de mezcla
+ * (L/R intercalados, 32 bits). Hay una variante por formato (mono->estéreo
+ * y estéreo) y por ganancia de voz (unitaria o Q8); la voz elige su kernel
+ * una sola vez al empezar, con mix_kernels_select(), de modo que el bucle
+ * interno no pregunta por bits, canales ni ganancia en cada frame.
+ *
+ * Los kernels leen palabras de 32 bits alineadas (un frame estéreo o dos
+ * frames mono por carga) y procesan 4 frames por iteración.
+ *
+ * Costo estimado en el Cortex-M0+ por conteo de instrucciones
+ * (ciclos por frame, incluye acumulador y bucle):
+ *  - mono,    ganancia 1: ~12   (bucle anterior byte a byte: ~45)
+ *  - mono,    ganancia Q8: ~14
+ *  - estéreo, ganancia 1: ~16  (bucle anterior byte a byte: ~55)
+ *  - estéreo, ganancia Q8: ~20
+ * mix_kernels_benchmark() mide los valores reales con SysTick.
+ *
+ * Las voces cuya frecuencia no coincide con la de salida usan en cambio un
+ * remuestreador lineal en punto fijo (Q16), también especializado en mono
+ * y estéreo; siempre aplica la ganancia de la voz.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef MIX_KERNELS_H
+#define MIX_KERNELS_H
+
+#include <stdint.h>
+
+/** Ganancia de voz unitaria en Q8. */
+#define MIX_GAIN_UNITY_Q8  256
+
+/**
+ * @brief Kernel de mezcla.
+ *
+ * @param src Primer frame del tramo (alineado a 4 en estéreo, a 2 en mono).
+ * @param acc Acumulador destino (2 enteros por frame).
+ * @param frames Número de frames a mezclar.
+ * @param gain_q8 Ganancia de la voz (ignorada por los kernels unitarios).
+ * @return Pico absoluto aproximado del tramo (para el robo de voz).
+ */
+typedef uint16_t (*mix_kernel_t)(const uint8_t *src, int32_t *acc,
+                                 uint32_t frames, int32_t gain_q8);
+
+/** Paso unitario del remuestreador (un frame de entrada por frame de salida). */
+#define MIX_RESAMPLE_ONE  (1u << 16)
+
+/**
+ * @brief Estado del remuestreador lineal de una voz.
+ *
+ * Interpola entre el frame anterior y el actual; consume los frames de
+ * entrada de uno en uno, por lo que el tramo de entrada puede cortarse en
+ * cualquier punto (fin de buffer) sin perder continuidad.
+ */
+typedef struct {
+    uint32_t step_q16;   /**< Frames de entrada por frame de salida (Q16). */
+    uint32_t frac_q16;   /**< Posición entre prev y cur (Q16, puede superar 1). */
+    int32_t  prev_l, prev_r;
+    int32_t  cur_l,  cur_r;
+    uint16_t peak;       /**< Pico aproximado del último tramo. */
+} mix_resampler_t;
+
+/**
+ * @brief Kernel de remuestreo.
+ *
+ * @param rs Estado de la voz.
+ * @param src Tramo de entrada (alineación como en mix_kernel_t).
+ * @param in_frames Frames disponibles en el tramo.
+ * @param acc Acumulador destino.
+ * @param out_frames Frames de salida pedidos.
+ * @param gain_q8 Ganancia de la voz.
+ * @param in_used Devuelve los frames de entrada consumidos.
+ * @return Frames de salida producidos (menos que @p out_frames solo si se
+ *         agotó la entrada).
+ */
+typedef uint32_t (*mix_resample_kernel_t)(mix_resampler_t *rs, const uint8_t *src,
+                                          uint32_t in_frames, int32_t *acc,
+                                          uint32_t out_frames, int32_t gain_q8,
+                                          uint32_t *in_used);
+
+/**
+ * @brief Prepara el remuestreador para convertir de in_rate a out_rate.
+ */
+void mix_resampler_init(mix_resampler_t *rs, uint32_t in_rate, uint32_t out_rate);
+
+/**
+ * @brief Elige el kernel de remuestreo para un número de canales.
+ */
+mix_resample_kernel_t mix_kernels_select_resampler(uint16_t channels);
+
+/**
+ * @brief Elige el kernel para un formato y una ganancia.
+ *
+ * @param channels 1 o 2.
+ * @param gain_q8 Ganancia de la voz en Q8.
+ * @return Kernel a usar en todos los bloques de la voz.
+ */
+mix_kernel_t mix_kernels_select(uint16_t channels, int32_t gain_q8);
+
+/**
+ * @brief Mide e imprime los ciclos por frame de cada kernel.
+ *
+ * Usa SysTick con el reloj del sistema; bloquea unos pocos cientos de
+ * microsegundos. Imprime una línea CSV por kernel (benchmark_report()).
+ */
+void mix_kernels_benchmark(void);
+
+#endif // MIX_KERNELS_H
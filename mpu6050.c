@@ -3,27 +3,265 @@
  * @brief Implementación de lectura y análisis del sensor MPU6050.
  *
  * Contiene funciones de bajo nivel para comunicación I2C,
- * decodificación de registros y cálculo de orientación.
+ * decodificación de registros, adquisición continua por FIFO y DMA, y
+ * cálculo de orientación.
  */
 
 #include "mpu6050.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// Registros del MPU6050 usados por la adquisición continua
+#define REG_SMPLRT_DIV    0x19
+#define REG_CONFIG        0x1A
+#define REG_GYRO_CONFIG   0x1B
+#define REG_ACCEL_CONFIG  0x1C
+#define REG_FIFO_EN       0x23
+#define REG_INT_PIN_CFG   0x37
+#define REG_INT_ENABLE    0x38
+#define REG_USER_CTRL     0x6A
+#define REG_PWR_MGMT_1    0x6B
+#define REG_FIFO_R_W      0x74
+
+#define PWR_CLK_PLL_GYRO_X  0x01    // reloj del PLL con el giroscopio X
+#define CONFIG_DLPF_188HZ   0x01    // DLPF 184/188 Hz: muestreo interno a 1 kHz
+#define FIFO_EN_ACCEL_GYRO  0x78    // giroscopio X/Y/Z y acelerómetro
+#define USER_FIFO_EN        0x40
+#define USER_FIFO_RESET     0x04
+#define INT_DATA_RDY        0x01
+
+/** Bytes por muestra en la FIFO (acelerómetro y giroscopio, sin temperatura). */
+#define SAMPLE_BYTES 12
+
+/** Instantes de pulsos INT guardados (potencia de 2, mayor que la FIFO). */
+#define EDGE_RING 128
+
 /** @brief Instancia I2C usada internamente. */
 static i2c_inst_t *mpu_i2c;
 
+// Adquisición continua
+static int                dma_tx = -1;
+static int                dma_rx = -1;
+static dma_channel_config dma_tx_cfg;
+static dma_channel_config dma_rx_cfg;
+static uint32_t           burst_cmds[1 + MPU6050_BURST_MAX * SAMPLE_BYTES];
+static uint8_t            burst_buf[MPU6050_BURST_MAX * SAMPLE_BYTES];
+static uint32_t           burst_n = 0;
+static bool               handlers_added = false;
+
+static volatile bool streaming      = false;
+static volatile bool burst_busy     = false;
+static volatile bool bus_held       = false;   // lectura bloqueante en curso
+static volatile bool resync_pending = false;
+
+// Pulsos INT vistos y muestras ya pedidas a la FIFO
+static volatile uint32_t edge_count = 0;
+static volatile uint32_t read_count = 0;
+static volatile uint32_t edge_us[EDGE_RING];
+
+static mpu6050_sample_t  ring[MPU6050_RING_SAMPLES];
+static volatile uint32_t ring_head = 0;
+static volatile uint32_t ring_tail = 0;
+
+static mpu6050_ready_cb_t     ready_cb = NULL;
+static mpu6050_stream_stats_t stats;
+
+/**
+ * @brief Escribe un registro del MPU6050 (bloqueante).
+ */
+static void mpu_write_reg(uint8_t reg, uint8_t value) {
+    uint8_t cmd[2] = {reg, value};
+    i2c_write_blocking(mpu_i2c, MPU6050_ADDR, cmd, 2, false);
+}
+
+/**
+ * @brief Decodifica una muestra de la FIFO (big endian, acelerómetro y
+ *        luego giroscopio).
+ */
+static void sample_decode(const uint8_t *b, mpu6050_raw_t *raw) {
+    raw->ax = (int16_t)((b[0] << 8) | b[1]);
+    raw->ay = (int16_t)((b[2] << 8) | b[3]);
+    raw->az = (int16_t)((b[4] << 8) | b[5]);
+    raw->gx = (int16_t)((b[6] << 8) | b[7]);
+    raw->gy = (int16_t)((b[8] << 8) | b[9]);
+    raw->gz = (int16_t)((b[10] << 8) | b[11]);
+}
+
+/**
+ * @brief Arranca por DMA la lectura de @p n muestras de FIFO_R_W.
+ *
+ * El canal TX escribe en IC_DATA_CMD la dirección del registro y un
+ * comando de lectura por byte (RESTART en el primero, STOP en el último);
+ * el canal RX recoge los bytes al ritmo del bus.
+ */
+static void burst_start(uint32_t n) {
+    i2c_hw_t *hw    = i2c_get_hw(mpu_i2c);
+    uint32_t  bytes = n * SAMPLE_BYTES;
+
+    burst_cmds[0] = REG_FIFO_R_W;
+    for (uint32_t i = 1; i <= bytes; i++) {
+        burst_cmds[i] = I2C_IC_DATA_CMD_CMD_BITS;
+    }
+    burst_cmds[1]     |= I2C_IC_DATA_CMD_RESTART_BITS;
+    burst_cmds[bytes] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    burst_n    = n;
+    burst_busy = true;
+
+    hw->enable = 0;
+    hw->tar    = MPU6050_ADDR;
+    hw->enable = 1;
+    (void)hw->clr_intr;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+    dma_channel_configure((uint)dma_rx, &dma_rx_cfg, burst_buf, &hw->data_cmd, bytes, true);
+    dma_channel_configure((uint)dma_tx, &dma_tx_cfg, &hw->data_cmd, burst_cmds, bytes + 1, true);
+}
+
+/**
+ * @brief Arranca una ráfaga si hay MPU6050_BURST_SAMPLES muestras nuevas
+ *        y el bus está libre. Llamar con las IRQ de core0 deshabilitadas
+ *        o desde ellas.
+ */
+static void burst_kick(void) {
+    if (!streaming || burst_busy || bus_held || resync_pending) return;
+
+    uint32_t pending = edge_count - read_count;
+    if (pending > MPU6050_FIFO_SAMPLES) {
+        // La FIFO se desbordó: su contenido ya no coincide con los pulsos
+        resync_pending = true;
+        if (ready_cb) ready_cb();
+        return;
+    }
+    if (pending < MPU6050_BURST_SAMPLES) return;
+
+    burst_start(pending > MPU6050_BURST_MAX ? MPU6050_BURST_MAX : pending);
+}
+
+/**
+ * @brief Pasa las muestras de la ráfaga terminada al anillo con el
+ *        instante de su pulso INT.
+ */
+static void burst_publish(void) {
+    uint32_t now = time_us_32();
+
+    for (uint32_t i = 0; i < burst_n; i++) {
+        uint32_t t = edge_us[(read_count + i) % EDGE_RING];
+
+        if (i == 0 && now - t > stats.latency_max_us) {
+            stats.latency_max_us = now - t;
+        }
+        if (i == burst_n - 1) {
+            stats.latency_us = now - t;
+        }
+
+        if (ring_head - ring_tail >= MPU6050_RING_SAMPLES) {
+            stats.dropped++;
+            continue;
+        }
+        mpu6050_sample_t *s = &ring[ring_head % MPU6050_RING_SAMPLES];
+        s->t_us = t;
+        sample_decode(&burst_buf[i * SAMPLE_BYTES], &s->raw);
+        __dmb();
+        ring_head++;
+        stats.samples++;
+    }
+    read_count += burst_n;
+    stats.bursts++;
+}
+
+/**
+ * @brief IRQ del pin INT: una muestra nueva en la FIFO.
+ */
+static void mpu_int_irq(void) {
+    if (!(gpio_get_irq_event_mask(MPU6050_INT_PIN) & GPIO_IRQ_EDGE_RISE)) return;
+    gpio_acknowledge_irq(MPU6050_INT_PIN, GPIO_IRQ_EDGE_RISE);
+
+    edge_us[edge_count % EDGE_RING] = time_us_32();
+    edge_count++;
+    burst_kick();
+}
+
+/**
+ * @brief IRQ del I2C: STOP al final de la ráfaga, o aborto (NACK).
+ */
+static void mpu_i2c_irq(void) {
+    i2c_hw_t *hw = i2c_get_hw(mpu_i2c);
+    uint32_t  st = hw->intr_stat;
+
+    hw->intr_mask = 0;
+    if (st & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        (void)hw->clr_tx_abrt;
+        dma_channel_abort((uint)dma_tx);
+        dma_channel_abort((uint)dma_rx);
+        stats.aborts++;
+        resync_pending = true;
+    } else {
+        // El último byte llegó antes del STOP: el DMA RX lo toma enseguida
+        while (dma_channel_is_busy((uint)dma_rx)) {
+            tight_loop_contents();
+        }
+        burst_publish();
+    }
+    (void)hw->clr_stop_det;
+
+    burst_busy = false;
+    if (ready_cb) ready_cb();
+    burst_kick();
+}
+
+/**
+ * @brief Reserva el bus para una lectura bloqueante: los pulsos se siguen
+ *        contando, pero no arranca otra ráfaga.
+ */
+static void bus_acquire(void) {
+    bus_held = true;
+    while (burst_busy) {
+        __wfe();   // la IRQ de STOP despierta
+    }
+}
+
+/**
+ * @brief Libera el bus y lee lo acumulado mientras estuvo reservado.
+ */
+static void bus_release(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    bus_held = false;
+    burst_kick();
+    restore_interrupts(irq);
+}
+
+/**
+ * @brief Vacía la FIFO tras un desborde o un aborto y sigue desde cero.
+ */
+static void stream_resync(void) {
+    bus_acquire();
+    mpu_write_reg(REG_USER_CTRL, USER_FIFO_EN | USER_FIFO_RESET);
+
+    uint32_t irq = save_and_disable_interrupts();
+    read_count     = edge_count;
+    resync_pending = false;
+    stats.resyncs++;
+    restore_interrupts(irq);
+
+    bus_release();
+}
+
 /**
  * @brief Inicializa comunicación I2C y saca el MPU6050 del modo sleep.
  */
 void mpu6050_init(i2c_inst_t *i2c, uint sda, uint scl) {
     mpu_i2c = i2c;
 
-    i2c_init(i2c, 400000);
+    i2c_init(i2c, MPU6050_I2C_BAUD);
     gpio_set_function(sda, GPIO_FUNC_I2C);
     gpio_set_function(scl, GPIO_FUNC_I2C);
     gpio_pull_up(sda);
@@ -40,8 +278,11 @@ void mpu6050_read_raw(mpu6050_raw_t *data) {
     uint8_t reg = 0x3B;
     uint8_t buffer[14];
 
+    bool held = streaming;
+    if (held) bus_acquire();
     i2c_write_blocking(mpu_i2c, MPU6050_ADDR, &reg, 1, true);
     i2c_read_blocking(mpu_i2c, MPU6050_ADDR, buffer, 14, false);
+    if (held) bus_release();
 
     data->ax = (buffer[0] << 8) | buffer[1];
     data->ay = (buffer[2] << 8) | buffer[3];
@@ -51,6 +292,133 @@ void mpu6050_read_raw(mpu6050_raw_t *data) {
     data->gz = (buffer[12] << 8) | buffer[13];
 }
 
+/**
+ * @brief Escribe PWR_MGMT_1: 0x40 duerme, 0x00 despierta (reloj interno).
+ */
+void mpu6050_set_sleep(bool sleep) {
+    uint8_t cmd[2] = {0x6B, sleep ? 0x40 : 0x00};
+    i2c_write_blocking(mpu_i2c, MPU6050_ADDR, cmd, 2, false);
+}
+
+bool mpu6050_stream_start(mpu6050_ready_cb_t ready) {
+    if (streaming) return true;
+
+    if (dma_tx < 0) {
+        dma_tx = dma_claim_unused_channel(false);
+        dma_rx = dma_claim_unused_channel(false);
+        if (dma_tx < 0 || dma_rx < 0) {
+            printf("Error: no hay canales DMA libres para la IMU\n");
+            return false;
+        }
+
+        dma_tx_cfg = dma_channel_get_default_config((uint)dma_tx);
+        channel_config_set_transfer_data_size(&dma_tx_cfg, DMA_SIZE_32);
+        channel_config_set_read_increment(&dma_tx_cfg, true);
+        channel_config_set_write_increment(&dma_tx_cfg, false);
+        channel_config_set_dreq(&dma_tx_cfg, i2c_get_dreq(mpu_i2c, true));
+
+        dma_rx_cfg = dma_channel_get_default_config((uint)dma_rx);
+        channel_config_set_transfer_data_size(&dma_rx_cfg, DMA_SIZE_8);
+        channel_config_set_read_increment(&dma_rx_cfg, false);
+        channel_config_set_write_increment(&dma_rx_cfg, true);
+        channel_config_set_dreq(&dma_rx_cfg, i2c_get_dreq(mpu_i2c, false));
+    }
+
+    // ODR fijo con DLPF; escalas de ±2 g y ±250 °/s (las de mpu6050_calc_g)
+    mpu_write_reg(REG_PWR_MGMT_1, PWR_CLK_PLL_GYRO_X);
+    mpu_write_reg(REG_CONFIG, CONFIG_DLPF_188HZ);
+    mpu_write_reg(REG_SMPLRT_DIV, (uint8_t)(1000 / MPU6050_ODR_HZ - 1));
+    mpu_write_reg(REG_GYRO_CONFIG, 0x00);
+    mpu_write_reg(REG_ACCEL_CONFIG, 0x00);
+    mpu_write_reg(REG_INT_PIN_CFG, 0x00);   // activo en alto, pulso de 50 us
+    mpu_write_reg(REG_FIFO_EN, FIFO_EN_ACCEL_GYRO);
+    mpu_write_reg(REG_USER_CTRL, USER_FIFO_EN | USER_FIFO_RESET);
+
+    ready_cb       = ready;
+    edge_count     = 0;
+    read_count     = 0;
+    ring_head      = 0;
+    ring_tail      = 0;
+    burst_busy     = false;
+    bus_held       = false;
+    resync_pending = false;
+
+    gpio_init(MPU6050_INT_PIN);
+    gpio_set_dir(MPU6050_INT_PIN, GPIO_IN);
+    gpio_pull_down(MPU6050_INT_PIN);
+
+    // Sin ráfaga en curso, ninguna fuente del I2C debe llegar a la IRQ: la
+    // máscara de reset (0x8FF) la dispararía en cuanto se habilite, como si
+    // terminara una ráfaga sin muestras
+    i2c_get_hw(mpu_i2c)->intr_mask = 0;
+
+    if (!handlers_added) {
+        uint i2c_irq = i2c_hw_index(mpu_i2c) ? I2C1_IRQ : I2C0_IRQ;
+        gpio_add_raw_irq_handler(MPU6050_INT_PIN, mpu_int_irq);
+        irq_set_exclusive_handler(i2c_irq, mpu_i2c_irq);
+        irq_set_enabled(i2c_irq, true);
+        handlers_added = true;
+    }
+    gpio_set_irq_enabled(MPU6050_INT_PIN, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    streaming = true;
+    mpu_write_reg(REG_INT_ENABLE, INT_DATA_RDY);
+    return true;
+}
+
+void mpu6050_stream_stop(void) {
+    if (!streaming) return;
+
+    gpio_set_irq_enabled(MPU6050_INT_PIN, GPIO_IRQ_EDGE_RISE, false);
+    bus_acquire();
+    streaming = false;
+
+    mpu_write_reg(REG_INT_ENABLE, 0x00);
+    mpu_write_reg(REG_USER_CTRL, 0x00);
+    mpu_write_reg(REG_FIFO_EN, 0x00);
+    bus_held = false;
+}
+
+bool mpu6050_stream_pop(mpu6050_sample_t *sample) {
+    if (resync_pending && streaming) {
+        stream_resync();
+    }
+    if (ring_tail == ring_head) {
+        return false;
+    }
+    __dmb();
+    *sample = ring[ring_tail % MPU6050_RING_SAMPLES];
+    ring_tail++;
+    return true;
+}
+
+mpu6050_stream_stats_t mpu6050_stream_get_stats(void) {
+    uint32_t irq = save_and_disable_interrupts();
+    mpu6050_stream_stats_t copy = stats;
+    restore_interrupts(irq);
+    return copy;
+}
+
+void mpu6050_stream_print(void) {
+    mpu6050_stream_stats_t s = mpu6050_stream_get_stats();
+
+    printf("--- IMU (FIFO a %u Hz, ráfagas de %u muestras) ---\n",
+           MPU6050_ODR_HZ, MPU6050_BURST_SAMPLES);
+    printf("  Muestras: %lu en %lu ráfagas, perdidas %lu\n",
+           (unsigned long)s.samples, (unsigned long)s.bursts, (unsigned long)s.dropped);
+    printf("  FIFO vaciada: %lu veces, abortos del I2C: %lu\n",
+           (unsigned long)s.resyncs, (unsigned long)s.aborts);
+    printf("  Pulso INT -> anillo: último %lu us, max %lu us\n",
+           (unsigned long)s.latency_us, (unsigned long)s.latency_max_us);
+}
+
+void mpu6050_clock_changed(void) {
+    if (mpu_i2c) {
+        i2c_set_baudrate(mpu_i2c, MPU6050_I2C_BAUD);
+    }
+}
+
 /**
  * @brief Convierte lectura cruda de acelerómetro a "g".
  */
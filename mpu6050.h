@@ -4,6 +4,19 @@
  *
  * Define estructuras, constantes y funciones públicas para obtener
  * aceleraciones, giroscopio y calcular orientación.
+ *
+ * Adquisición continua (mpu6050_stream_start()): el MPU6050 muestrea a
+ * MPU6050_ODR_HZ con el filtro DLPF, deja cada muestra (acelerómetro y
+ * giroscopio, 12 bytes) en su FIFO y da un pulso en INT. La IRQ del pin
+ * guarda el instante de cada pulso y, cada MPU6050_BURST_SAMPLES pulsos,
+ * arranca por DMA una lectura en ráfaga de la FIFO: un canal escribe los
+ * comandos en IC_DATA_CMD y otro recoge los bytes. La IRQ de STOP del I2C
+ * cierra la ráfaga, pasa las muestras con su instante a un anillo y avisa
+ * al bucle principal, que nunca espera al bus.
+ *
+ * Cada pulso es una muestra en la FIFO, así que la cantidad a leer sale de
+ * contar pulsos, sin leer FIFO_COUNT. Si la FIFO se desborda (más de
+ * MPU6050_FIFO_SAMPLES pendientes) se vacía y se sigue desde cero.
  */
 
 #ifndef MPU6050_H
@@ -17,6 +30,27 @@
 /** @brief Dirección I2C por defecto del MPU6050. */
 #define MPU6050_ADDR 0x68
 
+/** @brief Velocidad del bus I2C de la IMU. */
+#define MPU6050_I2C_BAUD 400000
+
+/** @brief GPIO conectado al pin INT del MPU6050 (dato listo). */
+#define MPU6050_INT_PIN 16
+
+/** @brief Frecuencia de muestreo de la adquisición continua (Hz). */
+#define MPU6050_ODR_HZ 1000
+
+/** @brief Muestras por ráfaga de lectura de la FIFO (4 ms a 1 kHz). */
+#define MPU6050_BURST_SAMPLES 4
+
+/** @brief Máximo de muestras en una ráfaga (al recuperar atrasos). */
+#define MPU6050_BURST_MAX 8
+
+/** @brief Muestras que caben en la FIFO de 1024 bytes del MPU6050. */
+#define MPU6050_FIFO_SAMPLES (1024 / 12)
+
+/** @brief Muestras del anillo entre la IRQ y el bucle principal. */
+#define MPU6050_RING_SAMPLES 64
+
 /**
  * @brief Estructura que contiene las lecturas crudas del MPU6050.
  *
@@ -28,6 +62,32 @@ typedef struct {
     int16_t gx, gy, gz;
 } mpu6050_raw_t;
 
+/**
+ * @brief Muestra de la adquisición continua.
+ */
+typedef struct {
+    uint32_t      t_us;     /**< Instante del pulso INT de la muestra. */
+    mpu6050_raw_t raw;      /**< Lecturas crudas. */
+} mpu6050_sample_t;
+
+/**
+ * @brief Contadores de la adquisición continua.
+ */
+typedef struct {
+    uint32_t samples;       /**< Muestras entregadas al anillo. */
+    uint32_t bursts;        /**< Ráfagas de lectura completadas. */
+    uint32_t dropped;       /**< Muestras perdidas con el anillo lleno. */
+    uint32_t resyncs;       /**< Vaciados de la FIFO por desborde o error. */
+    uint32_t aborts;        /**< Ráfagas abortadas por el I2C. */
+    uint32_t latency_us;    /**< Última espera pulso -> anillo (muestra más nueva). */
+    uint32_t latency_max_us;/**< Mayor espera pulso -> anillo (muestra más vieja). */
+} mpu6050_stream_stats_t;
+
+/**
+ * @brief Aviso de muestras nuevas; corre en la IRQ del I2C.
+ */
+typedef void (*mpu6050_ready_cb_t)(void);
+
 /**
  * @brief Inicializa el módulo MPU6050 y su interfaz I2C.
  *
@@ -40,10 +100,64 @@ void mpu6050_init(i2c_inst_t *i2c, uint sda, uint scl);
 /**
  * @brief Lee las 6 mediciones crudas de acelerómetro y giroscopio.
  *
+ * Lectura bloqueante; con la adquisición continua en marcha espera a que
+ * termine la ráfaga en curso.
+ *
  * @param data Puntero a la estructura donde se guardarán las lecturas.
  */
 void mpu6050_read_raw(mpu6050_raw_t *data);
 
+/**
+ * @brief Configura ODR, DLPF, FIFO e INT y arranca la adquisición continua.
+ *
+ * Llamar desde core0, que atiende las IRQ del pin INT y del I2C.
+ *
+ * @param ready Aviso tras cada ráfaga con muestras nuevas (o NULL).
+ * @return false si no hay canales DMA libres.
+ */
+bool mpu6050_stream_start(mpu6050_ready_cb_t ready);
+
+/**
+ * @brief Detiene la adquisición continua (espera la ráfaga en curso).
+ */
+void mpu6050_stream_stop(void);
+
+/**
+ * @brief Saca la muestra más vieja del anillo.
+ *
+ * Si hubo desborde de la FIFO, la vacía antes (lectura bloqueante).
+ *
+ * @return false si el anillo está vacío.
+ */
+bool mpu6050_stream_pop(mpu6050_sample_t *sample);
+
+/**
+ * @brief Copia de los contadores de la adquisición continua.
+ */
+mpu6050_stream_stats_t mpu6050_stream_get_stats(void);
+
+/**
+ * @brief Imprime los contadores de la adquisición continua.
+ */
+void mpu6050_stream_print(void);
+
+/**
+ * @brief Duerme o despierta el MPU6050 (bit SLEEP de PWR_MGMT_1).
+ *
+ * Dormido consume unos µA y no entrega mediciones; al despertar, el
+ * giroscopio tarda unas decenas de ms en estabilizarse. Detener antes la
+ * adquisición continua.
+ *
+ * @param sleep true para dormirlo.
+ */
+void mpu6050_set_sleep(bool sleep);
+
+/**
+ * @brief Vuelve a fijar la velocidad del I2C tras un cambio de clk_peri
+ *        (aviso de cambio de reloj, ver power_manager.h).
+ */
+void mpu6050_clock_changed(void);
+
 /**
  * @brief Convierte un valor crudo del acelerómetro a unidades de gravedad.
  *
@@ -0,0 +1,211 @@
+/**
+ * @file power_manager.c
+ * @brief Cambios de reloj con aviso a los periféricos y sueño hasta un botón.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "power_manager.h"
+#include "pico/stdlib.h"
+#include "pico/stdio_usb.h"
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
+#include "hardware/xosc.h"
+#include "hardware/vreg.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+
+static power_clock_listener_t listeners[POWER_MAX_CLOCK_LISTENERS];
+static uint32_t               listener_count = 0;
+
+// PLL del sistema a restaurar al despertar (el del arranque del SDK)
+static uint32_t run_vco      = PLL_SYS_VCO_FREQ_HZ;
+static uint32_t run_postdiv1 = PLL_SYS_POSTDIV1;
+static uint32_t run_postdiv2 = PLL_SYS_POSTDIV2;
+
+static uint32_t      wake_us = 0;
+static power_stats_t stats;
+
+/**
+ * @brief Avisa a los registrados que cambiaron clk_sys / clk_peri.
+ */
+static void notify_clock_change(void) {
+    for (uint32_t i = 0; i < listener_count; i++) {
+        listeners[i]();
+    }
+}
+
+/**
+ * @brief Tiempo de arranque del XOSC al salir de dormant (us).
+ *
+ * El registro STARTUP cuenta en unidades de 256 ciclos del cristal.
+ */
+static uint32_t xosc_startup_us(void) {
+    uint32_t cycles = (xosc_hw->startup & XOSC_STARTUP_DELAY_BITS) * 256u;
+    return cycles / (XOSC_HZ / 1000000u);
+}
+
+/**
+ * @brief clk_sys y clk_peri pasan al XOSC y se apaga el PLL del sistema.
+ *
+ * clk_ref ya corre del XOSC desde el arranque.
+ */
+static void clocks_to_xosc(void) {
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF, 0, XOSC_HZ, XOSC_HZ);
+    clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS, XOSC_HZ, XOSC_HZ);
+    pll_deinit(pll_sys);
+}
+
+/**
+ * @brief Detiene los relojes del PLL USB (USB, ADC y RTC) y lo apaga.
+ */
+static void usb_clocks_stop(void) {
+    clock_stop(clk_usb);
+    clock_stop(clk_adc);
+    clock_configure(clk_rtc, 0, CLOCKS_CLK_RTC_CTRL_AUXSRC_VALUE_XOSC_CLKSRC,
+                    XOSC_HZ, 46875);
+    pll_deinit(pll_usb);
+}
+
+/**
+ * @brief Arranca el PLL USB a 480 MHz y devuelve sus relojes como en el
+ *        arranque del SDK.
+ */
+static void usb_clocks_start(void) {
+    pll_init(pll_usb, 1, 480 * MHZ, 5, 2);
+    clock_configure(clk_usb, 0, CLOCKS_CLK_USB_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB,
+                    48 * MHZ, 48 * MHZ);
+    clock_configure(clk_adc, 0, CLOCKS_CLK_ADC_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB,
+                    48 * MHZ, 48 * MHZ);
+    clock_configure(clk_rtc, 0, CLOCKS_CLK_RTC_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB,
+                    48 * MHZ, 46875);
+}
+
+/**
+ * @brief Habilita o deshabilita el despertar de dormant en los pines.
+ */
+static void dormant_pins_enable(uint32_t pins, bool enable) {
+    for (uint gpio = 0; gpio < 32; gpio++) {
+        if (!(pins & (1u << gpio))) continue;
+        if (!enable) {
+            gpio_acknowledge_irq(gpio, GPIO_IRQ_EDGE_FALL);
+        }
+        gpio_set_dormant_irq_enabled(gpio, GPIO_IRQ_EDGE_FALL, enable);
+    }
+}
+
+/**
+ * @brief Dormant: el XOSC se detiene hasta un flanco en @p wake_pins.
+ *
+ * Las interrupciones quedan deshabilitadas hasta restaurar los relojes,
+ * para que ninguna IRQ corra con divisores a medio recalcular.
+ */
+static void sleep_dormant(uint32_t wake_pins) {
+    uint32_t irq = save_and_disable_interrupts();
+
+    clocks_to_xosc();
+    usb_clocks_stop();
+    notify_clock_change();
+
+    dormant_pins_enable(wake_pins, true);
+    xosc_dormant();
+
+    // El temporizador vuelve con el XOSC ya estable
+    uint32_t t0 = time_us_32();
+    stats.xosc_us = xosc_startup_us();
+    wake_us       = t0 - stats.xosc_us;
+    dormant_pins_enable(wake_pins, false);
+
+    usb_clocks_start();
+    set_sys_clock_pll(run_vco, run_postdiv1, run_postdiv2);
+    notify_clock_change();
+    stats.restore_us = time_us_32() - t0;
+    stats.dormant++;
+
+    restore_interrupts(irq);
+}
+
+/**
+ * @brief Sueño ligero: clk_sys a 12 MHz y __wfe() hasta que un pin de
+ *        @p wake_pins esté en bajo (lo avisa su IRQ GPIO).
+ */
+static void sleep_light(uint32_t wake_pins) {
+    clocks_to_xosc();
+    notify_clock_change();
+
+    while ((gpio_get_all() & wake_pins) == wake_pins) {
+        __wfe();
+    }
+
+    uint32_t t0 = time_us_32();
+    stats.xosc_us = 0;
+    wake_us       = t0;
+
+    set_sys_clock_pll(run_vco, run_postdiv1, run_postdiv2);
+    notify_clock_change();
+    stats.restore_us = time_us_32() - t0;
+}
+
+bool power_manager_add_clock_listener(power_clock_listener_t fn) {
+    if (listener_count >= POWER_MAX_CLOCK_LISTENERS) {
+        printf("Error: sin lugar para otro aviso de cambio de reloj\n");
+        return false;
+    }
+    listeners[listener_count++] = fn;
+    return true;
+}
+
+bool power_manager_set_sys_clock_khz(uint32_t khz) {
+    uint vco, postdiv1, postdiv2;
+
+    if (!check_sys_clock_khz(khz, &vco, &postdiv1, &postdiv2)) {
+        printf("Error: el PLL no genera %lu kHz\n", (unsigned long)khz);
+        return false;
+    }
+    power_manager_set_sys_clock_pll(vco, postdiv1, postdiv2);
+    return true;
+}
+
+void power_manager_set_sys_clock_pll(uint32_t vco_hz, uint32_t postdiv1, uint32_t postdiv2) {
+    uint32_t khz   = vco_hz / (postdiv1 * postdiv2) / KHZ;
+    bool     boost = khz > POWER_VREG_BOOST_KHZ;
+
+    // La tensión sube antes de acelerar y baja después de frenar
+    if (boost) {
+        vreg_set_voltage(VREG_VOLTAGE_1_15);
+        sleep_us(1000);
+    }
+    set_sys_clock_pll(vco_hz, postdiv1, postdiv2);
+    if (!boost) {
+        vreg_set_voltage(VREG_VOLTAGE_DEFAULT);
+    }
+
+    run_vco      = vco_hz;
+    run_postdiv1 = postdiv1;
+    run_postdiv2 = postdiv2;
+    notify_clock_change();
+}
+
+void power_manager_sleep(uint32_t wake_pins) {
+    stats.sleeps++;
+
+    // Sin USB conectado nada necesita el PLL USB: dormant
+    if (stdio_usb_connected()) {
+        sleep_light(wake_pins);
+    } else {
+        sleep_dormant(wake_pins);
+    }
+}
+
+uint32_t power_manager_wake_us(void) {
+    return wake_us;
+}
+
+power_stats_t power_manager_get_stats(void) {
+    return stats;
+}
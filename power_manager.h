@@ -0,0 +1,105 @@
+/**
+ * @file power_manager.h
+ * @brief Relojes del sistema, aviso de cambio de reloj y sueño hasta un botón.
+ *
+ * Los divisores de los periféricos (PIO del I2S, SPI de la SD, I2C de la
+ * IMU y de la LCD) dependen de clk_sys y clk_peri. Todo cambio de reloj
+ * pasa por este módulo, que al terminar llama a cada función registrada
+ * con power_manager_add_clock_listener() para que recalcule su divisor.
+ *
+ * power_manager_sleep() deja el chip en el menor consumo posible hasta que
+ * se pulsa un botón:
+ *  - Dormant (sin USB conectado): clk_ref y clk_sys pasan al XOSC, los dos
+ *    PLL se apagan y el XOSC se detiene hasta un flanco de bajada en uno de
+ *    los pines de despertar. El temporizador se detiene con él.
+ *  - Sueño ligero (con la consola USB conectada, que necesita el PLL USB):
+ *    clk_sys pasa al XOSC (12 MHz), el PLL del sistema se apaga y core0
+ *    duerme en __wfe() hasta que uno de los pines está en bajo.
+ *
+ * Antes de dormir, quien llama debe dejar quietos los periféricos que usan
+ * los relojes (motor de audio suspendido); al volver, los relojes y los
+ * divisores ya están restaurados.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Máximo de funciones avisadas al cambiar el reloj. */
+#define POWER_MAX_CLOCK_LISTENERS 8
+
+/** Por encima de este reloj (kHz) el núcleo necesita 1,15 V (datasheet, 200 MHz). */
+#define POWER_VREG_BOOST_KHZ 133000
+
+/**
+ * @brief Función avisada tras un cambio de reloj; lee las frecuencias
+ *        nuevas con clock_get_hz() y recalcula sus divisores.
+ */
+typedef void (*power_clock_listener_t)(void);
+
+/**
+ * @brief Estadísticas de los despertares.
+ */
+typedef struct {
+    uint32_t sleeps;        /**< Veces que se durmió. */
+    uint32_t dormant;       /**< De ellas, en dormant. */
+    uint32_t restore_us;    /**< Último tiempo de restauración de relojes y divisores. */
+    uint32_t xosc_us;       /**< Arranque del XOSC tras dormant (no lo ve el temporizador). */
+} power_stats_t;
+
+/**
+ * @brief Registra una función a avisar tras cada cambio de reloj.
+ * @return false si no quedan lugares.
+ */
+bool power_manager_add_clock_listener(power_clock_listener_t fn);
+
+/**
+ * @brief Cambia el reloj del sistema (clk_peri lo sigue) y avisa a los
+ *        registrados.
+ *
+ * Llamar desde core0 sin transferencias en curso por SPI ni I2C.
+ *
+ * @return false si la frecuencia no se puede generar exacta con el PLL.
+ */
+bool power_manager_set_sys_clock_khz(uint32_t khz);
+
+/**
+ * @brief Como power_manager_set_sys_clock_khz() con la configuración del
+ *        PLL ya elegida (ver clock_plan.h); sube la tensión del núcleo si
+ *        el reloj pasa de POWER_VREG_BOOST_KHZ.
+ *
+ * @param vco_hz Frecuencia del VCO (múltiplo de 12 MHz, 750-1600 MHz).
+ * @param postdiv1 Primer divisor de salida (1-7).
+ * @param postdiv2 Segundo divisor de salida (1-7, no mayor que @p postdiv1).
+ */
+void power_manager_set_sys_clock_pll(uint32_t vco_hz, uint32_t postdiv1, uint32_t postdiv2);
+
+/**
+ * @brief Duerme hasta un flanco de bajada en alguno de los pines de
+ *        @p wake_pins (máscara de GPIO) y restaura relojes y divisores.
+ *
+ * Llamar desde core0 con core1 sin trabajo pendiente.
+ */
+void power_manager_sleep(uint32_t wake_pins);
+
+/**
+ * @brief Instante del flanco que terminó el último sueño, en la escala de
+ *        time_us_32(): incluye el arranque del XOSC, durante el cual el
+ *        temporizador no avanza.
+ */
+uint32_t power_manager_wake_us(void);
+
+/**
+ * @brief Copia de las estadísticas de los despertares.
+ */
+power_stats_t power_manager_get_stats(void);
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,229 @@
+/**
+ * @file sample_cache.c
+ * @brief Implementación del caché de samples con páginas fijas y LRU.
+ *
+ * El pool se divide en SAMPLE_CACHE_PAGES páginas. Cada entrada tiene una
+ * lista de páginas que cubren, en orden, el comienzo del chunk data; el
+ * prefijo válido crece a medida que las voces leen el archivo desde la SD
+ * directamente sobre esas páginas. Al faltar páginas o entradas se desaloja
+ * la entrada menos usada recientemente entre las que no tienen referencias,
+ * por lo que nunca se mueve memoria que una voz esté reproduciendo.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "sample_cache.h"
+#include <string.h>
+
+/**
+ * @brief Entrada del caché.
+ */
+typedef struct {
+    char            key[SAMPLE_CACHE_KEY_LEN];
+    bool            used;
+    uint8_t         refs;         // voces que la están usando
+    uint8_t         npages;
+    uint8_t         pages[SAMPLE_CACHE_MAX_PAGES_PER_ENTRY];
+    uint32_t        valid_bytes;  // prefijo del chunk data ya cargado
+    uint32_t        last_use;     // marca LRU
+    sample_format_t fmt;
+} cache_entry_t;
+
+static uint8_t pool[SAMPLE_CACHE_PAGES][SAMPLE_CACHE_PAGE_SIZE] __attribute__((aligned(4)));
+
+static cache_entry_t entries[SAMPLE_CACHE_MAX_ENTRIES];
+
+// Pila de páginas libres
+static uint8_t free_pages[SAMPLE_CACHE_PAGES];
+static uint8_t free_count = 0;
+
+static uint32_t use_clock = 0;
+
+static uint32_t hits      = 0;
+static uint32_t misses    = 0;
+static uint32_t evictions = 0;
+
+/**
+ * @brief Devuelve las páginas de una entrada al pool y la marca libre.
+ */
+static void entry_free(cache_entry_t *e) {
+    for (uint8_t i = 0; i < e->npages; i++) {
+        free_pages[free_count++] = e->pages[i];
+    }
+    e->npages      = 0;
+    e->valid_bytes = 0;
+    e->used        = false;
+}
+
+/**
+ * @brief Desaloja la entrada LRU sin referencias.
+ * @return true si se desalojó alguna.
+ */
+static bool evict_lru(void) {
+    int victim = -1;
+
+    for (int i = 0; i < SAMPLE_CACHE_MAX_ENTRIES; i++) {
+        cache_entry_t *e = &entries[i];
+        if (!e->used || e->refs > 0) continue;
+
+        if (victim < 0 ||
+            (int32_t)(e->last_use - entries[victim].last_use) < 0) {
+            victim = i;
+        }
+    }
+
+    if (victim < 0) {
+        return false;
+    }
+
+    entry_free(&entries[victim]);
+    evictions++;
+    return true;
+}
+
+void sample_cache_init(void) {
+    for (int i = 0; i < SAMPLE_CACHE_MAX_ENTRIES; i++) {
+        entries[i].used   = false;
+        entries[i].refs   = 0;
+        entries[i].npages = 0;
+    }
+
+    free_count = 0;
+    for (int i = SAMPLE_CACHE_PAGES - 1; i >= 0; i--) {
+        free_pages[free_count++] = (uint8_t)i;
+    }
+
+    use_clock = 0;
+    hits      = 0;
+    misses    = 0;
+    evictions = 0;
+}
+
+int sample_cache_find(const char *key) {
+    for (int i = 0; i < SAMPLE_CACHE_MAX_ENTRIES; i++) {
+        cache_entry_t *e = &entries[i];
+        if (e->used && strncmp(e->key, key, SAMPLE_CACHE_KEY_LEN) == 0) {
+            e->refs++;
+            e->last_use = ++use_clock;
+            return i;
+        }
+    }
+    return -1;
+}
+
+int sample_cache_lookup(const char *key) {
+    int id = sample_cache_find(key);
+    if (id >= 0) {
+        hits++;
+    } else {
+        misses++;
+    }
+    return id;
+}
+
+int sample_cache_reserve(const char *key, const sample_format_t *fmt,
+                         uint8_t max_pages) {
+    if (strlen(key) >= SAMPLE_CACHE_KEY_LEN) {
+        return -1;
+    }
+
+    // Buscar entrada libre, desalojando si hace falta
+    int id = -1;
+    while (id < 0) {
+        for (int i = 0; i < SAMPLE_CACHE_MAX_ENTRIES; i++) {
+            if (!entries[i].used) {
+                id = i;
+                break;
+            }
+        }
+        if (id < 0 && !evict_lru()) {
+            return -1;
+        }
+    }
+
+    cache_entry_t *e = &entries[id];
+    e->used        = true;
+    e->refs        = 1;
+    e->npages      = 0;
+    e->valid_bytes = 0;
+    e->last_use    = ++use_clock;
+    e->fmt         = *fmt;
+    strncpy(e->key, key, SAMPLE_CACHE_KEY_LEN);
+
+    // Reservar páginas para el comienzo del audio
+    uint32_t wanted = (fmt->total_bytes + SAMPLE_CACHE_PAGE_SIZE - 1)
+                      / SAMPLE_CACHE_PAGE_SIZE;
+    if (max_pages > SAMPLE_CACHE_MAX_PAGES_PER_ENTRY) {
+        max_pages = SAMPLE_CACHE_MAX_PAGES_PER_ENTRY;
+    }
+    if (wanted > max_pages) {
+        wanted = max_pages;
+    }
+
+    while (e->npages < wanted) {
+        if (free_count == 0 && !evict_lru()) {
+            break;
+        }
+        e->pages[e->npages++] = free_pages[--free_count];
+    }
+
+    return id;
+}
+
+void sample_cache_release(int id) {
+    if (id < 0 || id >= SAMPLE_CACHE_MAX_ENTRIES) return;
+    if (entries[id].refs > 0) {
+        entries[id].refs--;
+    }
+}
+
+const sample_format_t *sample_cache_format(int id) {
+    return &entries[id].fmt;
+}
+
+uint32_t sample_cache_valid_bytes(int id) {
+    return entries[id].valid_bytes;
+}
+
+uint32_t sample_cache_capacity(int id) {
+    uint32_t cap = (uint32_t)entries[id].npages * SAMPLE_CACHE_PAGE_SIZE;
+    return (cap < entries[id].fmt.total_bytes) ? cap : entries[id].fmt.total_bytes;
+}
+
+uint8_t *sample_cache_page(int id, uint32_t offset) {
+    uint32_t page = offset / SAMPLE_CACHE_PAGE_SIZE;
+    if (page >= entries[id].npages) {
+        return NULL;
+    }
+    return pool[entries[id].pages[page]] + offset % SAMPLE_CACHE_PAGE_SIZE;
+}
+
+void sample_cache_commit(int id, uint32_t offset, uint32_t size) {
+    cache_entry_t *e = &entries[id];
+    if (offset == e->valid_bytes) {
+        e->valid_bytes += size;
+    }
+}
+
+sample_cache_stats_t sample_cache_get_stats(void) {
+    sample_cache_stats_t st = {
+        .hits         = hits,
+        .misses       = misses,
+        .evictions    = evictions,
+        .entries      = 0,
+        .pages_used   = (uint8_t)(SAMPLE_CACHE_PAGES - free_count),
+        .bytes_cached = 0
+    };
+
+    for (int i = 0; i < SAMPLE_CACHE_MAX_ENTRIES; i++) {
+        if (entries[i].used) {
+            st.entries++;
+            st.bytes_cached += entries[i].valid_bytes;
+        }
+    }
+    return st;
+}
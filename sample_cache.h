@@ -0,0 +1,135 @@
+/**
+ * @file sample_cache.h
+ * @brief Caché en RAM de samples WAV con presupuesto fijo y desalojo LRU.
+ *
+ * Guarda el PCM del chunk "data" de las notas tocadas recientemente en
+ * páginas de SAMPLE_CACHE_PAGE_SIZE bytes tomadas de un pool fijo. Cada
+ * entrada conserva además el formato y la posición del audio en el archivo,
+ * de modo que una nota en caché puede empezar a sonar sin tocar la SD.
+ *
+ * Una entrada puede contener el archivo completo o solo su comienzo
+ * (hasta SAMPLE_CACHE_MAX_PAGES_PER_ENTRY páginas); el resto se sigue
+ * leyendo de la SD.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sample_index.h"
+
+/** Tamaño de página del caché (igual al buffer de una voz). */
+#define SAMPLE_CACHE_PAGE_SIZE            2048
+
+/** Páginas del pool (48 x 2 KB = 96 KB de presupuesto). */
+#define SAMPLE_CACHE_PAGES                48
+
+/** Entradas máximas: 14 notas (7 x a/b) por cada uno de los 2 slots. */
+#define SAMPLE_CACHE_MAX_ENTRIES          28
+
+/** Páginas máximas por entrada (16 KB por nota). */
+#define SAMPLE_CACHE_MAX_PAGES_PER_ENTRY  8
+
+/** Longitud máxima de la clave (ruta del archivo). */
+#define SAMPLE_CACHE_KEY_LEN              32
+
+/**
+ * @brief Contadores del caché.
+ */
+typedef struct {
+    uint32_t hits;          /**< Búsquedas encontradas. */
+    uint32_t misses;        /**< Búsquedas no encontradas. */
+    uint32_t evictions;     /**< Entradas desalojadas por LRU. */
+    uint8_t  entries;       /**< Entradas ocupadas. */
+    uint8_t  pages_used;    /**< Páginas asignadas. */
+    uint32_t bytes_cached;  /**< Bytes de audio válidos en caché. */
+} sample_cache_stats_t;
+
+/**
+ * @brief Vacía el caché y reinicia los contadores.
+ */
+void sample_cache_init(void);
+
+/**
+ * @brief Busca una entrada por clave y toma una referencia si existe.
+ *
+ * @param key Ruta del archivo.
+ * @return Id de la entrada, o -1 si no está en caché.
+ */
+int sample_cache_lookup(const char *key);
+
+/**
+ * @brief Igual que sample_cache_lookup() pero sin contar aciertos ni fallos.
+ *
+ * La usa la precarga en segundo plano, para que las estadísticas reflejen
+ * solo las notas tocadas.
+ */
+int sample_cache_find(const char *key);
+
+/**
+ * @brief Crea una entrada vacía para ser llenada desde la SD.
+ *
+ * Reserva páginas para el comienzo del audio desalojando entradas LRU
+ * sin referencias. Devuelve la entrada con una referencia tomada.
+ *
+ * @param key Ruta del archivo.
+ * @param fmt Formato y ubicación del audio.
+ * @param max_pages Páginas máximas a reservar (como mucho
+ *        SAMPLE_CACHE_MAX_PAGES_PER_ENTRY).
+ * @return Id de la entrada, o -1 si no hubo memoria ni entradas libres.
+ */
+int sample_cache_reserve(const char *key, const sample_format_t *fmt,
+                         uint8_t max_pages);
+
+/**
+ * @brief Libera la referencia tomada con lookup/reserve.
+ */
+void sample_cache_release(int id);
+
+/**
+ * @brief Devuelve el formato guardado en la entrada.
+ */
+const sample_format_t *sample_cache_format(int id);
+
+/**
+ * @brief Bytes del comienzo del chunk data ya cargados en la entrada.
+ */
+uint32_t sample_cache_valid_bytes(int id);
+
+/**
+ * @brief Bytes que la entrada puede llegar a guardar (páginas reservadas).
+ */
+uint32_t sample_cache_capacity(int id);
+
+/**
+ * @brief Puntero al byte del chunk data en el offset dado, dentro de su página.
+ *
+ * Las páginas no son contiguas entre sí: un acceso no debe cruzar el final
+ * de la página.
+ *
+ * @param id Entrada.
+ * @param offset Offset dentro del chunk data.
+ * @return Puntero al byte, o NULL si está fuera de la capacidad.
+ */
+uint8_t *sample_cache_page(int id, uint32_t offset);
+
+/**
+ * @brief Marca como válidos los bytes recién escritos en la entrada.
+ *
+ * Solo extiende el prefijo válido si los bytes son contiguos a él.
+ */
+void sample_cache_commit(int id, uint32_t offset, uint32_t size);
+
+/**
+ * @brief Devuelve los contadores del caché.
+ */
+sample_cache_stats_t sample_cache_get_stats(void);
+
+#endif // SAMPLE_CACHE_H
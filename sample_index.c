@@ -0,0 +1,572 @@
+/**
+ * @file sample_index.c
+ * @brief Implementación del índice de cabeceras WAV y del analizador en memoria.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "sample_index.h"
+#include "sample_cache.h"
+#include "adpcm.h"
+#include "bank_format.h"
+#include "instrumentos.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Estado de cada entrada del índice.
+ */
+typedef enum {
+    SAMPLE_UNKNOWN = 0,   /**< Aún no se analizó. */
+    SAMPLE_OK,            /**< Cabecera válida guardada. */
+    SAMPLE_MISSING        /**< No existe o no es un WAV soportado. */
+} sample_state_t;
+
+static sample_format_t index_fmt[MAX_INSTRUMENTOS][SAMPLE_INDEX_VARIANTS][SAMPLE_INDEX_NOTES];
+static uint8_t         index_state[MAX_INSTRUMENTOS][SAMPLE_INDEX_VARIANTS][SAMPLE_INDEX_NOTES];
+static uint8_t         index_frags[MAX_INSTRUMENTOS][SAMPLE_INDEX_VARIANTS][SAMPLE_INDEX_NOTES];
+
+// Pool de mapas de clusters (asignación lineal, se reinicia con el índice)
+static DWORD    linkmap_pool[SAMPLE_LINKMAP_POOL_WORDS];
+static uint32_t linkmap_used = 0;
+
+// Bancos abiertos (uno por instrumento; se comparten entre las voces)
+static FIL  bank_files[MAX_INSTRUMENTOS];
+static bool bank_open[MAX_INSTRUMENTOS];
+
+#if WAV_HEADER_READ_SIZE < BANK_HEADER_SIZE
+#error "El sector de trabajo debe poder contener la cabecera de un banco"
+#endif
+
+/** Bytes de un chunk "smpl" con un lazo: cabecera del chunk, 36 de datos y el lazo. */
+#define SMPL_CHUNK_MIN_BYTES  (8 + 36 + 24)
+
+/** Sector de trabajo para analizar cabeceras (fuera de la pila). */
+static uint8_t header_buf[WAV_HEADER_READ_SIZE] __attribute__((aligned(4)));
+
+static const char *note_tokens[SAMPLE_INDEX_NOTES] = {
+    "do", "re", "mi", "fa", "sol", "la", "si"
+};
+
+/** Destino de los mensajes (NULL = printf). */
+static sample_index_log_callback_t log_callback = NULL;
+
+/**
+ * @brief Imprime un mensaje, o lo pasa al callback de mensajes si hay uno.
+ */
+static void index_log(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (log_callback) {
+        log_callback(format, args);
+    } else {
+        vprintf(format, args);
+    }
+    va_end(args);
+}
+
+/** Lectura little-endian sin accesos desalineados (el M0+ no los admite). */
+static uint16_t rd16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Garantiza que los bytes [pos, pos+need) del archivo estén en buf.
+ *
+ * Si no lo están, lee un sector nuevo a partir de pos.
+ */
+static bool ensure_window(FIL *file, uint8_t *buf, uint32_t *base, UINT *len,
+                          uint32_t pos, uint32_t need) {
+    if (pos >= *base && pos + need <= *base + *len) {
+        return true;
+    }
+
+    if (f_lseek(file, pos) != FR_OK) {
+        return false;
+    }
+    if (f_read(file, buf, WAV_HEADER_READ_SIZE, len) != FR_OK) {
+        return false;
+    }
+    *base = pos;
+    return need <= *len;
+}
+
+/**
+ * @brief Comprueba que el formato sea reproducible (PCM 16 bits o IMA ADPCM).
+ */
+static bool format_supported(const sample_format_t *fmt) {
+    if (fmt->channels != 1 && fmt->channels != 2) {
+        index_log("Solo 1 o 2 canales (archivo: %u)\n", fmt->channels);
+        return false;
+    }
+    if (fmt->format == WAV_FORMAT_PCM) {
+        if (fmt->bits != 16) {
+            index_log("Solo 16 bits soportados (archivo: %u bits)\n", fmt->bits);
+            return false;
+        }
+        return true;
+    }
+    if (fmt->format == WAV_FORMAT_IMA_ADPCM) {
+        // Cabecera por canal, en estéreo grupos completos de 8 bytes,
+        // y bloques que nunca crucen de una página (o buffer) a otra
+        uint32_t hdr = ADPCM_HEADER_BYTES * fmt->channels;
+        if (fmt->bits != 4 || fmt->block_align <= hdr ||
+            SAMPLE_CACHE_PAGE_SIZE % fmt->block_align != 0 ||
+            (fmt->channels == 2 &&
+             (fmt->block_align - hdr) % ADPCM_STEREO_GROUP != 0)) {
+            index_log("ADPCM no soportado (%u bits, bloque %u)\n",
+                      fmt->bits, fmt->block_align);
+            return false;
+        }
+        return true;
+    }
+    index_log("Formato no soportado (%u)\n", fmt->format);
+    return false;
+}
+
+/**
+ * @brief Descarta el lazo de sostenido si no se puede reproducir.
+ *
+ * Solo se admiten lazos en PCM, alineados a frames, dentro del audio y de
+ * al menos SAMPLE_LOOP_MIN_FRAMES frames.
+ */
+static void loop_check(sample_format_t *fmt) {
+    if (fmt->loop_end == 0) {
+        fmt->loop_start = 0;
+        return;
+    }
+
+    uint32_t    frame = (uint32_t)fmt->channels * 2u;
+    const char *why   = NULL;
+
+    if (fmt->format != WAV_FORMAT_PCM) {
+        why = "solo PCM";
+    } else if (fmt->loop_start % frame != 0 || fmt->loop_end % frame != 0) {
+        why = "no alineado a frames";
+    } else if (fmt->loop_start >= fmt->loop_end || fmt->loop_end > fmt->total_bytes) {
+        why = "fuera del audio";
+    } else if ((fmt->loop_end - fmt->loop_start) / frame < SAMPLE_LOOP_MIN_FRAMES) {
+        why = "demasiado corto";
+    }
+
+    if (why) {
+        index_log("Lazo de sostenido ignorado (%s)\n", why);
+        fmt->loop_start = 0;
+        fmt->loop_end   = 0;
+    }
+}
+
+bool sample_index_read_header(FIL *file, sample_format_t *fmt) {
+    uint8_t *buf  = header_buf;
+    uint32_t base = 0;
+    UINT     len  = 0;
+
+    fmt->linkmap  = NULL;
+    fmt->bank     = NULL;
+    fmt->atten_q8 = 256;
+    fmt->loop_start = 0;
+    fmt->loop_end   = 0;
+
+    if (f_lseek(file, 0) != FR_OK ||
+        f_read(file, buf, WAV_HEADER_READ_SIZE, &len) != FR_OK ||
+        len < 12) {
+        index_log("Error al leer RIFF\n");
+        return false;
+    }
+
+    if (memcmp(buf, "RIFF", 4) != 0 || memcmp(buf + 8, "WAVE", 4) != 0) {
+        index_log("Archivo no es WAV válido\n");
+        return false;
+    }
+
+    bool     fmt_found  = false;
+    bool     data_found = false;
+    bool     loop_found = false;
+    uint16_t audio_fmt  = 0;
+    uint32_t loop_first = 0;
+    uint32_t loop_last  = 0;
+    uint32_t pos        = 12;
+    uint32_t file_size  = (uint32_t)f_size(file);
+
+    while (pos + 8 <= file_size) {
+        if (!ensure_window(file, buf, &base, &len, pos, 8)) {
+            break;
+        }
+
+        const uint8_t *chunk = buf + (pos - base);
+        uint32_t size = rd32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (size < 16 || !ensure_window(file, buf, &base, &len, pos + 8, 16)) {
+                break;
+            }
+            const uint8_t *f = buf + (pos + 8 - base);
+            audio_fmt        = rd16(f + 0);
+            fmt->channels    = rd16(f + 2);
+            fmt->sample_rate = rd32(f + 4);
+            fmt->block_align = rd16(f + 12);
+            fmt->bits        = rd16(f + 14);
+            fmt_found        = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!fmt_found) {
+                break;
+            }
+            fmt->data_offset = pos + 8;
+            fmt->total_bytes = size;
+            data_found       = true;
+
+            // Un archivo truncado declara más audio del que contiene
+            if (fmt->total_bytes > file_size - fmt->data_offset) {
+                fmt->total_bytes = file_size - fmt->data_offset;
+            }
+        } else if (memcmp(chunk, "smpl", 4) == 0) {
+            // Cabecera de 36 bytes y, si hay lazos, el primero: inicio y
+            // fin en frames (el fin es el último frame del lazo)
+            if (size >= SMPL_CHUNK_MIN_BYTES - 8 &&
+                ensure_window(file, buf, &base, &len, pos + 8, 36 + 24)) {
+                const uint8_t *sm = buf + (pos + 8 - base);
+                if (rd32(sm + 28) > 0) {
+                    loop_first = rd32(sm + 36 + 8);
+                    loop_last  = rd32(sm + 36 + 12);
+                    loop_found = true;
+                }
+            }
+        }
+
+        // Saltar el chunk (los chunks RIFF se alinean a 2 bytes); tras el
+        // audio se sigue solo para buscar el chunk "smpl"
+        uint32_t next = pos + 8 + size + (size & 1u);
+        if (next <= pos) {
+            break;   // tamaño corrupto
+        }
+        pos = next;
+
+        // Sin leer más allá del audio si el lazo ya apareció antes o si lo
+        // que queda del archivo no alcanza para un chunk "smpl"
+        if (data_found && (loop_found || pos + SMPL_CHUNK_MIN_BYTES > file_size)) {
+            break;
+        }
+    }
+
+    if (!data_found) {
+        index_log(fmt_found ? " No se encontró chunk 'data'\n"
+                            : "No se encontró chunk 'fmt'\n");
+        return false;
+    }
+
+    fmt->format = audio_fmt;
+    if (!format_supported(fmt)) {
+        return false;
+    }
+
+    if (loop_found) {
+        uint64_t frame = (uint64_t)fmt->channels * 2u;
+        uint64_t start = loop_first * frame;
+        uint64_t end   = ((uint64_t)loop_last + 1u) * frame;
+        fmt->loop_start = (start > UINT32_MAX) ? UINT32_MAX : (uint32_t)start;
+        fmt->loop_end   = (end   > UINT32_MAX) ? UINT32_MAX : (uint32_t)end;
+        loop_check(fmt);
+    }
+    return true;
+}
+
+uint32_t sample_index_create_linkmap(FIL *file, DWORD *tbl, uint32_t words,
+                                     uint8_t *fragments) {
+#if FF_USE_FASTSEEK
+    tbl[0]      = words;
+    file->cltbl = tbl;
+
+    FRESULT fr = f_lseek(file, CREATE_LINKMAP);
+
+    // tbl[0] queda con las palabras usadas (o necesarias, si no alcanzó)
+    uint32_t needed = tbl[0];
+    if (fragments) {
+        uint32_t n = (needed > 2) ? (needed - 2) / 2 : 0;
+        *fragments = (n > 255) ? 255 : (uint8_t)n;
+    }
+
+    if (fr != FR_OK) {
+        file->cltbl = NULL;
+        return 0;
+    }
+    return needed;
+#else
+    (void)file; (void)tbl; (void)words;
+    if (fragments) *fragments = 0;
+    return 0;
+#endif
+}
+
+const char *sample_index_note_token(uint8_t note) {
+    return (note < SAMPLE_INDEX_NOTES) ? note_tokens[note] : "do";
+}
+
+void sample_index_set_log_callback(sample_index_log_callback_t cb) {
+    log_callback = cb;
+}
+
+bool sample_index_path(char *buf, size_t len, uint8_t inst, char variant, uint8_t note) {
+    uint8_t inst_id = (inst < total_instrumentos) ? instrumentos_id[inst] : 1;
+
+    int n = snprintf(buf, len, "0:/i%u%c-%s.wav",
+                     inst_id, variant, sample_index_note_token(note));
+    return n > 0 && (size_t)n < len;
+}
+
+bool sample_index_bank_path(char *buf, size_t len, uint8_t inst) {
+    uint8_t inst_id = (inst < total_instrumentos) ? instrumentos_id[inst] : 1;
+
+    int n = snprintf(buf, len, "0:/i%u.bnk", inst_id);
+    return n > 0 && (size_t)n < len;
+}
+
+/**
+ * @brief Reserva un mapa de clusters del pool para un archivo abierto.
+ * @return El mapa, o NULL si no cupo o el archivo está demasiado fragmentado.
+ */
+static DWORD *pool_linkmap(FIL *file, uint8_t *fragments) {
+    uint32_t avail = SAMPLE_LINKMAP_POOL_WORDS - linkmap_used;
+    if (avail > SAMPLE_LINKMAP_WORDS) {
+        avail = SAMPLE_LINKMAP_WORDS;
+    }
+
+    DWORD   *tbl  = &linkmap_pool[linkmap_used];
+    uint32_t used = (avail > 2)
+                    ? sample_index_create_linkmap(file, tbl, avail, fragments)
+                    : 0;
+    if (used == 0) {
+        return NULL;
+    }
+    linkmap_used += used;
+    return tbl;
+}
+
+/**
+ * @brief Abre el banco de un instrumento y carga su tabla de notas.
+ *
+ * @param inst Índice en la tabla de instrumentos.
+ * @param found Devuelve las notas válidas del banco.
+ * @return false si el instrumento no tiene banco (o no es válido).
+ */
+static bool bank_load(uint8_t inst, uint8_t *found) {
+    char path[40];
+    FIL *fp = &bank_files[inst];
+    UINT len;
+
+    if (bank_open[inst]) {
+        f_close(fp);
+        bank_open[inst] = false;
+    }
+
+    if (!sample_index_bank_path(path, sizeof(path), inst) ||
+        f_open(fp, path, FA_READ) != FR_OK) {
+        return false;
+    }
+
+    const uint8_t *h = header_buf;
+    if (f_read(fp, header_buf, BANK_HEADER_SIZE, &len) != FR_OK ||
+        len < BANK_HEADER_SIZE ||
+        memcmp(h, BANK_MAGIC, 4) != 0 ||
+        (rd16(h + 4) != BANK_VERSION && rd16(h + 4) != BANK_VERSION_V1) ||
+        rd16(h + 6) != BANK_ENTRIES) {
+        index_log("Banco inválido: %s\n", path);
+        f_close(fp);
+        return false;
+    }
+
+    // Los bancos de la versión 1 tienen entradas más cortas y sin lazo
+    bool     v1         = (rd16(h + 4) == BANK_VERSION_V1);
+    uint32_t entry_size = v1 ? BANK_ENTRY_SIZE_V1 : BANK_ENTRY_SIZE;
+
+    uint8_t  frags     = 0;
+    DWORD   *map       = pool_linkmap(fp, &frags);
+    uint32_t file_size = (uint32_t)f_size(fp);
+
+    *found = 0;
+    for (uint8_t v = 0; v < SAMPLE_INDEX_VARIANTS; v++) {
+        for (uint8_t n = 0; n < SAMPLE_INDEX_NOTES; n++) {
+            const uint8_t *e = h + BANK_TABLE_OFFSET +
+                               (v * BANK_NOTES + n) * entry_size;
+            sample_format_t *fmt = &index_fmt[inst][v][n];
+
+            fmt->data_offset = rd32(e + BANK_E_OFFSET);
+            fmt->total_bytes = rd32(e + BANK_E_LENGTH);
+            fmt->sample_rate = rd32(e + BANK_E_SAMPLE_RATE);
+            fmt->channels    = rd16(e + BANK_E_CHANNELS);
+            fmt->bits        = rd16(e + BANK_E_BITS);
+            fmt->format      = rd16(e + BANK_E_FORMAT);
+            fmt->block_align = rd16(e + BANK_E_BLOCK_ALIGN);
+            fmt->linkmap     = map;
+            fmt->bank        = fp;
+            fmt->atten_q8    = rd16(e + BANK_E_ATTEN);
+            fmt->loop_start  = v1 ? 0 : rd32(e + BANK_E_LOOP_START);
+            fmt->loop_end    = v1 ? 0 : rd32(e + BANK_E_LOOP_END);
+            index_frags[inst][v][n] = frags;
+
+            // 0 (bancos sin atenuar) o fuera de rango: audio a nivel original
+            if (fmt->atten_q8 < BANK_MIN_ATTEN_Q8 || fmt->atten_q8 > 256) {
+                fmt->atten_q8 = 256;
+            }
+
+            // Sin sumar los dos campos: en un banco corrupto la suma puede
+            // desbordar y aceptar una entrada fuera del archivo
+            bool ok = fmt->data_offset != 0 &&
+                      fmt->data_offset <= file_size &&
+                      fmt->total_bytes <= file_size - fmt->data_offset &&
+                      format_supported(fmt);
+            if (ok) {
+                loop_check(fmt);
+            }
+
+            index_state[inst][v][n] = ok ? SAMPLE_OK : SAMPLE_MISSING;
+            if (ok) (*found)++;
+        }
+    }
+
+    bank_open[inst] = true;
+    return true;
+}
+
+/**
+ * @brief Analiza y guarda la cabecera de una entrada del índice.
+ */
+static bool index_parse(uint8_t inst, uint8_t v, uint8_t note) {
+    char path[40];
+    FIL  file;
+
+    index_state[inst][v][note] = SAMPLE_MISSING;
+
+    if (!sample_index_path(path, sizeof(path), inst, (char)('a' + v), note)) {
+        return false;
+    }
+    if (f_open(&file, path, FA_READ) != FR_OK) {
+        return false;
+    }
+
+    // Mapa de clusters en el pool (se descarta si no cabe). Se crea antes
+    // de leer la cabecera para que buscar el chunk "smpl" tras el audio
+    // salte con el mapa en lugar de recorrer la FAT
+    sample_format_t *fmt     = &index_fmt[inst][v][note];
+    uint32_t         pool_at = linkmap_used;
+    DWORD           *linkmap = pool_linkmap(&file, &index_frags[inst][v][note]);
+    bool             ok      = sample_index_read_header(&file, fmt);
+
+    if (ok) {
+        fmt->linkmap = linkmap;
+        index_state[inst][v][note] = SAMPLE_OK;
+    } else {
+        linkmap_used = pool_at;
+    }
+
+    f_close(&file);
+    return ok;
+}
+
+uint8_t sample_index_load_instrument(uint8_t inst) {
+    if (inst >= MAX_INSTRUMENTOS) return 0;
+
+    uint8_t found = 0;
+    if (bank_load(inst, &found)) {
+        return found;
+    }
+
+    for (uint8_t v = 0; v < SAMPLE_INDEX_BOOT_VARIANTS; v++) {
+        for (uint8_t n = 0; n < SAMPLE_INDEX_NOTES; n++) {
+            if (index_parse(inst, v, n)) found++;
+        }
+    }
+    return found;
+}
+
+void sample_index_build(void) {
+    memset(index_state, SAMPLE_UNKNOWN, sizeof(index_state));
+    memset(index_frags, 0, sizeof(index_frags));
+    linkmap_used = 0;
+
+    for (uint8_t i = 0; i < total_instrumentos; i++) {
+        uint8_t found = sample_index_load_instrument(i);
+        index_log("  [%u] id=%u: %u/%u notas indexadas (%s)\n",
+                  i, instrumentos_id[i], found,
+                  (bank_open[i] ? SAMPLE_INDEX_VARIANTS : SAMPLE_INDEX_BOOT_VARIANTS) *
+                  SAMPLE_INDEX_NOTES,
+                  bank_open[i] ? "banco" : "archivos WAV");
+    }
+
+    index_log("  Mapas de clusters: %lu/%u palabras usadas\n",
+              (unsigned long)linkmap_used, SAMPLE_LINKMAP_POOL_WORDS);
+}
+
+void sample_index_report_fragmentation(uint8_t threshold) {
+    char    path[40];
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < total_instrumentos; i++) {
+        if (bank_open[i]) {
+            // Un banco es un solo archivo: un mapa para todas sus notas
+            bool no_map = (index_fmt[i][0][0].linkmap == NULL);
+            if (index_frags[i][0][0] >= threshold || no_map) {
+                sample_index_bank_path(path, sizeof(path), i);
+                index_log("  %s: %u fragmentos%s\n", path, index_frags[i][0][0],
+                          no_map ? " (sin mapa de clusters)" : "");
+                count++;
+            }
+            continue;
+        }
+
+        for (uint8_t v = 0; v < SAMPLE_INDEX_VARIANTS; v++) {
+            for (uint8_t n = 0; n < SAMPLE_INDEX_NOTES; n++) {
+                if (index_state[i][v][n] != SAMPLE_OK) continue;
+
+                bool no_map = (index_fmt[i][v][n].linkmap == NULL);
+                if (index_frags[i][v][n] < threshold && !no_map) continue;
+
+                sample_index_path(path, sizeof(path), i, (char)('a' + v), n);
+                index_log("  %s: %u fragmentos%s\n", path, index_frags[i][v][n],
+                          no_map ? " (sin mapa de clusters)" : "");
+                count++;
+            }
+        }
+    }
+
+    if (count == 0) {
+        index_log("  Ningún sample con %u o más fragmentos\n", threshold);
+    }
+}
+
+void sample_index_forget_missing(uint8_t inst) {
+    if (inst >= MAX_INSTRUMENTOS) return;
+
+    for (uint8_t v = 0; v < SAMPLE_INDEX_VARIANTS; v++) {
+        for (uint8_t n = 0; n < SAMPLE_INDEX_NOTES; n++) {
+            if (index_state[inst][v][n] == SAMPLE_MISSING) {
+                index_state[inst][v][n] = SAMPLE_UNKNOWN;
+            }
+        }
+    }
+}
+
+const sample_format_t *sample_index_get(uint8_t inst, char variant, uint8_t note) {
+    if (inst >= MAX_INSTRUMENTOS || note >= SAMPLE_INDEX_NOTES ||
+        (variant != 'a' && variant != 'b')) {
+        return NULL;
+    }
+
+    uint8_t v = (uint8_t)(variant - 'a');
+
+    if (index_state[inst][v][note] == SAMPLE_UNKNOWN) {
+        index_parse(inst, v, note);
+    }
+
+    return (index_state[inst][v][note] == SAMPLE_OK)
+           ? &index_fmt[inst][v][note]
+           : NULL;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file sample_index.h
+ * @brief Índice en RAM de las cabeceras WAV de cada nota de cada instrumento.
+ *
+ * Las cabeceras de los archivos "0:/i<id><a|b>-<nota>.wav" se analizan una
+ * sola vez (las 'a' al arrancar, las 'b' solo si se piden) y se guardan en
+ * una tabla compacta indexada por instrumento, variante y nota. Al tocar
+ * una nota el reproductor salta directamente al audio. Las notas que
+ * faltaban se vuelven a buscar la primera vez que se piden después de
+ * seleccionar de nuevo su instrumento.
+ *
+ * El análisis de una cabecera se hace sobre un sector leído de una vez y
+ * procesado en memoria, en lugar de una cadena de f_read/f_lseek pequeños.
+ *
+ * Junto con la cabecera se crea el mapa de clusters de FatFs (fast seek,
+ * CLMT) de cada archivo, de modo que las lecturas y saltos durante la
+ * reproducción nunca recorren la FAT.
+ *
+ * Si el WAV trae un chunk "smpl", su primer lazo (inicio y fin en frames)
+ * se guarda como lazo de sostenido: mientras la tecla siga pulsada, el
+ * reproductor repite ese tramo en lugar de seguir leyendo el archivo.
+ *
+ * Si existe el banco del instrumento ("0:/i<id>.bnk", ver bank_format.h),
+ * se usa en lugar de los archivos sueltos: cargar el instrumento es un
+ * f_open y la lectura de una tabla, y el banco queda abierto, de modo que
+ * tocar una nota es un solo salto dentro de ese archivo.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef SAMPLE_INDEX_H
+#define SAMPLE_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include "ff.h"
+
+/** Notas por instrumento (do..si). */
+#define SAMPLE_INDEX_NOTES     7
+
+/** Variantes de sonido por nota ('a' y 'b'). */
+#define SAMPLE_INDEX_VARIANTS  2
+
+/**
+ * Variantes que se indexan al arrancar. Las notas solo tocan la 'a' (el
+ * tremolo reemplazó a la 'b'); una 'b' se analiza si alguien la pide.
+ */
+#define SAMPLE_INDEX_BOOT_VARIANTS  1
+
+/** Bytes leídos de una vez para analizar una cabecera (un sector). */
+#define WAV_HEADER_READ_SIZE   512
+
+/** Fragmentos máximos con mapa de clusters; archivos más fragmentados se leen sin él. */
+#define SAMPLE_LINKMAP_MAX_FRAGMENTS  8
+
+/** Palabras de un mapa de clusters con el máximo de fragmentos. */
+#define SAMPLE_LINKMAP_WORDS  (2 + 2 * SAMPLE_LINKMAP_MAX_FRAGMENTS)
+
+/** Palabras del pool de mapas del índice (4 KB). */
+#define SAMPLE_LINKMAP_POOL_WORDS  1024
+
+/** Formato WAV PCM lineal. */
+#define WAV_FORMAT_PCM        0x0001
+
+/** Formato WAV IMA/DVI ADPCM (4 bits por muestra). */
+#define WAV_FORMAT_IMA_ADPCM  0x0011
+
+/** Frames mínimos de un lazo de sostenido; los más cortos se ignoran. */
+#define SAMPLE_LOOP_MIN_FRAMES  1024
+
+/** Fragmentos a partir de los cuales el diagnóstico avisa de un archivo. */
+#define SAMPLE_FRAGMENT_WARN  3
+
+/**
+ * @brief Formato y ubicación del audio de un sample.
+ */
+typedef struct {
+    uint32_t sample_rate;   /**< Frecuencia de muestreo. */
+    uint16_t channels;      /**< Número de canales (1 o 2). */
+    uint16_t bits;          /**< Bits por muestra (16 en PCM, 4 en ADPCM). */
+    uint16_t format;        /**< WAV_FORMAT_PCM o WAV_FORMAT_IMA_ADPCM. */
+    uint16_t block_align;   /**< Bytes por bloque (frame en PCM, bloque ADPCM). */
+    uint32_t data_offset;   /**< Offset del chunk data en el archivo. */
+    uint32_t total_bytes;   /**< Tamaño total del chunk data. */
+    DWORD   *linkmap;       /**< Mapa de clusters (fast seek), o NULL. */
+    FIL     *bank;          /**< Banco abierto que contiene el audio, o NULL si es un WAV suelto. */
+    uint16_t atten_q8;      /**< Atenuación ya aplicada al audio en Q8 (256 = ninguna). */
+    uint32_t loop_start;    /**< Inicio del lazo de sostenido en el chunk data (bytes). */
+    uint32_t loop_end;      /**< Fin del lazo, excluido (bytes), o 0 si no tiene lazo. */
+} sample_format_t;
+
+/**
+ * @brief Destino de los mensajes del índice (con formato de printf).
+ */
+typedef void (*sample_index_log_callback_t)(const char *format, va_list args);
+
+/**
+ * @brief Lee la cabecera de un WAV abierto y la analiza en memoria.
+ *
+ * Lee un sector desde el inicio del archivo; solo vuelve a leer si algún
+ * chunk previo al audio no cabe en él, o para buscar un chunk "smpl"
+ * después del audio (si no apareció antes y aún cabe uno). Acepta PCM de
+ * 16 bits e IMA ADPCM de 4 bits (con bloques que dividen la página del
+ * caché), mono o estéreo; el lazo de sostenido solo se admite en PCM.
+ *
+ * @param file Archivo abierto (la posición de lectura queda indefinida).
+ * @param fmt Devuelve formato y ubicación del chunk data.
+ * @return true si el archivo es un WAV válido y soportado.
+ */
+bool sample_index_read_header(FIL *file, sample_format_t *fmt);
+
+/**
+ * @brief Crea el mapa de clusters de FatFs para un archivo recién abierto.
+ *
+ * Si el archivo necesita más de @p words palabras (demasiado fragmentado)
+ * o fast seek no está habilitado, deja el archivo sin mapa.
+ *
+ * @param file Archivo abierto.
+ * @param tbl Tabla destino.
+ * @param words Tamaño de la tabla en palabras.
+ * @param fragments Devuelve el número de fragmentos del archivo (puede ser NULL).
+ * @return Palabras usadas por el mapa, o 0 si no se creó.
+ */
+uint32_t sample_index_create_linkmap(FIL *file, DWORD *tbl, uint32_t words,
+                                     uint8_t *fragments);
+
+/**
+ * @brief Analiza las cabeceras de las notas 'a' de todos los instrumentos
+ *        cargados desde index.txt y crea sus mapas de clusters.
+ */
+void sample_index_build(void);
+
+/**
+ * @brief Imprime los archivos indexados con al menos @p threshold
+ *        fragmentos o sin mapa de clusters.
+ */
+void sample_index_report_fragmentation(uint8_t threshold);
+
+/**
+ * @brief Carga el banco de un instrumento (todas sus notas: la tabla cabe
+ *        en un sector) o, si no existe, analiza las cabeceras de sus
+ *        archivos sueltos (las SAMPLE_INDEX_BOOT_VARIANTS primeras variantes).
+ * @param inst Índice en la tabla de instrumentos.
+ * @return Número de archivos válidos encontrados.
+ */
+uint8_t sample_index_load_instrument(uint8_t inst);
+
+/**
+ * @brief Marca para reintentar las notas de un instrumento que faltaban.
+ *
+ * Se llama al seleccionar el instrumento: si entretanto se copió el
+ * archivo a la SD, sample_index_get() lo analiza la próxima vez.
+ *
+ * @param inst Índice en la tabla de instrumentos.
+ */
+void sample_index_forget_missing(uint8_t inst);
+
+/**
+ * @brief Devuelve el formato de una nota, analizándola si aún no se hizo.
+ *
+ * @param inst Índice en la tabla de instrumentos.
+ * @param variant 'a' o 'b'.
+ * @param note Índice de nota 0..6 (do..si).
+ * @return Puntero al formato, o NULL si el archivo no existe o no es válido.
+ */
+const sample_format_t *sample_index_get(uint8_t inst, char variant, uint8_t note);
+
+/**
+ * @brief Construye la ruta del archivo de una nota ("0:/i<id><v>-<nota>.wav").
+ * @return true si la ruta cupo en el buffer.
+ */
+bool sample_index_path(char *buf, size_t len, uint8_t inst, char variant, uint8_t note);
+
+/**
+ * @brief Construye la ruta del banco de un instrumento ("0:/i<id>.bnk").
+ * @return true si la ruta cupo en el buffer.
+ */
+bool sample_index_bank_path(char *buf, size_t len, uint8_t inst);
+
+/**
+ * @brief Nombre corto de la nota usado en los archivos ("do", "re", ...).
+ */
+const char *sample_index_note_token(uint8_t note);
+
+/**
+ * @brief Registra el destino de los mensajes (NULL = printf).
+ *
+ * Al arrancar el índice se construye en core0 e imprime directamente; las
+ * notas que se indexan después (variantes 'b', notas que faltaban) se
+ * analizan en core1, que deja sus mensajes para que otro núcleo los
+ * imprima.
+ */
+void sample_index_set_log_callback(sample_index_log_callback_t cb);
+
+#endif // SAMPLE_INDEX_H
@@ -64,6 +64,15 @@ void sd_manager_deinit() {
     }
 }
 
+void sd_manager_clock_changed(void) {
+    if (!sd_ready) return;
+
+    sd_card_t *pSD = sd_get_by_num(0);
+    if (pSD) {
+        spi_set_baudrate(pSD->spi->hw_inst, pSD->spi->baud_rate);
+    }
+}
+
 /**
  * @brief Indica si la tarjeta SD está inicializada y lista.
  */
@@ -43,4 +43,13 @@ bool sd_manager_is_ready();
  */
 void sd_manager_list_wav_files();
 
+/**
+ * @brief Vuelve a fijar la velocidad del SPI de la SD tras un cambio de
+ *        clk_peri (aviso de cambio de reloj, ver power_manager.h).
+ *
+ * La SD no tiene alimentación conmutada: entre lecturas queda en reposo
+ * con CS en alto.
+ */
+void sd_manager_clock_changed(void);
+
 #endif // SD_MANAGER_H
@@ -0,0 +1,60 @@
+/**
+ * @file hardware/clocks.h
+ * @brief Sustituto de hardware/clocks.h.
+ *
+ * La frecuencia del sistema fija la velocidad del PIO (y por tanto del
+ * I2S) en la simulación; no afecta al costo del código, que es cero.
+ */
+
+#ifndef SIM_HARDWARE_CLOCKS_H
+#define SIM_HARDWARE_CLOCKS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum clock_index {
+    clk_gpout0 = 0,
+    clk_gpout1,
+    clk_gpout2,
+    clk_gpout3,
+    clk_ref,
+    clk_sys,
+    clk_peri,
+    clk_usb,
+    clk_adc,
+    clk_rtc,
+    CLK_COUNT
+};
+
+#define KHZ     1000u
+#define MHZ     1000000u
+#define XOSC_HZ 12000000u
+
+// PLL del sistema que deja el arranque del SDK (125 MHz)
+#define PLL_SYS_VCO_FREQ_HZ (1500u * MHZ)
+#define PLL_SYS_POSTDIV1    6u
+#define PLL_SYS_POSTDIV2    2u
+
+// Fuentes usadas por el firmware (los valores de hardware/regs/clocks.h)
+#define CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF            0x0u
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS        0x0u
+#define CLOCKS_CLK_USB_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB  0x0u
+#define CLOCKS_CLK_ADC_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB  0x0u
+#define CLOCKS_CLK_RTC_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB  0x0u
+#define CLOCKS_CLK_RTC_CTRL_AUXSRC_VALUE_XOSC_CLKSRC     0x3u
+
+uint32_t clock_get_hz(enum clock_index clk_index);
+bool     set_sys_clock_khz(uint32_t freq_khz, bool required);
+void     set_sys_clock_pll(uint32_t vco_freq, unsigned int post_div1, unsigned int post_div2);
+bool     check_sys_clock_khz(uint32_t freq_khz, unsigned int *vco_freq_out,
+                             unsigned int *post_div1_out, unsigned int *post_div2_out);
+
+/**
+ * @brief Solo la frecuencia importa: la de clk_sys (que clk_peri sigue)
+ *        fija la velocidad del PIO.
+ */
+bool clock_configure(enum clock_index clk_index, uint32_t src, uint32_t auxsrc,
+                     uint32_t src_freq, uint32_t freq);
+void clock_stop(enum clock_index clk_index);
+
+#endif // SIM_HARDWARE_CLOCKS_H
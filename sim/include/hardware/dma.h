@@ -0,0 +1,73 @@
+/**
+ * @file hardware/dma.h
+ * @brief Sustituto de hardware/dma.h.
+ *
+ * Un canal ligado a la DREQ de un state machine del PIO avanza al ritmo
+ * del PIO: tarda tantos frames como palabras transfiere. Al terminar
+ * arranca el canal encadenado y levanta su IRQ.
+ */
+
+#ifndef SIM_HARDWARE_DMA_H
+#define SIM_HARDWARE_DMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+#define NUM_DMA_CHANNELS 12
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8  = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct {
+    enum dma_channel_transfer_size size;
+    bool read_increment;
+    bool write_increment;
+    uint dreq;
+    uint chain_to;
+} dma_channel_config;
+
+int  dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+
+dma_channel_config dma_channel_get_default_config(uint channel);
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c,
+                                                         enum dma_channel_transfer_size size) {
+    c->size = size;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->read_increment = incr;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->write_increment = incr;
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    c->dreq = dreq;
+}
+
+static inline void channel_config_set_chain_to(dma_channel_config *c, uint chain_to) {
+    c->chain_to = chain_to;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint transfer_count, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_start(uint channel);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled);
+bool dma_channel_get_irq1_status(uint channel);
+void dma_channel_acknowledge_irq1(uint channel);
+
+#endif // SIM_HARDWARE_DMA_H
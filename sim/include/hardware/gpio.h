@@ -0,0 +1,72 @@
+/**
+ * @file hardware/gpio.h
+ * @brief Sustituto de hardware/gpio.h.
+ *
+ * Cada pin tiene dirección, salida, pull y un nivel externo que fija el
+ * guion (un botón pulsado lleva su pin a 0). Los flancos del nivel de
+ * entrada disparan el callback de IRQ del núcleo que lo registró.
+ */
+
+#ifndef SIM_HARDWARE_GPIO_H
+#define SIM_HARDWARE_GPIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/irq.h"
+
+typedef unsigned int uint;
+
+#define NUM_BANK0_GPIOS 30
+
+#define GPIO_IN  false
+#define GPIO_OUT true
+
+enum gpio_irq_level {
+    GPIO_IRQ_LEVEL_LOW  = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL  = 0x4u,
+    GPIO_IRQ_EDGE_RISE  = 0x8u,
+};
+
+enum gpio_function {
+    GPIO_FUNC_XIP  = 0,
+    GPIO_FUNC_SPI  = 1,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C  = 3,
+    GPIO_FUNC_PWM  = 4,
+    GPIO_FUNC_SIO  = 5,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_GPCK = 8,
+    GPIO_FUNC_USB  = 9,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
+enum gpio_override {
+    GPIO_OVERRIDE_NORMAL = 0,
+    GPIO_OVERRIDE_INVERT = 1,
+    GPIO_OVERRIDE_LOW    = 2,
+    GPIO_OVERRIDE_HIGH   = 3,
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_pull_up(uint gpio);
+void gpio_pull_down(uint gpio);
+void gpio_disable_pulls(uint gpio);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+uint32_t gpio_get_all(void);
+void gpio_set_inover(uint gpio, uint value);
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void gpio_set_dormant_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask);
+uint32_t gpio_get_irq_event_mask(uint gpio);
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled,
+                                        gpio_irq_callback_t callback);
+
+#endif // SIM_HARDWARE_GPIO_H
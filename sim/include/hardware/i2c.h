@@ -0,0 +1,72 @@
+/**
+ * @file hardware/i2c.h
+ * @brief Sustituto de hardware/i2c.h con el MPU6050 y el LCD conectados.
+ *
+ * Además de las funciones bloqueantes, modela lo que usa la lectura por
+ * DMA: los canales con la DREQ TX del I2C interpretan los comandos
+ * escritos en IC_DATA_CMD, la transacción dura lo que tarda en el bus y
+ * al terminar el canal RX recibe los bytes y se levanta la IRQ de STOP.
+ */
+
+#ifndef SIM_HARDWARE_I2C_H
+#define SIM_HARDWARE_I2C_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+typedef struct i2c_inst {
+    uint index;
+} i2c_inst_t;
+
+extern i2c_inst_t sim_i2c_inst[2];
+
+/** Registros del bloque I2C que usa el firmware (el resto no se modela). */
+typedef struct {
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t data_cmd;
+    volatile uint32_t intr_stat;
+    volatile uint32_t intr_mask;
+    volatile uint32_t raw_intr_stat;
+    volatile uint32_t clr_intr;
+    volatile uint32_t clr_tx_abrt;
+    volatile uint32_t clr_stop_det;
+} i2c_hw_t;
+
+extern i2c_hw_t sim_i2c_hw[2];
+
+#define I2C_IC_DATA_CMD_CMD_BITS          0x00000100u
+#define I2C_IC_DATA_CMD_STOP_BITS         0x00000200u
+#define I2C_IC_DATA_CMD_RESTART_BITS      0x00000400u
+#define I2C_IC_INTR_MASK_M_TX_ABRT_BITS   0x00000040u
+#define I2C_IC_INTR_MASK_M_STOP_DET_BITS  0x00000200u
+#define I2C_IC_INTR_STAT_R_TX_ABRT_BITS   0x00000040u
+#define I2C_IC_INTR_STAT_R_STOP_DET_BITS  0x00000200u
+
+/** DREQ del I2C (DREQ_I2C0_TX = 32 en el RP2040). */
+#define SIM_DREQ_I2C0_TX 32u
+
+static inline uint i2c_hw_index(i2c_inst_t *i2c) {
+    return i2c->index;
+}
+
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) {
+    return &sim_i2c_hw[i2c->index];
+}
+
+static inline uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) {
+    return SIM_DREQ_I2C0_TX + i2c->index * 2u + (is_tx ? 0u : 1u);
+}
+
+#define i2c0 (&sim_i2c_inst[0])
+#define i2c1 (&sim_i2c_inst[1])
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate);
+int  i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int  i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+#endif // SIM_HARDWARE_I2C_H
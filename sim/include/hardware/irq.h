@@ -0,0 +1,34 @@
+/**
+ * @file hardware/irq.h
+ * @brief Sustituto de hardware/irq.h (solo las IRQ que usa el firmware).
+ */
+
+#ifndef SIM_HARDWARE_IRQ_H
+#define SIM_HARDWARE_IRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef void (*irq_handler_t)(void);
+
+enum irq_num {
+    TIMER_IRQ_0  = 0,
+    DMA_IRQ_0    = 11,
+    DMA_IRQ_1    = 12,
+    IO_IRQ_BANK0 = 13,
+    I2C0_IRQ     = 23,
+    I2C1_IRQ     = 24,
+    NUM_IRQS     = 32
+};
+
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+#define PICO_DEFAULT_IRQ_PRIORITY                      0x80
+#define PICO_HIGHEST_IRQ_PRIORITY                      0x00
+
+void irq_set_exclusive_handler(uint32_t num, irq_handler_t handler);
+void irq_add_shared_handler(uint32_t num, irq_handler_t handler, uint8_t order_priority);
+void irq_remove_handler(uint32_t num, irq_handler_t handler);
+void irq_set_enabled(uint32_t num, bool enabled);
+void irq_set_priority(uint32_t num, uint8_t hardware_priority);
+
+#endif // SIM_HARDWARE_IRQ_H
@@ -0,0 +1,98 @@
+/**
+ * @file hardware/pio.h
+ * @brief Sustituto de hardware/pio.h.
+ *
+ * No ejecuta instrucciones PIO: de cada programa solo interesan los ciclos
+ * que consume por palabra del FIFO, que junto al divisor fijan el ritmo al
+ * que el DMA vacía el anillo. Las palabras que llegan al FIFO TX de un
+ * state machine con programa se escriben en el WAV de salida.
+ */
+
+#ifndef SIM_HARDWARE_PIO_H
+#define SIM_HARDWARE_PIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+#define NUM_PIO_STATE_MACHINES 4
+
+typedef struct pio_hw {
+    volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t sim_pio_hw[2];
+
+#define pio0 (&sim_pio_hw[0])
+#define pio1 (&sim_pio_hw[1])
+
+/**
+ * @brief Programa PIO; cycles_per_word sustituye a las instrucciones.
+ */
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t         length;
+    int8_t          origin;
+    uint32_t        cycles_per_word;
+} pio_program_t;
+
+typedef struct {
+    float clkdiv;
+} pio_sm_config;
+
+enum pio_fifo_join {
+    PIO_FIFO_JOIN_NONE = 0,
+    PIO_FIFO_JOIN_TX   = 1,
+    PIO_FIFO_JOIN_RX   = 2,
+};
+
+static inline pio_sm_config pio_get_default_sm_config(void) {
+    pio_sm_config c = { 1.0f };
+    return c;
+}
+
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div) {
+    c->clkdiv = div;
+}
+
+static inline void sm_config_set_clkdiv_int_frac8(pio_sm_config *c, uint32_t div_int,
+                                                  uint8_t div_frac8) {
+    c->clkdiv = (float)div_int + (float)div_frac8 / 256.0f;
+}
+
+static inline void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count) {
+    (void)c; (void)out_base; (void)out_count;
+}
+
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) {
+    (void)c; (void)sideset_base;
+}
+
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right,
+                                           bool autopull, uint pull_threshold) {
+    (void)c; (void)shift_right; (void)autopull; (void)pull_threshold;
+}
+
+static inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) {
+    (void)c; (void)join;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+int  pio_claim_unused_sm(PIO pio, bool required);
+uint pio_get_index(PIO pio);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+void pio_gpio_init(PIO pio, uint pin);
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div);
+void pio_sm_set_clkdiv_int_frac8(PIO pio, uint sm, uint32_t div_int, uint8_t div_frac8);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask);
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+
+#endif // SIM_HARDWARE_PIO_H
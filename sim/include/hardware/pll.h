@@ -0,0 +1,25 @@
+/**
+ * @file hardware/pll.h
+ * @brief Sustituto de hardware/pll.h: los PLL no se modelan.
+ */
+
+#ifndef SIM_HARDWARE_PLL_H
+#define SIM_HARDWARE_PLL_H
+
+typedef unsigned int uint;
+
+typedef struct pll_hw {
+    uint index;
+} pll_hw_t;
+
+typedef pll_hw_t *PLL;
+
+extern pll_hw_t sim_pll_hw[2];
+
+#define pll_sys (&sim_pll_hw[0])
+#define pll_usb (&sim_pll_hw[1])
+
+void pll_init(PLL pll, uint ref_div, uint vco_freq, uint post_div1, uint post_div2);
+void pll_deinit(PLL pll);
+
+#endif // SIM_HARDWARE_PLL_H
@@ -0,0 +1,20 @@
+/**
+ * @file hardware/spi.h
+ * @brief Sustituto de hardware/spi.h (la SD se lee a través de sim_disk.c).
+ */
+
+#ifndef SIM_HARDWARE_SPI_H
+#define SIM_HARDWARE_SPI_H
+
+typedef struct spi_inst {
+    unsigned int index;
+} spi_inst_t;
+
+extern spi_inst_t sim_spi_inst[2];
+
+#define spi0 (&sim_spi_inst[0])
+#define spi1 (&sim_spi_inst[1])
+
+unsigned int spi_set_baudrate(spi_inst_t *spi, unsigned int baudrate);
+
+#endif // SIM_HARDWARE_SPI_H
@@ -0,0 +1,31 @@
+/**
+ * @file hardware/structs/systick.h
+ * @brief Sustituto del SysTick de cada núcleo.
+ *
+ * El código del firmware cuesta cero tiempo virtual, así que el contador
+ * avanza con el tiempo de CPU del PC consumido por el núcleo simulado que
+ * lo lee (incluidas sus IRQ), convertido a ciclos del reloj del sistema.
+ * Cuenta hacia abajo en 24 bits y una escritura de cvr lo pone a cero,
+ * como en la placa.
+ */
+
+#ifndef SIM_HARDWARE_STRUCTS_SYSTICK_H
+#define SIM_HARDWARE_STRUCTS_SYSTICK_H
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t csr;
+    volatile uint32_t rvr;
+    volatile uint32_t cvr;
+    volatile uint32_t calib;
+} systick_hw_t;
+
+/**
+ * @brief SysTick del núcleo actual, con cvr al día.
+ */
+systick_hw_t *sim_systick(void);
+
+#define systick_hw (sim_systick())
+
+#endif // SIM_HARDWARE_STRUCTS_SYSTICK_H
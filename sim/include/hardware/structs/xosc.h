@@ -0,0 +1,26 @@
+/**
+ * @file hardware/structs/xosc.h
+ * @brief Sustituto de los registros del XOSC (solo STARTUP se usa).
+ */
+
+#ifndef SIM_HARDWARE_STRUCTS_XOSC_H
+#define SIM_HARDWARE_STRUCTS_XOSC_H
+
+#include <stdint.h>
+
+#define XOSC_STARTUP_DELAY_BITS 0x00003fffu
+
+typedef struct {
+    volatile uint32_t ctrl;
+    volatile uint32_t status;
+    volatile uint32_t dormant;
+    volatile uint32_t startup;
+    uint32_t          _reserved[3];
+    volatile uint32_t count;
+} xosc_hw_t;
+
+extern xosc_hw_t sim_xosc_hw;
+
+#define xosc_hw (&sim_xosc_hw)
+
+#endif // SIM_HARDWARE_STRUCTS_XOSC_H
@@ -0,0 +1,38 @@
+/**
+ * @file hardware/sync.h
+ * @brief Sustituto de hardware/sync.h: eventos, barreras e interrupciones.
+ *
+ * __wfe() y __sev() bloquean y despiertan las corrutinas de los núcleos.
+ * Los núcleos no se intercalan fuera de sus puntos de bloqueo, así que las
+ * barreras solo deben impedir que el compilador reordene accesos.
+ */
+
+#ifndef SIM_HARDWARE_SYNC_H
+#define SIM_HARDWARE_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+static inline void __compiler_memory_barrier(void) {
+    __asm__ volatile ("" ::: "memory");
+}
+
+static inline void __dmb(void) {
+    __compiler_memory_barrier();
+}
+
+void __wfe(void);
+void __wfi(void);
+void __sev(void);
+
+uint32_t save_and_disable_interrupts(void);
+void     restore_interrupts(uint32_t status);
+
+typedef volatile uint32_t spin_lock_t;
+
+int          spin_lock_claim_unused(bool required);
+spin_lock_t *spin_lock_instance(uint32_t lock_num);
+uint32_t     spin_lock_blocking(spin_lock_t *lock);
+void         spin_unlock(spin_lock_t *lock, uint32_t saved_irq);
+
+#endif // SIM_HARDWARE_SYNC_H
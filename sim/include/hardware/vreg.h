@@ -0,0 +1,19 @@
+/**
+ * @file hardware/vreg.h
+ * @brief Sustituto de hardware/vreg.h: la tensión del núcleo no se modela.
+ */
+
+#ifndef SIM_HARDWARE_VREG_H
+#define SIM_HARDWARE_VREG_H
+
+enum vreg_voltage {
+    VREG_VOLTAGE_1_10    = 0b1011,
+    VREG_VOLTAGE_1_15    = 0b1100,
+    VREG_VOLTAGE_DEFAULT = VREG_VOLTAGE_1_10
+};
+
+static inline void vreg_set_voltage(enum vreg_voltage voltage) {
+    (void)voltage;
+}
+
+#endif // SIM_HARDWARE_VREG_H
@@ -0,0 +1,20 @@
+/**
+ * @file hardware/xosc.h
+ * @brief Sustituto de hardware/xosc.h: dormant hasta un pin de despertar.
+ */
+
+#ifndef SIM_HARDWARE_XOSC_H
+#define SIM_HARDWARE_XOSC_H
+
+#include "hardware/structs/xosc.h"
+
+/**
+ * @brief Detiene core0 hasta un flanco en un pin habilitado con
+ *        gpio_set_dormant_irq_enabled() y espera el arranque del XOSC.
+ *
+ * El reloj virtual sigue corriendo (en la placa el temporizador se
+ * detiene), y las IRQ de core0 pueden atenderse mientras tanto.
+ */
+void xosc_dormant(void);
+
+#endif // SIM_HARDWARE_XOSC_H
@@ -0,0 +1,39 @@
+/**
+ * @file i2s_tx.pio.h
+ * @brief Sustituto del encabezado que genera pioasm a partir de i2s_tx.pio.
+ *
+ * El programa emite 16 bits por canal a 3 ciclos por bit, más un ciclo de
+ * cierre por canal: 96 ciclos por palabra (frame estéreo). Si cambia
+ * i2s_tx.pio hay que actualizar I2S_TX_CYCLES_PER_WORD.
+ */
+
+#ifndef SIM_I2S_TX_PIO_H
+#define SIM_I2S_TX_PIO_H
+
+#include "hardware/pio.h"
+
+#define I2S_TX_CYCLES_PER_WORD 96u
+
+static const pio_program_t i2s_tx_program = {
+    .instructions    = 0,
+    .length          = 12,
+    .origin          = -1,
+    .cycles_per_word = I2S_TX_CYCLES_PER_WORD,
+};
+
+static inline pio_sm_config i2s_tx_program_get_default_config(uint offset) {
+    (void)offset;
+    return pio_get_default_sm_config();
+}
+
+static inline void i2s_tx_program_init(PIO pio, uint sm, uint offset,
+                                       uint data_pin, uint bclk_pin) {
+    pio_sm_config c = i2s_tx_program_get_default_config(offset);
+
+    pio_gpio_init(pio, data_pin);
+    pio_gpio_init(pio, bclk_pin);
+    pio_gpio_init(pio, bclk_pin + 1);
+    pio_sm_init(pio, sm, offset, &c);
+}
+
+#endif // SIM_I2S_TX_PIO_H
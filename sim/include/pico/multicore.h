@@ -0,0 +1,25 @@
+/**
+ * @file pico/multicore.h
+ * @brief Sustituto de pico/multicore.h: arranque de core1 y FIFO entre núcleos.
+ *
+ * core1 corre como corrutina de la simulación con una pila propia del PC;
+ * la pila que pasa el firmware no se usa.
+ */
+
+#ifndef SIM_PICO_MULTICORE_H
+#define SIM_PICO_MULTICORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+void multicore_launch_core1(void (*entry)(void));
+void multicore_launch_core1_with_stack(void (*entry)(void), uint32_t *stack_bottom,
+                                       size_t stack_size_bytes);
+
+bool     multicore_fifo_rvalid(void);
+bool     multicore_fifo_wready(void);
+void     multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking(void);
+
+#endif // SIM_PICO_MULTICORE_H
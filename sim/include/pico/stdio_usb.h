@@ -0,0 +1,15 @@
+/**
+ * @file pico/stdio_usb.h
+ * @brief Sustituto de pico/stdio_usb.h: la simulación corre sin USB.
+ */
+
+#ifndef SIM_PICO_STDIO_USB_H
+#define SIM_PICO_STDIO_USB_H
+
+#include <stdbool.h>
+
+static inline bool stdio_usb_connected(void) {
+    return false;
+}
+
+#endif // SIM_PICO_STDIO_USB_H
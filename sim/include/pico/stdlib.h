@@ -0,0 +1,38 @@
+/**
+ * @file pico/stdlib.h
+ * @brief Sustituto de pico/stdlib.h para la simulación en PC.
+ *
+ * Solo declara lo que usa el firmware; las funciones están en sim_hw.c y
+ * el tiempo es el reloj virtual de la simulación.
+ */
+
+#ifndef SIM_PICO_STDLIB_H
+#define SIM_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#define __not_in_flash_func(func_name)   func_name
+#define __time_critical_func(func_name)  func_name
+#define __scratch_x(group)
+#define __scratch_y(group)
+
+#define PICO_OK              0
+#define PICO_ERROR_GENERIC   (-2)
+#define PICO_ERROR_TIMEOUT   (-1)
+
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+
+bool stdio_init_all(void);
+int  getchar_timeout_us(uint32_t timeout_us);
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param);
+
+static inline void tight_loop_contents(void) {}
+
+#endif // SIM_PICO_STDLIB_H
@@ -0,0 +1,76 @@
+/**
+ * @file pico/time.h
+ * @brief Sustituto de pico/time.h: tiempo absoluto, esperas, temporizadores y alarmas.
+ */
+
+#ifndef SIM_PICO_TIME_H
+#define SIM_PICO_TIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/timer.h"
+
+typedef uint64_t absolute_time_t;
+
+absolute_time_t get_absolute_time(void);
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000u);
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+typedef int32_t alarm_id_t;
+
+struct repeating_timer;
+typedef bool (*repeating_timer_callback_t)(struct repeating_timer *rt);
+
+/**
+ * @brief Temporizador repetitivo; lo atiende la IRQ de temporizador del
+ *        núcleo que lo creó.
+ */
+typedef struct repeating_timer {
+    int64_t                    delay_us;
+    alarm_id_t                 alarm_id;
+    repeating_timer_callback_t callback;
+    void                      *user_data;
+} repeating_timer_t;
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback,
+                            void *user_data, repeating_timer_t *out);
+bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback,
+                            void *user_data, repeating_timer_t *out);
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+/**
+ * @brief Alarma de un disparo; la atiende la IRQ de temporizador del núcleo
+ *        que la creó. Si el callback devuelve <0 se reprograma a -ret us
+ *        de ahora, si >0 a ret us de su vencimiento.
+ */
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data,
+                           bool fire_if_past);
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data,
+                           bool fire_if_past);
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us) {
+    return get_absolute_time() + us;
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return get_absolute_time() + (uint64_t)ms * 1000u;
+}
+
+/**
+ * @brief __wfe() con plazo: vuelve con un evento o al vencer @p timeout.
+ * @return true si venció el plazo.
+ */
+bool best_effort_wfe_or_timeout(absolute_time_t timeout);
+
+#endif // SIM_PICO_TIME_H
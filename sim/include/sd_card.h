@@ -0,0 +1,35 @@
+/**
+ * @file sd_card.h
+ * @brief Sustituto de sd_card.h de no-OS-FatFS para compilar hw_config.c.
+ *
+ * La configuración SPI no se usa: FatFs lee la imagen a través de
+ * sim_disk.c.
+ */
+
+#ifndef SIM_SD_CARD_H
+#define SIM_SD_CARD_H
+
+#include <stdbool.h>
+#include "ff.h"
+#include "hardware/spi.h"
+
+typedef struct {
+    spi_inst_t  *hw_inst;
+    unsigned int miso_gpio;
+    unsigned int mosi_gpio;
+    unsigned int sck_gpio;
+    unsigned int baud_rate;
+    bool         set_drive_strength;
+} spi_t;
+
+typedef struct {
+    const char  *pcName;
+    spi_t       *spi;
+    unsigned int ss_gpio;
+    bool         use_card_detect;
+    int          card_detect_gpio;
+    int          card_detected_true;
+    FATFS        fatfs;
+} sd_card_t;
+
+#endif // SIM_SD_CARD_H
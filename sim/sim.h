@@ -0,0 +1,210 @@
+/**
+ * @file sim.h
+ * @brief Simulación del firmware en PC: reloj virtual, núcleos y hardware.
+ *
+ * Los módulos del firmware se compilan sin cambios contra los sustitutos
+ * del Pico SDK de sim/include. Este encabezado es la interfaz interna entre
+ * las piezas de la simulación:
+ *  - sim_core.c:   reloj virtual, los dos núcleos como corrutinas y la cola
+ *                  de eventos de hardware (planificador determinista).
+ *  - sim_hw.c:     GPIO, DMA, PIO, IRQ, I2C (MPU6050 y LCD), relojes,
+ *                  temporizadores, consola y la salida de audio a WAV.
+ *  - sim_disk.c:   disco de FatFs sobre un archivo de imagen FAT, con un
+ *                  modelo de latencia de la SD.
+ *  - sim_script.c: guion de la interpretación (botones, IMU y consola).
+ *
+ * El tiempo virtual solo avanza cuando ambos núcleos están bloqueados
+ * (sleep_us(), __wfe(), colas entre núcleos, lecturas de la SD); el código
+ * entre esos puntos cuesta cero. Las IRQ se ejecutan en el instante exacto
+ * de su evento, entre dos puntos de bloqueo del núcleo dueño, así que una
+ * interpretación se renderiza tan rápido como lo permita el PC y el
+ * resultado es idéntico en cada corrida.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Picosegundos por microsegundo (el reloj virtual cuenta picosegundos). */
+#define SIM_PS_PER_US 1000000ull
+
+/**
+ * @brief Función de un evento de hardware.
+ *
+ * @param arg Argumento dado al programar el evento.
+ * @param tag Etiqueta dada al programar el evento; permite descartar
+ *            eventos obsoletos (canal DMA reprogramado, timer cancelado).
+ */
+typedef void (*sim_event_fn_t)(void *arg, uint32_t tag);
+
+// Reloj y núcleos (sim_core.c)
+
+/**
+ * @brief Instante virtual actual en picosegundos.
+ */
+uint64_t sim_now_ps(void);
+
+/**
+ * @brief Instante virtual actual en microsegundos.
+ */
+uint64_t sim_now_us(void);
+
+/**
+ * @brief Núcleo en ejecución (0 o 1), o el dueño de la IRQ en curso.
+ */
+int sim_core_num(void);
+
+/**
+ * @brief Tiempo de CPU del PC (ns) consumido por el núcleo @p core,
+ *        incluidas las IRQ que le pertenecen.
+ */
+uint64_t sim_core_cpu_ns(int core);
+
+/**
+ * @brief Bloquea el núcleo actual hasta el instante @p t_ps.
+ */
+void sim_sleep_until(uint64_t t_ps);
+
+/**
+ * @brief Bloquea el núcleo actual @p us microsegundos.
+ */
+void sim_sleep_us(uint64_t us);
+
+/**
+ * @brief __wfe(): espera un evento (__sev() o una IRQ del núcleo).
+ */
+void sim_wait_event(void);
+
+/**
+ * @brief __sev(): señala un evento a ambos núcleos.
+ */
+void sim_send_event(void);
+
+/**
+ * @brief Cede el núcleo sin avanzar el tiempo (bucles de espera).
+ *
+ * Muchas cesiones seguidas sin bloquearse cuentan como espera activa y
+ * avanzan el reloj del núcleo, para que un bucle que consulta el tiempo
+ * no congele la simulación.
+ */
+void sim_yield(void);
+
+/**
+ * @brief Registra una consulta del tiempo (detección de espera activa).
+ */
+void sim_spin(void);
+
+/**
+ * @brief Cambia el estado de las interrupciones del núcleo actual.
+ * @return Estado anterior (true = deshabilitadas).
+ */
+bool sim_irq_disable(bool disable);
+
+/**
+ * @brief Arranca core1 con @p entry.
+ */
+void sim_launch_core1(void (*entry)(void));
+
+/**
+ * @brief Programa un evento de hardware.
+ *
+ * @param t_ps Instante del evento.
+ * @param core Núcleo dueño (su IRQ lo despierta de __wfe()), o -1.
+ */
+void sim_event_at(uint64_t t_ps, int core, sim_event_fn_t fn, void *arg, uint32_t tag);
+
+/**
+ * @brief Ejecuta el firmware desde @p core0_entry hasta sim_stop() o su retorno.
+ * @return Código de retorno del firmware, o 0 si se detuvo la simulación.
+ */
+int sim_run(int (*core0_entry)(void));
+
+/**
+ * @brief Detiene la simulación en el instante @p t_ps.
+ */
+void sim_stop_at(uint64_t t_ps);
+
+// Hardware (sim_hw.c)
+
+/**
+ * @brief Abre el WAV de salida; NULL descarta el audio.
+ */
+bool sim_audio_open(const char *path);
+
+/**
+ * @brief Empieza a grabar el audio en el WAV (instante del guion 0).
+ */
+void sim_audio_start(void);
+
+/**
+ * @brief Cierra el WAV de salida.
+ * @return Frames escritos.
+ */
+uint64_t sim_audio_close(void);
+
+/**
+ * @brief Fuerza el nivel externo de un GPIO (0/1) o lo suelta (-1).
+ */
+void sim_gpio_drive(unsigned gpio, int level);
+
+/**
+ * @brief Fija la lectura del MPU6050 (g y grados por segundo).
+ */
+void sim_imu_set(float ax, float ay, float az, float gx, float gy, float gz);
+
+/**
+ * @brief Encola texto para getchar_timeout_us().
+ */
+void sim_console_push(const char *text);
+
+// Disco (sim_disk.c)
+
+/**
+ * @brief Abre la imagen FAT que verá FatFs.
+ *
+ * @param cmd_us Costo fijo de cada lectura de la SD.
+ * @param sector_us Costo por sector de 512 bytes.
+ */
+bool sim_disk_open(const char *path, uint32_t cmd_us, uint32_t sector_us);
+
+/**
+ * @brief Lecturas y sectores leídos desde la apertura.
+ */
+void sim_disk_stats(uint64_t *reads, uint64_t *sectors);
+
+// Guion (sim_script.c)
+
+/**
+ * @brief Carga el guion de la interpretación (NULL = sin guion).
+ *
+ * @param tail_ms Audio a renderizar tras el último evento.
+ */
+bool sim_script_load(const char *path, uint32_t tail_ms);
+
+/**
+ * @brief Programa el guion a partir del instante actual.
+ *
+ * La llama sim_hw.c cuando el firmware consulta la consola por primera
+ * vez, es decir, al entrar a su bucle principal.
+ */
+void sim_script_start(void);
+
+/**
+ * @brief Indica si el guion ya empezó.
+ */
+bool sim_script_started(void);
+
+/**
+ * @brief Punto de entrada del firmware (main() de test_audio_SD_DMA.c).
+ */
+int firmware_main(void);
+
+#endif // SIM_H
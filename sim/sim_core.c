@@ -0,0 +1,389 @@
+/**
+ * @file sim_core.c
+ * @brief Planificador de la simulación: reloj virtual, núcleos y eventos.
+ *
+ * Cada núcleo del RP2040 es una corrutina (ucontext) con su propia pila.
+ * Un núcleo corre hasta que se bloquea (dormir, __wfe(), esperar la cola
+ * entre núcleos o una lectura de la SD); entonces el planificador elige el
+ * otro núcleo o, si ninguno puede correr, avanza el reloj virtual hasta el
+ * siguiente despertar o evento de hardware. Los eventos (fin de bloque DMA,
+ * flanco de un GPIO, temporizadores, guion) se ejecutan en el contexto del
+ * planificador, como una IRQ que interrumpe al núcleo dueño en su punto de
+ * bloqueo, y lo despiertan de __wfe().
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#define _GNU_SOURCE
+#include "sim.h"
+#include <ucontext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/** Pila de cada núcleo (el código del PC usa mucha más que el firmware). */
+#define SIM_CORE_STACK  (1024u * 1024u)
+
+/** Cesiones o consultas del tiempo seguidas que cuentan como espera activa. */
+#define SIM_SPIN_LIMIT  32
+
+/** Tiempo que avanza el núcleo por cada espera activa detectada. */
+#define SIM_SPIN_US     10
+
+/** Eventos de hardware pendientes como máximo. */
+#define SIM_MAX_EVENTS  8192
+
+typedef enum {
+    CORE_OFF = 0,
+    CORE_READY,
+    CORE_SLEEP,
+    CORE_WFE
+} core_state_t;
+
+typedef struct {
+    ucontext_t   ctx;
+    core_state_t state;
+    uint64_t     wake_ps;
+    bool         event;      // registro de eventos de __wfe()/__sev()
+    bool         irq_off;
+    uint32_t     spins;
+    uint64_t     cpu_ns;     // tiempo de CPU del PC ya consumido
+    void        *stack;
+} sim_core_t;
+
+typedef struct {
+    uint64_t       t_ps;
+    uint64_t       seq;      // desempate: orden de programación
+    int            core;
+    sim_event_fn_t fn;
+    void          *arg;
+    uint32_t       tag;
+} sim_event_t;
+
+static sim_core_t cores[2];
+static ucontext_t sched_ctx;
+static int        current   = -1;   // núcleo en ejecución
+static int        irq_owner = -1;   // dueño del evento en curso
+
+static uint64_t now_ps    = 0;
+static uint64_t stop_ps   = UINT64_MAX;
+static bool     finished  = false;
+static int      exit_code = 0;
+
+static sim_event_t events[SIM_MAX_EVENTS];   // montículo por (t_ps, seq)
+static uint32_t    event_count = 0;
+static uint64_t    event_seq   = 0;
+
+static int      slice_core  = -1;   // núcleo al que se carga el tramo en curso
+static uint64_t slice_start = 0;
+
+static int  (*core0_fn)(void) = NULL;
+static void (*core1_fn)(void) = NULL;
+
+/**
+ * @brief Termina la simulación con un error de uso del firmware.
+ */
+static void sim_fatal(const char *msg) {
+    fprintf(stderr, "sim: %s (t = %llu us)\n", msg, (unsigned long long)(now_ps / SIM_PS_PER_US));
+    exit(2);
+}
+
+/**
+ * @brief Compara dos eventos por instante y orden de programación.
+ */
+static bool event_before(const sim_event_t *a, const sim_event_t *b) {
+    return (a->t_ps != b->t_ps) ? (a->t_ps < b->t_ps) : (a->seq < b->seq);
+}
+
+/**
+ * @brief Saca el evento más próximo del montículo.
+ */
+static sim_event_t event_pop(void) {
+    sim_event_t top = events[0];
+    sim_event_t last = events[--event_count];
+    uint32_t    i = 0;
+
+    for (;;) {
+        uint32_t c = 2 * i + 1;
+        if (c >= event_count) break;
+        if (c + 1 < event_count && event_before(&events[c + 1], &events[c])) c++;
+        if (!event_before(&events[c], &last)) break;
+        events[i] = events[c];
+        i = c;
+    }
+    if (event_count > 0) events[i] = last;
+    return top;
+}
+
+/**
+ * @brief Reloj monótono del PC en nanosegundos.
+ *
+ * Se usa en lugar del tiempo de CPU del hilo, que en Linux cuesta una
+ * llamada al sistema en cada cambio de núcleo.
+ */
+static uint64_t host_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Empieza a cargar el tiempo de CPU al núcleo @p k (-1: a nadie).
+ */
+static void slice_begin(int k) {
+    slice_core  = k;
+    slice_start = host_cpu_ns();
+}
+
+/**
+ * @brief Carga el tramo en curso a su núcleo.
+ */
+static void slice_end(void) {
+    if (slice_core >= 0) {
+        cores[slice_core].cpu_ns += host_cpu_ns() - slice_start;
+    }
+    slice_core = -1;
+}
+
+/**
+ * @brief Cede el núcleo actual al planificador con el estado ya fijado.
+ */
+static void core_block(void) {
+    int k = current;
+
+    if (k < 0) {
+        sim_fatal("una IRQ intentó bloquearse");
+    }
+    if (cores[k].irq_off) {
+        sim_fatal("un núcleo se bloqueó con las interrupciones deshabilitadas");
+    }
+    swapcontext(&cores[k].ctx, &sched_ctx);
+}
+
+/**
+ * @brief Indica si el núcleo k puede continuar en el instante actual.
+ */
+static bool core_runnable(int k) {
+    switch (cores[k].state) {
+        case CORE_READY: return true;
+        case CORE_SLEEP: return cores[k].wake_ps <= now_ps;
+        case CORE_WFE:   return cores[k].event;
+        default:         return false;
+    }
+}
+
+/**
+ * @brief Entrada de core0: el main() del firmware.
+ */
+static void core0_entry(void) {
+    exit_code = core0_fn();
+    cores[0].state = CORE_OFF;
+    finished = true;
+}
+
+/**
+ * @brief Entrada de core1.
+ */
+static void core1_entry(void) {
+    core1_fn();
+    cores[1].state = CORE_OFF;
+}
+
+/**
+ * @brief Prepara la corrutina de un núcleo.
+ */
+static void core_create(int k, void (*entry)(void)) {
+    sim_core_t *c = &cores[k];
+
+    if (!c->stack) {
+        c->stack = malloc(SIM_CORE_STACK);
+        if (!c->stack) sim_fatal("sin memoria para la pila de un núcleo");
+    }
+    getcontext(&c->ctx);
+    c->ctx.uc_stack.ss_sp   = c->stack;
+    c->ctx.uc_stack.ss_size = SIM_CORE_STACK;
+    c->ctx.uc_link          = &sched_ctx;
+    makecontext(&c->ctx, entry, 0);
+
+    c->state   = CORE_READY;
+    c->event   = false;
+    c->irq_off = false;
+    c->spins   = 0;
+    c->cpu_ns  = 0;
+}
+
+
+// API
+
+uint64_t sim_now_ps(void) {
+    return now_ps;
+}
+
+uint64_t sim_now_us(void) {
+    return now_ps / SIM_PS_PER_US;
+}
+
+uint64_t sim_core_cpu_ns(int core) {
+    uint64_t ns = cores[core].cpu_ns;
+    if (core == slice_core) {
+        ns += host_cpu_ns() - slice_start;
+    }
+    return ns;
+}
+
+int sim_core_num(void) {
+    if (irq_owner >= 0) return irq_owner;
+    return (current >= 0) ? current : 0;
+}
+
+void sim_sleep_until(uint64_t t_ps) {
+    if (current < 0) sim_fatal("una IRQ intentó dormir");
+
+    if (t_ps <= now_ps) {
+        sim_yield();
+        return;
+    }
+    cores[current].state   = CORE_SLEEP;
+    cores[current].wake_ps = t_ps;
+    cores[current].spins   = 0;
+    core_block();
+}
+
+void sim_sleep_us(uint64_t us) {
+    sim_sleep_until(now_ps + us * SIM_PS_PER_US);
+}
+
+void sim_wait_event(void) {
+    if (current < 0) return;
+
+    sim_core_t *c = &cores[current];
+    if (c->event) {
+        c->event = false;
+        sim_yield();
+        return;
+    }
+    c->state = CORE_WFE;
+    c->spins = 0;
+    core_block();
+    c->event = false;
+}
+
+void sim_send_event(void) {
+    cores[0].event = true;
+    cores[1].event = true;
+}
+
+void sim_yield(void) {
+    if (current < 0) return;
+
+    if (++cores[current].spins >= SIM_SPIN_LIMIT) {
+        sim_sleep_us(SIM_SPIN_US);
+        return;
+    }
+    cores[current].state = CORE_READY;
+    core_block();
+}
+
+void sim_spin(void) {
+    if (current < 0 || irq_owner >= 0 || cores[current].irq_off) return;
+
+    if (++cores[current].spins >= SIM_SPIN_LIMIT) {
+        sim_sleep_us(SIM_SPIN_US);
+    }
+}
+
+bool sim_irq_disable(bool disable) {
+    if (irq_owner >= 0 || current < 0) return true;
+
+    bool prev = cores[current].irq_off;
+    cores[current].irq_off = disable;
+    return prev;
+}
+
+void sim_launch_core1(void (*entry)(void)) {
+    core1_fn = entry;
+    core_create(1, core1_entry);
+}
+
+void sim_event_at(uint64_t t_ps, int core, sim_event_fn_t fn, void *arg, uint32_t tag) {
+    if (event_count >= SIM_MAX_EVENTS) {
+        sim_fatal("demasiados eventos de hardware pendientes");
+    }
+
+    sim_event_t ev = { t_ps < now_ps ? now_ps : t_ps, event_seq++, core, fn, arg, tag };
+    uint32_t    i  = event_count++;
+
+    while (i > 0) {
+        uint32_t p = (i - 1) / 2;
+        if (!event_before(&ev, &events[p])) break;
+        events[i] = events[p];
+        i = p;
+    }
+    events[i] = ev;
+}
+
+void sim_stop_at(uint64_t t_ps) {
+    stop_ps = t_ps;
+}
+
+int sim_run(int (*entry)(void)) {
+    int last = 1;
+
+    core0_fn = entry;
+    core_create(0, core0_entry);
+
+    while (!finished && now_ps < stop_ps) {
+        // IRQs y entradas vencidas
+        while (event_count > 0 && events[0].t_ps <= now_ps) {
+            sim_event_t ev = event_pop();
+            irq_owner = ev.core;
+            slice_begin(ev.core);
+            ev.fn(ev.arg, ev.tag);
+            slice_end();
+            irq_owner = -1;
+            if (ev.core >= 0) cores[ev.core].event = true;
+        }
+
+        // Núcleo listo, alternando para no dejar al otro sin turno
+        int pick = -1;
+        for (int i = 1; i <= 2; i++) {
+            int k = (last + i) % 2;
+            if (core_runnable(k)) {
+                pick = k;
+                break;
+            }
+        }
+
+        if (pick >= 0) {
+            last    = pick;
+            current = pick;
+            cores[pick].state = CORE_READY;
+            slice_begin(pick);
+            swapcontext(&sched_ctx, &cores[pick].ctx);
+            slice_end();
+            current = -1;
+            continue;
+        }
+
+        // Ninguno puede correr: avanzar al próximo despertar o evento
+        uint64_t next = stop_ps;
+        for (int k = 0; k < 2; k++) {
+            if (cores[k].state == CORE_SLEEP && cores[k].wake_ps < next) {
+                next = cores[k].wake_ps;
+            }
+        }
+        if (event_count > 0 && events[0].t_ps < next) {
+            next = events[0].t_ps;
+        }
+        if (next == UINT64_MAX) {
+            fprintf(stderr, "sim: ambos núcleos esperan y no hay eventos pendientes\n");
+            break;
+        }
+        now_ps = next;
+    }
+    return exit_code;
+}
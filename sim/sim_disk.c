@@ -0,0 +1,107 @@
+/**
+ * @file sim_disk.c
+ * @brief Disco de FatFs sobre una imagen FAT, con latencia de la SD.
+ *
+ * Sustituye a la capa de no-OS-FatFS que habla con la tarjeta por SPI:
+ * FatFs lee los sectores de un archivo de imagen (por ejemplo, creado con
+ * mkfs.fat y mcopy). Cada lectura bloquea al núcleo que la pide durante
+ * cmd_us + sectores * sector_us de tiempo virtual, mientras las IRQ del
+ * otro núcleo y del DMA siguen corriendo, igual que en la placa.
+ *
+ * La imagen se abre solo para lectura: el firmware no escribe en la SD.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "sim.h"
+#include "ff.h"
+#include "diskio.h"
+#include <stdio.h>
+
+#define SIM_SECTOR 512u
+
+static FILE    *image         = NULL;
+static uint64_t image_sectors = 0;
+static uint32_t read_cmd_us   = 0;
+static uint32_t read_sector_us = 0;
+static uint64_t reads_done    = 0;
+static uint64_t sectors_read  = 0;
+
+bool sim_disk_open(const char *path, uint32_t cmd_us, uint32_t sector_us) {
+    image = fopen(path, "rb");
+    if (!image) return false;
+
+    fseek(image, 0, SEEK_END);
+    image_sectors  = (uint64_t)ftell(image) / SIM_SECTOR;
+    read_cmd_us    = cmd_us;
+    read_sector_us = sector_us;
+    return image_sectors > 0;
+}
+
+void sim_disk_stats(uint64_t *reads, uint64_t *sectors) {
+    *reads   = reads_done;
+    *sectors = sectors_read;
+}
+
+DSTATUS disk_initialize(BYTE pdrv) {
+    return disk_status(pdrv);
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+    if (pdrv != 0 || !image) return STA_NOINIT | STA_NODISK;
+    return STA_PROTECT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count) {
+    if (pdrv != 0 || !image) return RES_NOTRDY;
+    if ((uint64_t)sector + count > image_sectors) return RES_PARERR;
+
+    if (fseek(image, (long)((uint64_t)sector * SIM_SECTOR), SEEK_SET) != 0 ||
+        fread(buff, SIM_SECTOR, count, image) != count) {
+        return RES_ERROR;
+    }
+
+    reads_done++;
+    sectors_read += count;
+    sim_sleep_us((uint64_t)read_cmd_us + (uint64_t)count * read_sector_us);
+    return RES_OK;
+}
+
+#if FF_FS_READONLY == 0
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count) {
+    (void)pdrv;
+    (void)buff;
+    (void)sector;
+    (void)count;
+    return RES_WRPRT;
+}
+#endif
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff) {
+    if (pdrv != 0 || !image) return RES_NOTRDY;
+
+    switch (cmd) {
+        case CTRL_SYNC:
+            return RES_OK;
+        case GET_SECTOR_COUNT:
+            *(LBA_t *)buff = (LBA_t)image_sectors;
+            return RES_OK;
+        case GET_SECTOR_SIZE:
+            *(WORD *)buff = SIM_SECTOR;
+            return RES_OK;
+        case GET_BLOCK_SIZE:
+            *(DWORD *)buff = 1;
+            return RES_OK;
+        default:
+            return RES_PARERR;
+    }
+}
+
+DWORD get_fattime(void) {
+    // Fecha fija (2025-01-01 00:00) para que la simulación sea reproducible
+    return ((DWORD)(2025 - 1980) << 25) | ((DWORD)1 << 21) | ((DWORD)1 << 16);
+}
@@ -0,0 +1,1417 @@
+/**
+ * @file sim_hw.c
+ * @brief Periféricos del RP2040 en la simulación.
+ *
+ * Implementa las funciones de los sustitutos del Pico SDK (sim/include):
+ *  - Tiempo, esperas, eventos entre núcleos, interrupciones y spinlocks.
+ *  - GPIO con niveles externos, override de entrada e IRQ por flanco.
+ *  - DMA con encadenamiento y su IRQ, al ritmo del state machine del PIO
+ *    al que alimenta; las palabras que llegan al FIFO TX van al WAV.
+ *  - I2C con un MPU6050 (registros que fija el guion) y el LCD 16x2 del
+ *    PCF8574, cuyo contenido se imprime al cambiar. Con la FIFO o el
+ *    dato listo habilitados, el MPU6050 muestrea a su ODR, llena la FIFO
+ *    y da un pulso en su pin INT; las lecturas por DMA duran lo que
+ *    tardan en el bus.
+ *  - Temporizadores repetitivos, relojes, SysTick y consola USB.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "sim.h"
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+#include "hardware/structs/systick.h"
+#include "hardware/pll.h"
+#include "hardware/xosc.h"
+#include "mpu6050.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/** Dirección I2C del MPU6050. */
+#define SIM_MPU6050_ADDR  0x68
+
+/** Dirección I2C del PCF8574 del LCD. */
+#define SIM_LCD_ADDR      0x27
+
+/** Profundidad de la FIFO entre núcleos. */
+#define SIM_FIFO_DEPTH    8
+
+/** Bytes que admite la consola simulada. */
+#define SIM_CONSOLE_SIZE  1024
+
+pio_hw_t     sim_pio_hw[2];
+i2c_inst_t   sim_i2c_inst[2] = { { 0 }, { 1 } };
+spi_inst_t   sim_spi_inst[2] = { { 0 }, { 1 } };
+pll_hw_t     sim_pll_hw[2]   = { { 0 }, { 1 } };
+xosc_hw_t    sim_xosc_hw     = { .startup = ((XOSC_HZ / KHZ) + 128u) / 256u };
+
+static uint32_t sys_hz = 125000000u;
+
+// Tiempo
+
+uint32_t time_us_32(void) {
+    sim_spin();
+    return (uint32_t)sim_now_us();
+}
+
+uint64_t time_us_64(void) {
+    sim_spin();
+    return sim_now_us();
+}
+
+absolute_time_t get_absolute_time(void) {
+    sim_spin();
+    return sim_now_us();
+}
+
+void sleep_us(uint64_t us) {
+    sim_sleep_us(us);
+}
+
+void sleep_ms(uint32_t ms) {
+    sim_sleep_us((uint64_t)ms * 1000u);
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    switch (clk_index) {
+        case clk_sys:
+        case clk_peri: return sys_hz;
+        case clk_usb:
+        case clk_adc:  return 48000000u;
+        default:       return 12000000u;
+    }
+}
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required) {
+    (void)required;
+    sys_hz = freq_khz * 1000u;
+    return true;
+}
+
+void set_sys_clock_pll(uint32_t vco_freq, uint post_div1, uint post_div2) {
+    sys_hz = vco_freq / (post_div1 * post_div2);
+}
+
+/**
+ * @brief Misma búsqueda que el SDK: el mayor VCO que da @p freq_khz exacto.
+ */
+bool check_sys_clock_khz(uint32_t freq_khz, uint *vco_freq_out,
+                         uint *post_div1_out, uint *post_div2_out) {
+    for (uint fbdiv = 320; fbdiv >= 16; fbdiv--) {
+        uint vco_khz = fbdiv * (XOSC_HZ / KHZ);
+        if (vco_khz < 750000u || vco_khz > 1600000u) continue;
+        for (uint pd1 = 7; pd1 >= 1; pd1--) {
+            for (uint pd2 = pd1; pd2 >= 1; pd2--) {
+                if (vco_khz % (pd1 * pd2) == 0 && vco_khz / (pd1 * pd2) == freq_khz) {
+                    *vco_freq_out  = vco_khz * KHZ;
+                    *post_div1_out = pd1;
+                    *post_div2_out = pd2;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool clock_configure(enum clock_index clk_index, uint32_t src, uint32_t auxsrc,
+                     uint32_t src_freq, uint32_t freq) {
+    (void)src;
+    (void)auxsrc;
+    (void)src_freq;
+    if (clk_index == clk_sys) sys_hz = freq;
+    return true;
+}
+
+void clock_stop(enum clock_index clk_index) {
+    (void)clk_index;
+}
+
+void pll_init(PLL pll, uint ref_div, uint vco_freq, uint post_div1, uint post_div2) {
+    (void)pll;
+    (void)ref_div;
+    (void)vco_freq;
+    (void)post_div1;
+    (void)post_div2;
+}
+
+void pll_deinit(PLL pll) {
+    (void)pll;
+}
+
+/**
+ * @brief Velocidad que da un divisor entero de clk_peri (SPI e I2C), sin
+ *        superar la pedida ni clk_peri / 2.
+ */
+static uint peri_baudrate(uint baudrate) {
+    uint32_t div = (sys_hz + baudrate - 1u) / baudrate;
+    if (div < 2u) div = 2u;
+    return sys_hz / div;
+}
+
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate) {
+    (void)spi;
+    return peri_baudrate(baudrate);
+}
+
+// Velocidad pedida de cada I2C: fija la duración de las transacciones por DMA
+static uint32_t i2c_baud[2] = { 100000u, 100000u };
+
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate) {
+    i2c_baud[i2c->index] = baudrate;
+    return peri_baudrate(baudrate);
+}
+
+// SysTick
+
+static systick_hw_t sim_systick_hw[2];
+static uint32_t     systick_last[2];     // último cvr publicado
+static uint64_t     systick_base[2];     // ciclos en la última puesta a cero
+
+systick_hw_t *sim_systick(void) {
+    int           k  = sim_core_num();
+    systick_hw_t *st = &sim_systick_hw[k];
+    uint64_t      cycles = sim_core_cpu_ns(k) * (sys_hz / 1000u) / 1000000u;
+
+    // Una escritura de cvr (cualquier valor) reinicia la cuenta
+    if (st->cvr != systick_last[k]) {
+        systick_base[k] = cycles;
+    }
+    uint32_t reload = (st->rvr & 0x00FFFFFFu) + 1u;
+    uint32_t value  = (st->csr & 1u)
+                      ? (uint32_t)((reload - (cycles - systick_base[k]) % reload) % reload)
+                      : systick_last[k];
+    st->cvr         = value;
+    systick_last[k] = value;
+    return st;
+}
+
+// Sincronización
+
+void __wfe(void) {
+    sim_wait_event();
+}
+
+void __wfi(void) {
+    sim_wait_event();
+}
+
+void __sev(void) {
+    sim_send_event();
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    return sim_irq_disable(true) ? 1u : 0u;
+}
+
+void restore_interrupts(uint32_t status) {
+    sim_irq_disable(status != 0);
+}
+
+static spin_lock_t spin_locks[32];
+static uint32_t    spin_lock_next = 16;   // los primeros 16 quedan para el SDK
+
+int spin_lock_claim_unused(bool required) {
+    if (spin_lock_next >= 32) {
+        if (required) fprintf(stderr, "sim: sin spinlocks libres\n");
+        return -1;
+    }
+    return (int)spin_lock_next++;
+}
+
+spin_lock_t *spin_lock_instance(uint32_t lock_num) {
+    return &spin_locks[lock_num & 31u];
+}
+
+uint32_t spin_lock_blocking(spin_lock_t *lock) {
+    uint32_t save = save_and_disable_interrupts();
+    *lock = 1;
+    return save;
+}
+
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq) {
+    *lock = 0;
+    restore_interrupts(saved_irq);
+}
+
+// Multinúcleo
+
+static uint32_t fifo_data[2][SIM_FIFO_DEPTH];   // [núcleo destino]
+static uint32_t fifo_count[2];
+
+void multicore_launch_core1(void (*entry)(void)) {
+    sim_launch_core1(entry);
+}
+
+void multicore_launch_core1_with_stack(void (*entry)(void), uint32_t *stack_bottom,
+                                       size_t stack_size_bytes) {
+    (void)stack_bottom;
+    (void)stack_size_bytes;
+    sim_launch_core1(entry);
+}
+
+bool multicore_fifo_rvalid(void) {
+    return fifo_count[sim_core_num()] > 0;
+}
+
+bool multicore_fifo_wready(void) {
+    return fifo_count[sim_core_num() ^ 1] < SIM_FIFO_DEPTH;
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+    int dst = sim_core_num() ^ 1;
+    while (fifo_count[dst] >= SIM_FIFO_DEPTH) {
+        sim_wait_event();
+    }
+    fifo_data[dst][fifo_count[dst]++] = data;
+    sim_send_event();
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+    int me = sim_core_num();
+    while (fifo_count[me] == 0) {
+        sim_wait_event();
+    }
+    uint32_t data = fifo_data[me][0];
+    fifo_count[me]--;
+    memmove(&fifo_data[me][0], &fifo_data[me][1], fifo_count[me] * sizeof(uint32_t));
+    sim_send_event();
+    return data;
+}
+
+// IRQ
+
+typedef struct {
+    irq_handler_t handlers[4];
+    int           count;
+    bool          enabled;
+    bool          pending;
+    int           core;
+} sim_irq_t;
+
+static sim_irq_t irqs[NUM_IRQS];
+
+/**
+ * @brief Atiende una IRQ pendiente en su núcleo.
+ */
+static void irq_fire(void *arg, uint32_t num) {
+    (void)arg;
+    sim_irq_t *q = &irqs[num];
+
+    q->pending = false;
+    if (!q->enabled) return;
+    for (int i = 0; i < q->count; i++) {
+        q->handlers[i]();
+    }
+}
+
+/**
+ * @brief Marca una IRQ como pendiente; se atiende en el mismo instante.
+ */
+static void irq_raise(uint32_t num) {
+    sim_irq_t *q = &irqs[num];
+
+    if (!q->enabled || q->pending) return;
+    q->pending = true;
+    sim_event_at(sim_now_ps(), q->core, irq_fire, NULL, num);
+}
+
+void irq_set_exclusive_handler(uint32_t num, irq_handler_t handler) {
+    irqs[num].handlers[0] = handler;
+    irqs[num].count       = 1;
+}
+
+void irq_add_shared_handler(uint32_t num, irq_handler_t handler, uint8_t order_priority) {
+    (void)order_priority;
+    if (irqs[num].count < 4) {
+        irqs[num].handlers[irqs[num].count++] = handler;
+    }
+}
+
+void irq_remove_handler(uint32_t num, irq_handler_t handler) {
+    sim_irq_t *q = &irqs[num];
+    for (int i = 0; i < q->count; i++) {
+        if (q->handlers[i] == handler) {
+            memmove(&q->handlers[i], &q->handlers[i + 1],
+                    (size_t)(q->count - i - 1) * sizeof(irq_handler_t));
+            q->count--;
+            return;
+        }
+    }
+}
+
+void irq_set_enabled(uint32_t num, bool enabled) {
+    irqs[num].enabled = enabled;
+    irqs[num].core    = sim_core_num();
+}
+
+void irq_set_priority(uint32_t num, uint8_t hardware_priority) {
+    (void)num;
+    (void)hardware_priority;
+}
+
+// GPIO
+
+typedef struct {
+    bool     out;
+    bool     out_value;
+    int      pull;        // 1 = pull-up, -1 = pull-down, 0 = ninguno
+    int      ext;         // nivel que fija el guion, -1 = suelto
+    uint     inover;
+    uint32_t irq_mask;
+    uint32_t irq_pending;  // eventos sin reconocer (manejadores crudos)
+    int      irq_core;
+    bool     level;       // nivel de entrada visto por el núcleo
+} sim_gpio_t;
+
+static sim_gpio_t          gpios[NUM_BANK0_GPIOS];
+static gpio_irq_callback_t gpio_callback[2];
+static irq_handler_t       gpio_raw_handler[NUM_BANK0_GPIOS];
+static bool                gpios_ready = false;
+
+// Pines que despiertan de dormant (flanco de bajada) y despertar pendiente
+static uint32_t      dormant_pins  = 0;
+static volatile bool dormant_woken = false;
+
+/**
+ * @brief Estado de reset: entradas con pull-down y sin nivel externo.
+ */
+static void gpio_reset_all(void) {
+    for (int i = 0; i < NUM_BANK0_GPIOS; i++) {
+        gpios[i] = (sim_gpio_t){ .pull = -1, .ext = -1 };
+    }
+    gpios_ready = true;
+}
+
+/**
+ * @brief Ejecuta el callback de GPIO del núcleo dueño.
+ */
+static void gpio_irq_fire(void *arg, uint32_t events) {
+    uint gpio = (uint)(uintptr_t)arg;
+    gpio_irq_callback_t cb = gpio_callback[gpios[gpio].irq_core];
+
+    if (cb) cb(gpio, events);
+}
+
+/**
+ * @brief Ejecuta el manejador crudo del pin, que lee y reconoce sus
+ *        eventos pendientes.
+ */
+static void gpio_raw_fire(void *arg, uint32_t events) {
+    uint gpio = (uint)(uintptr_t)arg;
+    (void)events;
+
+    if (gpios[gpio].irq_pending && gpio_raw_handler[gpio]) gpio_raw_handler[gpio]();
+}
+
+/**
+ * @brief Recalcula el nivel de entrada y dispara la IRQ del flanco.
+ */
+static void gpio_update(uint gpio) {
+    sim_gpio_t *g = &gpios[gpio];
+    bool pad;
+
+    if (g->ext >= 0) {
+        pad = (g->ext != 0);
+    } else if (g->out) {
+        pad = g->out_value;
+    } else {
+        pad = (g->pull > 0);
+    }
+
+    bool level;
+    switch (g->inover) {
+        case GPIO_OVERRIDE_INVERT: level = !pad;  break;
+        case GPIO_OVERRIDE_LOW:    level = false; break;
+        case GPIO_OVERRIDE_HIGH:   level = true;  break;
+        default:                   level = pad;   break;
+    }
+
+    if (level == g->level) return;
+    g->level = level;
+
+    if (!level && (dormant_pins & (1u << gpio))) {
+        dormant_woken = true;
+        sim_send_event();
+    }
+
+    uint32_t events = (level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL) & g->irq_mask;
+    if (events && gpio_raw_handler[gpio]) {
+        g->irq_pending |= events;
+        sim_event_at(sim_now_ps(), g->irq_core, gpio_raw_fire, (void *)(uintptr_t)gpio, events);
+    } else if (events) {
+        sim_event_at(sim_now_ps(), g->irq_core, gpio_irq_fire, (void *)(uintptr_t)gpio, events);
+    }
+}
+
+/**
+ * @brief Devuelve el pin, inicializando los GPIO la primera vez.
+ */
+static sim_gpio_t *gpio_pin(uint gpio) {
+    if (!gpios_ready) gpio_reset_all();
+    return &gpios[gpio % NUM_BANK0_GPIOS];
+}
+
+void gpio_init(uint gpio) {
+    sim_gpio_t *g = gpio_pin(gpio);
+    g->out       = false;
+    g->out_value = false;
+    gpio_update(gpio);
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    gpio_pin(gpio)->out = out;
+    gpio_update(gpio);
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void)gpio_pin(gpio);
+    (void)fn;
+}
+
+void gpio_pull_up(uint gpio) {
+    gpio_pin(gpio)->pull = 1;
+    gpio_update(gpio);
+}
+
+void gpio_pull_down(uint gpio) {
+    gpio_pin(gpio)->pull = -1;
+    gpio_update(gpio);
+}
+
+void gpio_disable_pulls(uint gpio) {
+    gpio_pin(gpio)->pull = 0;
+    gpio_update(gpio);
+}
+
+void gpio_put(uint gpio, bool value) {
+    gpio_pin(gpio)->out_value = value;
+    gpio_update(gpio);
+}
+
+bool gpio_get(uint gpio) {
+    return gpio_pin(gpio)->level;
+}
+
+uint32_t gpio_get_all(void) {
+    uint32_t all = 0;
+
+    for (uint gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+        if (gpio_pin(gpio)->level) all |= 1u << gpio;
+    }
+    return all;
+}
+
+void gpio_set_dormant_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    if (!(event_mask & GPIO_IRQ_EDGE_FALL)) return;
+
+    if (enabled) {
+        dormant_pins |= 1u << gpio;
+    } else {
+        dormant_pins &= ~(1u << gpio);
+    }
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask) {
+    gpio_pin(gpio)->irq_pending &= ~event_mask;
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio) {
+    return gpio_pin(gpio)->irq_pending;
+}
+
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler) {
+    (void)gpio_pin(gpio);
+    gpio_raw_handler[gpio % NUM_BANK0_GPIOS] = handler;
+}
+
+void xosc_dormant(void) {
+    // Core0 no puede bloquearse con las IRQ deshabilitadas en la simulación
+    bool irq_off = sim_irq_disable(false);
+
+    dormant_woken = false;
+    while (!dormant_woken) {
+        sim_wait_event();
+    }
+    sim_sleep_us((uint64_t)(xosc_hw->startup & XOSC_STARTUP_DELAY_BITS) * 256u /
+                 (XOSC_HZ / MHZ));
+
+    sim_irq_disable(irq_off);
+}
+
+void gpio_set_inover(uint gpio, uint value) {
+    gpio_pin(gpio)->inover = value;
+    gpio_update(gpio);
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    sim_gpio_t *g = gpio_pin(gpio);
+
+    if (enabled) {
+        g->irq_mask |= event_mask;
+    } else {
+        g->irq_mask &= ~event_mask;
+    }
+    g->irq_core = sim_core_num();
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled,
+                                        gpio_irq_callback_t callback) {
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+    gpio_callback[sim_core_num()] = callback;
+}
+
+void sim_gpio_drive(unsigned gpio, int level) {
+    gpio_pin(gpio)->ext = level;
+    gpio_update(gpio);
+}
+
+// Salida de audio (WAV)
+
+static FILE    *wav_file     = NULL;
+static bool     wav_started  = false;
+static uint32_t wav_rate     = 0;
+static uint64_t wav_frames   = 0;
+
+/**
+ * @brief Escribe la cabecera de un WAV PCM estéreo de 16 bits.
+ */
+static void wav_write_header(uint32_t rate, uint64_t frames) {
+    uint32_t data = (uint32_t)(frames * 4u);
+    uint8_t  h[44];
+
+    memcpy(h, "RIFF", 4);
+    uint32_t riff = 36u + data;
+    memcpy(h + 4, &riff, 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    uint32_t fmt_len = 16, byte_rate = rate * 4u;
+    uint16_t fmt = 1, ch = 2, align = 4, bits = 16;
+    memcpy(h + 16, &fmt_len, 4);
+    memcpy(h + 20, &fmt, 2);
+    memcpy(h + 22, &ch, 2);
+    memcpy(h + 24, &rate, 4);
+    memcpy(h + 28, &byte_rate, 4);
+    memcpy(h + 32, &align, 2);
+    memcpy(h + 34, &bits, 2);
+    memcpy(h + 36, "data", 4);
+    memcpy(h + 40, &data, 4);
+
+    fseek(wav_file, 0, SEEK_SET);
+    fwrite(h, 1, sizeof(h), wav_file);
+}
+
+/**
+ * @brief Agrega frames del FIFO del I2S al WAV.
+ */
+static void wav_append(const volatile uint32_t *words, uint32_t count, uint32_t rate) {
+    if (!wav_file || !wav_started) return;
+
+    if (wav_rate == 0) wav_rate = rate;
+    // La palabra del FIFO ya es el frame de un WAV estéreo de 16 bits (LE)
+    fwrite((const void *)words, 4, count, wav_file);
+    wav_frames += count;
+}
+
+bool sim_audio_open(const char *path) {
+    if (!path) return true;
+
+    wav_file = fopen(path, "wb");
+    if (!wav_file) return false;
+    wav_write_header(44100, 0);
+    return true;
+}
+
+void sim_audio_start(void) {
+    wav_started = true;
+}
+
+uint64_t sim_audio_close(void) {
+    if (wav_file) {
+        wav_write_header(wav_rate ? wav_rate : 44100, wav_frames);
+        fclose(wav_file);
+        wav_file = NULL;
+    }
+    return wav_frames;
+}
+
+// PIO
+
+typedef struct {
+    bool                 claimed;
+    bool                 enabled;
+    const pio_program_t *program;
+    float                clkdiv;
+} sim_sm_t;
+
+static sim_sm_t             sms[2][NUM_PIO_STATE_MACHINES];
+static const pio_program_t *pio_programs[2][32];   // por offset
+static uint                 pio_next_offset[2];
+
+static void dma_pio_changed(uint dreq);
+
+uint pio_get_index(PIO pio) {
+    return (uint)(pio - sim_pio_hw);
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program) {
+    return pio_next_offset[pio_get_index(pio)] + program->length <= 32u;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    uint p      = pio_get_index(pio);
+    uint offset = pio_next_offset[p];
+
+    pio_programs[p][offset] = program;
+    pio_next_offset[p] += program->length;
+    return offset;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    uint p = pio_get_index(pio);
+    for (int sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (!sms[p][sm].claimed) {
+            sms[p][sm].claimed = true;
+            return sm;
+        }
+    }
+    if (required) fprintf(stderr, "sim: sin state machines libres en pio%u\n", p);
+    return -1;
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+    return pio_get_index(pio) * 8u + (is_tx ? 0u : 4u) + sm;
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+    (void)pio;
+    (void)pin;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+    sim_sm_t *s = &sms[pio_get_index(pio)][sm];
+
+    s->enabled = false;
+    s->program = pio_programs[pio_get_index(pio)][initial_pc % 32u];
+    s->clkdiv  = config ? config->clkdiv : 1.0f;
+    dma_pio_changed(pio_get_dreq(pio, sm, true));
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    sms[pio_get_index(pio)][sm].enabled = enabled;
+    dma_pio_changed(pio_get_dreq(pio, sm, true));
+}
+
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div) {
+    sms[pio_get_index(pio)][sm].clkdiv = div;
+}
+
+void pio_sm_set_clkdiv_int_frac8(PIO pio, uint sm, uint32_t div_int, uint8_t div_frac8) {
+    sms[pio_get_index(pio)][sm].clkdiv = (float)div_int + (float)div_frac8 / 256.0f;
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+    (void)pio;
+    (void)sm;
+}
+
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask) {
+    (void)pio; (void)sm; (void)pin_dirs; (void)pin_mask;
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask) {
+    (void)pio; (void)sm; (void)pin_values; (void)pin_mask;
+}
+
+/**
+ * @brief State machine que atiende una DREQ TX del PIO, o NULL.
+ */
+static sim_sm_t *sm_from_dreq(uint dreq) {
+    if (dreq >= 16u || (dreq % 8u) >= 4u) return NULL;
+    return &sms[dreq / 8u][dreq % 4u];
+}
+
+/**
+ * @brief Duración de @p words palabras en un state machine.
+ *
+ * El divisor se trunca a 16.8 bits como en el hardware.
+ */
+static uint64_t sm_words_ps(const sim_sm_t *s, uint32_t words) {
+    uint32_t div_q8 = (uint32_t)(s->clkdiv * 256.0f);
+    if (div_q8 < 256u) div_q8 = 256u;
+
+    double ps = (double)words * s->program->cycles_per_word * div_q8 * 1e12 /
+                (256.0 * (double)sys_hz);
+    return (uint64_t)llround(ps);
+}
+
+/**
+ * @brief Frames por segundo de un state machine, redondeados.
+ */
+static uint32_t sm_rate(const sim_sm_t *s) {
+    return (uint32_t)llround(1e12 * 1000.0 / (double)sm_words_ps(s, 1000));
+}
+
+// DMA
+
+typedef struct {
+    bool                claimed;
+    dma_channel_config  config;
+    volatile void      *write_addr;
+    const volatile void *read_addr;
+    uint32_t            count;
+    bool                busy;       // en curso o esperando al PIO
+    bool                running;    // con fin de bloque programado
+    bool                irq1_enabled;
+    uint32_t            tag;
+} sim_dma_t;
+
+static sim_dma_t dmas[NUM_DMA_CHANNELS];
+static uint32_t  dma_ints1 = 0;
+
+static void dma_begin(uint ch);
+static bool i2c_dma_begin(uint ch);
+
+/**
+ * @brief Fin de bloque: palabras al FIFO, encadenamiento e IRQ.
+ */
+static void dma_complete(void *arg, uint32_t tag) {
+    uint       ch = (uint)(uintptr_t)arg;
+    sim_dma_t *d  = &dmas[ch];
+
+    if (!d->running || d->tag != tag) return;
+
+    sim_sm_t *s = sm_from_dreq(d->config.dreq);
+    if (s && s->program) {
+        uint p  = d->config.dreq / 8u;
+        uint sm = d->config.dreq % 4u;
+        if (d->write_addr == (volatile void *)&sim_pio_hw[p].txf[sm]) {
+            wav_append((const volatile uint32_t *)d->read_addr, d->count, sm_rate(s));
+        }
+    }
+
+    d->busy    = false;
+    d->running = false;
+
+    if (d->config.chain_to != ch) {
+        dma_channel_start(d->config.chain_to);
+    }
+    if (d->irq1_enabled) {
+        dma_ints1 |= 1u << ch;
+        irq_raise(DMA_IRQ_1);
+    }
+}
+
+/**
+ * @brief Programa el fin de bloque si el state machine está corriendo.
+ */
+static void dma_begin(uint ch) {
+    sim_dma_t *d = &dmas[ch];
+    sim_sm_t  *s = sm_from_dreq(d->config.dreq);
+
+    d->tag++;
+    d->running = false;
+
+    if (i2c_dma_begin(ch)) {
+        return;
+    }
+    if (s && (!s->enabled || !s->program)) {
+        return;   // espera a que el PIO arranque
+    }
+
+    uint64_t dur = s ? sm_words_ps(s, d->count) : 0;
+    d->running = true;
+    sim_event_at(sim_now_ps() + dur, -1, dma_complete, (void *)(uintptr_t)ch, d->tag);
+}
+
+/**
+ * @brief Reanuda o detiene los canales que dependen de un state machine.
+ *
+ * Un canal detenido a mitad de bloque lo repite entero al reanudarse.
+ */
+static void dma_pio_changed(uint dreq) {
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (dmas[ch].busy && dmas[ch].config.dreq == dreq) {
+            dma_begin(ch);
+        }
+    }
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (!dmas[ch].claimed) {
+            dmas[ch].claimed = true;
+            return ch;
+        }
+    }
+    if (required) fprintf(stderr, "sim: sin canales DMA libres\n");
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+    dmas[channel].claimed = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    dma_channel_config c = {
+        .size = DMA_SIZE_32, .read_increment = true, .write_increment = false,
+        .dreq = 0x3f, .chain_to = channel
+    };
+    return c;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config,
+                           volatile void *write_addr, const volatile void *read_addr,
+                           uint transfer_count, bool trigger) {
+    sim_dma_t *d = &dmas[channel];
+
+    d->config     = *config;
+    d->write_addr = write_addr;
+    d->read_addr  = read_addr;
+    d->count      = transfer_count;
+    if (trigger) dma_channel_start(channel);
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger) {
+    dmas[channel].read_addr = read_addr;
+    if (trigger) dma_channel_start(channel);
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    dmas[channel].count = trans_count;
+    if (trigger) dma_channel_start(channel);
+}
+
+void dma_channel_start(uint channel) {
+    dmas[channel].busy = true;
+    dma_begin(channel);
+}
+
+void dma_channel_abort(uint channel) {
+    dmas[channel].busy    = false;
+    dmas[channel].running = false;
+    dmas[channel].tag++;
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return dmas[channel].busy;
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) {
+    dmas[channel].irq1_enabled = enabled;
+}
+
+bool dma_channel_get_irq1_status(uint channel) {
+    return (dma_ints1 >> channel) & 1u;
+}
+
+void dma_channel_acknowledge_irq1(uint channel) {
+    dma_ints1 &= ~(1u << channel);
+}
+
+// I2C: MPU6050 y LCD
+
+i2c_hw_t sim_i2c_hw[2];
+
+// Transacción por DMA en curso en cada bloque I2C
+static uint8_t  i2c_rx_data[2][256];
+static uint32_t i2c_rx_len[2];
+static int      i2c_tx_ch[2] = { -1, -1 };
+
+static uint8_t mpu_regs[128];
+static uint8_t mpu_ptr = 0;
+static bool    mpu_ready = false;
+
+// FIFO y muestreo del MPU6050
+#define MPU_REG_SMPLRT_DIV  0x19
+#define MPU_REG_CONFIG      0x1A
+#define MPU_REG_FIFO_EN     0x23
+#define MPU_REG_INT_ENABLE  0x38
+#define MPU_REG_USER_CTRL   0x6A
+#define MPU_REG_PWR_MGMT_1  0x6B
+#define MPU_REG_FIFO_COUNTH 0x72
+#define MPU_REG_FIFO_COUNTL 0x73
+#define MPU_REG_FIFO_R_W    0x74
+#define MPU_FIFO_SIZE       1024u
+#define MPU_INT_PULSE_US    50u
+
+static uint8_t  mpu_fifo[MPU_FIFO_SIZE];
+static uint32_t mpu_fifo_head = 0;
+static uint32_t mpu_fifo_len  = 0;
+static uint64_t mpu_period_ps = 0;    // 0 = sin muestrear
+static uint32_t mpu_tick_tag  = 0;
+
+// LCD HD44780 en modo 4 bits detrás del PCF8574 (RS=bit0, EN=bit2)
+static char    lcd_text[2][17];
+static uint8_t lcd_col = 0, lcd_row = 0;
+static uint8_t lcd_prev = 0;
+static int     lcd_high = -1;   // primer nibble del byte en curso
+static bool    lcd_dirty = false;
+
+/**
+ * @brief Escribe un valor de 16 bits con signo en dos registros (big-endian).
+ */
+static void mpu_put16(uint8_t reg, float value) {
+    long v = lroundf(value);
+    if (v >  32767) v =  32767;
+    if (v < -32768) v = -32768;
+    mpu_regs[reg]     = (uint8_t)((uint16_t)v >> 8);
+    mpu_regs[reg + 1] = (uint8_t)v;
+}
+
+void sim_imu_set(float ax, float ay, float az, float gx, float gy, float gz) {
+    mpu_put16(0x3B, ax * 16384.0f);
+    mpu_put16(0x3D, ay * 16384.0f);
+    mpu_put16(0x3F, az * 16384.0f);
+    mpu_put16(0x43, gx * 131.0f);
+    mpu_put16(0x45, gy * 131.0f);
+    mpu_put16(0x47, gz * 131.0f);
+    mpu_ready = true;
+}
+
+/**
+ * @brief Aplica un byte completo (comando o carácter) al LCD.
+ */
+static void lcd_byte(uint8_t value, bool data) {
+    if (data) {
+        if (lcd_col < 16) {
+            lcd_text[lcd_row][lcd_col++] = (char)value;
+            lcd_dirty = true;
+        }
+    } else if (value == 0x01) {
+        memset(lcd_text, ' ', sizeof(lcd_text));
+        lcd_text[0][16] = lcd_text[1][16] = '\0';
+        lcd_col = lcd_row = 0;
+        lcd_dirty = true;
+    } else if (value & 0x80) {
+        uint8_t addr = value & 0x7F;
+        lcd_row = (addr >= 0x40) ? 1 : 0;
+        lcd_col = addr & 0x3F;
+    }
+}
+
+/**
+ * @brief Decodifica una escritura al PCF8574: el flanco de bajada de EN
+ *        entrega un nibble.
+ */
+static void lcd_write_raw(uint8_t b) {
+    if ((lcd_prev & 0x04) && !(b & 0x04)) {
+        uint8_t nibble = lcd_prev & 0xF0;
+        if (lcd_high < 0) {
+            lcd_high = nibble;
+        } else {
+            lcd_byte((uint8_t)(lcd_high | (nibble >> 4)), lcd_prev & 0x01);
+            lcd_high = -1;
+        }
+    }
+    lcd_prev = b;
+}
+
+/**
+ * @brief Imprime el LCD si cambió desde la última vez.
+ */
+static void lcd_flush(void) {
+    if (!lcd_dirty) return;
+    lcd_dirty = false;
+    printf("[LCD] |%s| |%s|\n", lcd_text[0], lcd_text[1]);
+}
+
+/**
+ * @brief Agrega un byte a la FIFO del MPU6050; llena, pierde el más viejo.
+ */
+static void mpu_fifo_push(uint8_t b) {
+    if (mpu_fifo_len == MPU_FIFO_SIZE) {
+        mpu_fifo_head = (mpu_fifo_head + 1u) % MPU_FIFO_SIZE;
+        mpu_fifo_len--;
+    }
+    mpu_fifo[(mpu_fifo_head + mpu_fifo_len) % MPU_FIFO_SIZE] = b;
+    mpu_fifo_len++;
+}
+
+/**
+ * @brief Lectura de FIFO_R_W: el byte más viejo (0 con la FIFO vacía).
+ */
+static uint8_t mpu_fifo_pop(void) {
+    if (mpu_fifo_len == 0) return 0;
+    uint8_t b = mpu_fifo[mpu_fifo_head];
+    mpu_fifo_head = (mpu_fifo_head + 1u) % MPU_FIFO_SIZE;
+    mpu_fifo_len--;
+    return b;
+}
+
+/**
+ * @brief Fin del pulso INT.
+ */
+static void mpu_int_end(void *arg, uint32_t tag) {
+    (void)arg;
+    (void)tag;
+    sim_gpio_drive(MPU6050_INT_PIN, 0);
+}
+
+/**
+ * @brief Una muestra del MPU6050: a la FIFO y pulso en INT.
+ */
+static void mpu_tick(void *arg, uint32_t tag) {
+    (void)arg;
+    if (tag != mpu_tick_tag || mpu_period_ps == 0) return;
+
+    if (mpu_regs[MPU_REG_USER_CTRL] & 0x40) {
+        uint8_t en = mpu_regs[MPU_REG_FIFO_EN];
+        if (en & 0x08) {
+            for (uint8_t r = 0x3B; r < 0x41; r++) mpu_fifo_push(mpu_regs[r]);
+        }
+        if (en & 0x70) {
+            for (uint8_t r = 0x43; r < 0x49; r++) mpu_fifo_push(mpu_regs[r]);
+        }
+    }
+    if (mpu_regs[MPU_REG_INT_ENABLE] & 0x01) {
+        sim_gpio_drive(MPU6050_INT_PIN, 1);
+        sim_event_at(sim_now_ps() + MPU_INT_PULSE_US * SIM_PS_PER_US, -1, mpu_int_end, NULL, 0);
+    }
+    sim_event_at(sim_now_ps() + mpu_period_ps, -1, mpu_tick, NULL, tag);
+}
+
+/**
+ * @brief Aplica una escritura de registros: reset de la FIFO, sueño y ODR.
+ */
+static void mpu_regs_changed(void) {
+    if (mpu_regs[MPU_REG_USER_CTRL] & 0x04) {
+        mpu_fifo_head = 0;
+        mpu_fifo_len  = 0;
+        mpu_regs[MPU_REG_USER_CTRL] &= (uint8_t)~0x04;
+    }
+
+    bool run = !(mpu_regs[MPU_REG_PWR_MGMT_1] & 0x40) &&
+               ((mpu_regs[MPU_REG_USER_CTRL] & 0x40) || (mpu_regs[MPU_REG_INT_ENABLE] & 0x01));
+
+    // Muestreo interno a 8 kHz sin DLPF, 1 kHz con él
+    uint8_t  dlpf   = mpu_regs[MPU_REG_CONFIG] & 0x07;
+    uint32_t base   = (dlpf == 0 || dlpf == 7) ? 8000u : 1000u;
+    uint64_t period = run ? 1000000000000ull * (1u + mpu_regs[MPU_REG_SMPLRT_DIV]) / base : 0;
+
+    if (period != mpu_period_ps) {
+        mpu_period_ps = period;
+        mpu_tick_tag++;
+        if (period) {
+            sim_event_at(sim_now_ps() + period, -1, mpu_tick, NULL, mpu_tick_tag);
+        }
+    }
+}
+
+/**
+ * @brief Fin de una transacción por DMA: el canal RX recibe los bytes y
+ *        se levanta la IRQ de STOP si está habilitada.
+ */
+static void i2c_dma_done(void *arg, uint32_t tag) {
+    uint idx = (uint)(uintptr_t)arg;
+    int  tx  = i2c_tx_ch[idx];
+
+    if (tx < 0 || dmas[tx].tag != tag || !dmas[tx].running) return;
+    dmas[tx].busy    = false;
+    dmas[tx].running = false;
+
+    uint rx_dreq = SIM_DREQ_I2C0_TX + idx * 2u + 1u;
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        sim_dma_t *d = &dmas[ch];
+        if (!d->busy || d->config.dreq != rx_dreq) continue;
+
+        volatile uint8_t *dst = (volatile uint8_t *)d->write_addr;
+        for (uint32_t i = 0; i < d->count && i < i2c_rx_len[idx]; i++) {
+            dst[d->config.write_increment ? i : 0] = i2c_rx_data[idx][i];
+        }
+        d->busy = false;
+        break;
+    }
+
+    i2c_hw_t *hw = &sim_i2c_hw[idx];
+    hw->raw_intr_stat |= I2C_IC_INTR_STAT_R_STOP_DET_BITS;
+    hw->intr_stat      = hw->raw_intr_stat & hw->intr_mask;
+    if (hw->intr_stat) irq_raise(I2C0_IRQ + idx);
+}
+
+/**
+ * @brief Canal con la DREQ de un I2C: el TX ejecuta los comandos de
+ *        IC_DATA_CMD y programa el fin de la transacción; el RX espera.
+ *
+ * @return false si el canal no es de un I2C.
+ */
+static bool i2c_dma_begin(uint ch) {
+    sim_dma_t *d    = &dmas[ch];
+    uint       dreq = d->config.dreq;
+
+    if (dreq < SIM_DREQ_I2C0_TX || dreq > SIM_DREQ_I2C0_TX + 3u) return false;
+    if ((dreq - SIM_DREQ_I2C0_TX) & 1u) return true;
+
+    uint        idx  = (dreq - SIM_DREQ_I2C0_TX) / 2u;
+    i2c_inst_t *i2c  = &sim_i2c_inst[idx];
+    uint8_t     addr = (uint8_t)sim_i2c_hw[idx].tar;
+    uint8_t     wr[64];
+    uint32_t    nwr = 0, nrd = 0;
+
+    for (uint32_t i = 0; i < d->count; i++) {
+        uint32_t w;
+        switch (d->config.size) {
+            case DMA_SIZE_32: w = ((const volatile uint32_t *)d->read_addr)[i]; break;
+            case DMA_SIZE_16: w = ((const volatile uint16_t *)d->read_addr)[i]; break;
+            default:          w = ((const volatile uint8_t *)d->read_addr)[i];  break;
+        }
+        if (w & I2C_IC_DATA_CMD_CMD_BITS) {
+            nrd++;
+        } else if (nrd == 0 && nwr < sizeof(wr)) {
+            wr[nwr++] = (uint8_t)w;
+        }
+    }
+    if (nrd > sizeof(i2c_rx_data[idx])) nrd = sizeof(i2c_rx_data[idx]);
+
+    if (nwr) i2c_write_blocking(i2c, addr, wr, nwr, nrd > 0);
+    if (nrd) i2c_read_blocking(i2c, addr, i2c_rx_data[idx], nrd, false);
+    i2c_rx_len[idx] = nrd;
+    i2c_tx_ch[idx]  = (int)ch;
+    sim_i2c_hw[idx].raw_intr_stat = 0;
+
+    // Dirección y bytes de 9 bits; con lectura, otra dirección tras el RESTART
+    uint64_t bits = 9ull * (1u + nwr + (nrd ? 1u + nrd : 0u));
+    d->running = true;
+    sim_event_at(sim_now_ps() + bits * 1000000000000ull / i2c_baud[idx], -1,
+                 i2c_dma_done, (void *)(uintptr_t)idx, d->tag);
+    return true;
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c_baud[i2c->index] = baudrate;
+    if (!mpu_ready) sim_imu_set(0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
+    if (lcd_text[0][0] == '\0') lcd_byte(0x01, false);
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+
+    if (addr == SIM_MPU6050_ADDR) {
+        if (len > 0) mpu_ptr = src[0] & 0x7F;
+        for (size_t i = 1; i < len; i++) {
+            mpu_regs[mpu_ptr] = src[i];
+            mpu_ptr = (mpu_ptr + 1) & 0x7F;
+        }
+        if (len > 1) mpu_regs_changed();
+        return (int)len;
+    }
+    if (addr == SIM_LCD_ADDR) {
+        for (size_t i = 0; i < len; i++) lcd_write_raw(src[i]);
+        return (int)len;
+    }
+    return PICO_ERROR_GENERIC;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+
+    if (addr != SIM_MPU6050_ADDR) return PICO_ERROR_GENERIC;
+    for (size_t i = 0; i < len; i++) {
+        if (mpu_ptr == MPU_REG_FIFO_R_W) {
+            dst[i] = mpu_fifo_pop();   // FIFO_R_W no avanza el puntero
+            continue;
+        }
+        if (mpu_ptr == MPU_REG_FIFO_COUNTH) {
+            dst[i] = (uint8_t)(mpu_fifo_len >> 8);
+        } else if (mpu_ptr == MPU_REG_FIFO_COUNTL) {
+            dst[i] = (uint8_t)mpu_fifo_len;
+        } else {
+            dst[i] = mpu_regs[mpu_ptr];
+        }
+        mpu_ptr = (mpu_ptr + 1) & 0x7F;
+    }
+    return (int)len;
+}
+
+// Temporizadores
+
+static alarm_id_t timer_next_id = 1;
+
+/**
+ * @brief Vencimiento de un temporizador repetitivo.
+ */
+static void timer_fire(void *arg, uint32_t id) {
+    repeating_timer_t *rt = arg;
+
+    if (rt->alarm_id != (alarm_id_t)id) return;   // cancelado o reprogramado
+
+    bool again = rt->callback(rt);
+    if (again && rt->alarm_id == (alarm_id_t)id) {
+        uint64_t delay = (uint64_t)(rt->delay_us < 0 ? -rt->delay_us : rt->delay_us);
+        sim_event_at(sim_now_ps() + delay * SIM_PS_PER_US, sim_core_num(), timer_fire, rt, id);
+    } else if (rt->alarm_id == (alarm_id_t)id) {
+        rt->alarm_id = 0;
+    }
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback,
+                            void *user_data, repeating_timer_t *out) {
+    if (delay_us == 0) delay_us = 1;
+
+    out->delay_us  = delay_us;
+    out->callback  = callback;
+    out->user_data = user_data;
+    out->alarm_id  = timer_next_id++;
+
+    uint64_t delay = (uint64_t)(delay_us < 0 ? -delay_us : delay_us);
+    sim_event_at(sim_now_ps() + delay * SIM_PS_PER_US, sim_core_num(), timer_fire,
+                 out, (uint32_t)out->alarm_id);
+    return true;
+}
+
+bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback,
+                            void *user_data, repeating_timer_t *out) {
+    return add_repeating_timer_us((int64_t)delay_ms * 1000, callback, user_data, out);
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+    bool active = (timer->alarm_id != 0);
+    timer->alarm_id = 0;
+    return active;
+}
+
+/** Alarmas de un disparo activas a la vez. */
+#define SIM_ALARMS 16
+
+typedef struct {
+    alarm_id_t        id;          // 0 = libre
+    alarm_callback_t  callback;
+    void             *user_data;
+    uint64_t          due_us;
+} sim_alarm_t;
+
+static sim_alarm_t alarms[SIM_ALARMS];
+
+/**
+ * @brief Vencimiento de una alarma; la reprograma según lo que devuelva
+ *        su callback (<0: desde ahora, >0: desde el vencimiento).
+ */
+static void alarm_fire(void *arg, uint32_t id) {
+    sim_alarm_t *a = arg;
+
+    if (a->id != (alarm_id_t)id) return;
+
+    int64_t again = a->callback(a->id, a->user_data);
+    if (again == 0) {
+        a->id = 0;
+        return;
+    }
+    a->due_us = (again < 0) ? sim_now_us() + (uint64_t)(-again) : a->due_us + (uint64_t)again;
+    sim_event_at(a->due_us * SIM_PS_PER_US, sim_core_num(), alarm_fire, a, id);
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data,
+                           bool fire_if_past) {
+    (void)fire_if_past;
+
+    for (int i = 0; i < SIM_ALARMS; i++) {
+        sim_alarm_t *a = &alarms[i];
+        if (a->id != 0) continue;
+
+        a->id        = timer_next_id++;
+        a->callback  = callback;
+        a->user_data = user_data;
+        a->due_us    = sim_now_us() + us;
+        sim_event_at(a->due_us * SIM_PS_PER_US, sim_core_num(), alarm_fire, a,
+                     (uint32_t)a->id);
+        return a->id;
+    }
+    return -1;
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data,
+                           bool fire_if_past) {
+    return add_alarm_in_us((uint64_t)ms * 1000u, callback, user_data, fire_if_past);
+}
+
+// Plazo más cercano ya programado por núcleo (0 = ninguno)
+static uint64_t wfe_timeout_us[2];
+
+/**
+ * @brief Plazo de best_effort_wfe_or_timeout(): solo despierta al núcleo.
+ */
+static void wfe_timeout_fire(void *arg, uint32_t core) {
+    (void)arg;
+    if (sim_now_us() >= wfe_timeout_us[core]) wfe_timeout_us[core] = 0;
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout) {
+    int k = sim_core_num();
+
+    // Core0 se va a dormir: la pantalla ya quedó como la dejó el firmware
+    if (k == 0) lcd_flush();
+
+    if (sim_now_us() >= timeout) return true;
+
+    // Un plazo posterior al ya programado no necesita otro evento: el
+    // núcleo despertará antes y volverá a pedirlo
+    if (wfe_timeout_us[k] == 0 || timeout < wfe_timeout_us[k]) {
+        wfe_timeout_us[k] = timeout;
+        sim_event_at(timeout * SIM_PS_PER_US, k, wfe_timeout_fire, NULL, (uint32_t)k);
+    }
+    sim_wait_event();
+    return sim_now_us() >= timeout;
+}
+
+// Consola
+
+static char     console_buf[SIM_CONSOLE_SIZE];
+static uint32_t console_head = 0, console_tail = 0;
+
+static void (*console_cb)(void *) = NULL;
+static void  *console_cb_param    = NULL;
+
+/**
+ * @brief Aviso de caracteres disponibles, como IRQ de USB en core0.
+ */
+static void console_fire(void *arg, uint32_t tag) {
+    (void)arg;
+    (void)tag;
+    if (console_cb) console_cb(console_cb_param);
+}
+
+void sim_console_push(const char *text) {
+    while (*text && console_head - console_tail < SIM_CONSOLE_SIZE) {
+        console_buf[console_head++ % SIM_CONSOLE_SIZE] = *text++;
+    }
+    sim_event_at(sim_now_ps(), 0, console_fire, NULL, 0);
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param) {
+    console_cb       = fn;
+    console_cb_param = param;
+}
+
+bool stdio_init_all(void) {
+    return true;
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    // La primera consulta marca la entrada al bucle principal del firmware
+    if (!sim_script_started()) {
+        sim_audio_start();
+        sim_script_start();
+    }
+    lcd_flush();
+
+    if (console_head == console_tail && timeout_us > 0) {
+        sim_sleep_us(timeout_us);
+    }
+    if (console_head == console_tail) {
+        return PICO_ERROR_TIMEOUT;
+    }
+    return (unsigned char)console_buf[console_tail++ % SIM_CONSOLE_SIZE];
+}
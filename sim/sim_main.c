@@ -0,0 +1,121 @@
+/**
+ * @file sim_main.c
+ * @brief Programa de la simulación: opciones, corrida y resumen.
+ *
+ * Uso:
+ *   handino_sim -i <imagen_sd> [-s <guion>] [-o <salida.wav>] [-c <cola_ms>]
+ *               [-l <cmd_us>:<sector_us>] [-a <arranque_s>]
+ *
+ *  - -i: imagen FAT con el contenido de la tarjeta SD.
+ *  - -s: guion de la interpretación (ver sim_script.c).
+ *  - -o: WAV con el audio que llega al I2S desde el instante 0 del guion.
+ *  - -c: audio a renderizar tras el último evento del guion (2000 ms).
+ *  - -l: latencia de cada lectura de la SD (200:170 us, SPI a 25 MHz).
+ *  - -a: tiempo virtual máximo para que el firmware termine de arrancar (60 s).
+ *
+ * La salida del firmware (printf) va a stdout; el resumen de la
+ * simulación, a stderr.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Segundos de reloj real (monótono).
+ */
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Imprime el uso del programa.
+ */
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s -i <imagen_sd> [-s <guion>] [-o <salida.wav>] [-c <cola_ms>]\n"
+            "          [-l <cmd_us>:<sector_us>] [-a <arranque_s>]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *image_path  = NULL;
+    const char *script_path = NULL;
+    const char *wav_path    = NULL;
+    uint32_t    tail_ms     = 2000;
+    unsigned    cmd_us      = 200;
+    unsigned    sector_us   = 170;
+    unsigned    boot_s      = 60;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "i:s:o:c:l:a:")) != -1) {
+        switch (opt) {
+            case 'i': image_path  = optarg; break;
+            case 's': script_path = optarg; break;
+            case 'o': wav_path    = optarg; break;
+            case 'c': tail_ms     = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'a': boot_s      = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'l':
+                if (sscanf(optarg, "%u:%u", &cmd_us, &sector_us) != 2) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (!image_path) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!sim_disk_open(image_path, cmd_us, sector_us)) {
+        fprintf(stderr, "No se pudo abrir la imagen %s\n", image_path);
+        return 1;
+    }
+    if (!sim_script_load(script_path, tail_ms)) {
+        return 1;
+    }
+    if (!sim_audio_open(wav_path)) {
+        fprintf(stderr, "No se pudo crear %s\n", wav_path);
+        return 1;
+    }
+
+    // Límite para el arranque; el guion fija el final al empezar
+    sim_stop_at((uint64_t)boot_s * 1000000u * SIM_PS_PER_US);
+
+    double wall0 = wall_seconds();
+    int    rc    = sim_run(firmware_main);
+    double wall  = wall_seconds() - wall0;
+
+    fflush(stdout);
+    uint64_t frames = sim_audio_close();
+
+    if (!sim_script_started()) {
+        fprintf(stderr, "El firmware no llegó a su bucle principal en %u s virtuales\n", boot_s);
+        return rc ? rc : 1;
+    }
+
+    uint64_t reads, sectors;
+    sim_disk_stats(&reads, &sectors);
+
+    double virt = (double)sim_now_us() * 1e-6;
+    fprintf(stderr, "Simulados %.2f s en %.2f s reales (x%.1f)\n",
+            virt, wall, wall > 0.0 ? virt / wall : 0.0);
+    fprintf(stderr, "Audio: %llu frames%s%s | SD: %llu lecturas, %llu sectores\n",
+            (unsigned long long)frames, wav_path ? " en " : "", wav_path ? wav_path : "",
+            (unsigned long long)reads, (unsigned long long)sectors);
+    return rc;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file sim_script.c
+ * @brief Guion de la interpretación simulada.
+ *
+ * Formato: una acción por línea, "<ms> <acción> [argumentos]", con '#'
+ * para comentarios. El instante 0 es la entrada del firmware a su bucle
+ * principal (la primera consulta de la consola), así que el guion no
+ * depende de cuánto tarde el arranque.
+ *
+ *  | Acción                          | Efecto                                  |
+ *  |---------------------------------|-----------------------------------------|
+ *  | pulsar <botón>                  | Lleva el pin del botón a 0              |
+ *  | soltar <botón>                  | Suelta el pin (vuelve el pull-up)       |
+ *  | tocar <botón> [ms]              | Pulsa y suelta tras ms (60 por defecto) |
+ *  | imu <ax> <ay> <az> <gx> <gy> <gz> | Lectura del MPU6050 en g y grados/s   |
+ *  | consola <texto>                 | Texto recibido por la consola USB       |
+ *  | fin                             | Termina la simulación                   |
+ *
+ * Botones: do, re, mi, fa, sol, la, si, slot, next, prev.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "sim.h"
+#include "button_controller.h"
+#include "botones.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Duración por defecto de "tocar". */
+#define SCRIPT_TAP_MS 60
+
+typedef enum {
+    SCRIPT_PRESS,
+    SCRIPT_RELEASE,
+    SCRIPT_TAP,
+    SCRIPT_IMU,
+    SCRIPT_CONSOLE,
+    SCRIPT_END
+} script_action_t;
+
+typedef struct {
+    uint32_t        ms;
+    script_action_t action;
+    unsigned        gpio;
+    uint32_t        hold_ms;
+    float           imu[6];
+    char            text[64];
+} script_event_t;
+
+static const struct {
+    const char *name;
+    unsigned    gpio;
+} script_buttons[] = {
+    { "do",   BTN_DO   }, { "re",   BTN_RE   }, { "mi",   BTN_MI   },
+    { "fa",   BTN_FA   }, { "sol",  BTN_SOL  }, { "la",   BTN_LA   },
+    { "si",   BTN_SI   }, { "slot", BTN_SLOT }, { "next", BTN_NEXT },
+    { "prev", BTN_PREV },
+};
+
+static script_event_t *script      = NULL;
+static uint32_t        script_len  = 0;
+static uint32_t        script_next = 0;
+static uint32_t        script_tail = 0;
+static uint64_t        script_t0   = 0;
+static bool            started     = false;
+
+/**
+ * @brief Instante virtual de un evento del guion.
+ */
+static uint64_t script_time(uint32_t ms) {
+    return script_t0 + (uint64_t)ms * 1000u * SIM_PS_PER_US;
+}
+
+/**
+ * @brief Busca el GPIO de un botón por nombre.
+ * @return false si el nombre no existe.
+ */
+static bool script_button(const char *name, unsigned *gpio) {
+    for (size_t i = 0; i < sizeof(script_buttons) / sizeof(script_buttons[0]); i++) {
+        if (strcmp(name, script_buttons[i].name) == 0) {
+            *gpio = script_buttons[i].gpio;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Suelta el botón de un "tocar".
+ */
+static void script_release(void *arg, uint32_t gpio) {
+    (void)arg;
+    sim_gpio_drive(gpio, -1);
+}
+
+/**
+ * @brief Ejecuta el evento actual del guion y programa el siguiente.
+ */
+static void script_fire(void *arg, uint32_t index) {
+    (void)arg;
+    script_event_t *e = &script[index];
+
+    switch (e->action) {
+        case SCRIPT_PRESS:
+            sim_gpio_drive(e->gpio, 0);
+            break;
+        case SCRIPT_RELEASE:
+            sim_gpio_drive(e->gpio, -1);
+            break;
+        case SCRIPT_TAP:
+            sim_gpio_drive(e->gpio, 0);
+            sim_event_at(script_time(e->ms + e->hold_ms), -1, script_release, NULL, e->gpio);
+            break;
+        case SCRIPT_IMU:
+            sim_imu_set(e->imu[0], e->imu[1], e->imu[2], e->imu[3], e->imu[4], e->imu[5]);
+            break;
+        case SCRIPT_CONSOLE:
+            sim_console_push(e->text);
+            break;
+        case SCRIPT_END:
+            sim_stop_at(sim_now_ps());
+            break;
+    }
+
+    if (++script_next < script_len) {
+        sim_event_at(script_time(script[script_next].ms), -1, script_fire, NULL, script_next);
+    }
+}
+
+/**
+ * @brief Interpreta una línea del guion.
+ * @return false si la línea no es válida.
+ */
+static bool script_parse(char *line, script_event_t *e) {
+    char action[16], arg[16];
+    int  used = 0;
+
+    memset(e, 0, sizeof(*e));
+    if (sscanf(line, "%u %15s %n", &e->ms, action, &used) < 2) return false;
+    char *rest = line + used;
+
+    if (strcmp(action, "pulsar") == 0 || strcmp(action, "soltar") == 0 ||
+        strcmp(action, "tocar") == 0) {
+        e->hold_ms = SCRIPT_TAP_MS;
+        if (sscanf(rest, "%15s %u", arg, &e->hold_ms) < 1 || !script_button(arg, &e->gpio)) {
+            return false;
+        }
+        e->action = (action[0] == 'p') ? SCRIPT_PRESS :
+                    (action[0] == 's') ? SCRIPT_RELEASE : SCRIPT_TAP;
+        return true;
+    }
+    if (strcmp(action, "imu") == 0) {
+        e->action = SCRIPT_IMU;
+        return sscanf(rest, "%f %f %f %f %f %f", &e->imu[0], &e->imu[1], &e->imu[2],
+                      &e->imu[3], &e->imu[4], &e->imu[5]) == 6;
+    }
+    if (strcmp(action, "consola") == 0) {
+        e->action = SCRIPT_CONSOLE;
+        rest[strcspn(rest, "\r\n")] = '\0';
+        snprintf(e->text, sizeof(e->text), "%s", rest);
+        return true;
+    }
+    if (strcmp(action, "fin") == 0) {
+        e->action = SCRIPT_END;
+        return true;
+    }
+    return false;
+}
+
+
+// API
+
+bool sim_script_load(const char *path, uint32_t tail_ms) {
+    script_tail = tail_ms;
+    if (!path) return true;
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir el guion %s\n", path);
+        return false;
+    }
+
+    char     line[160];
+    uint32_t line_no = 0;
+    bool     ok = true;
+
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+
+        script_event_t e;
+        if (!script_parse(p, &e)) {
+            fprintf(stderr, "%s:%u: línea no válida\n", path, line_no);
+            ok = false;
+            continue;
+        }
+
+        script_event_t *grown = realloc(script, (script_len + 1) * sizeof(*script));
+        if (!grown) {
+            ok = false;
+            break;
+        }
+        script = grown;
+
+        // Inserción ordenada por instante, estable entre líneas iguales
+        uint32_t i = script_len++;
+        while (i > 0 && script[i - 1].ms > e.ms) {
+            script[i] = script[i - 1];
+            i--;
+        }
+        script[i] = e;
+    }
+    fclose(f);
+    return ok;
+}
+
+void sim_script_start(void) {
+    started   = true;
+    script_t0 = sim_now_ps();
+
+    uint32_t end_ms = 0;
+    bool     has_end = false;
+    for (uint32_t i = 0; i < script_len; i++) {
+        uint32_t ms = script[i].ms + (script[i].action == SCRIPT_TAP ? script[i].hold_ms : 0);
+        if (ms > end_ms) end_ms = ms;
+        has_end |= (script[i].action == SCRIPT_END);
+    }
+    // Reemplaza el límite de arranque, también con "fin" después de él
+    sim_stop_at(script_time(end_ms + (has_end ? 0 : script_tail)));
+
+    if (script_len > 0) {
+        sim_event_at(script_time(script[0].ms), -1, script_fire, NULL, 0);
+    }
+}
+
+bool sim_script_started(void) {
+    return started;
+}
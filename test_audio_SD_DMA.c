@@ -2,20 +2,31 @@
  * @file test_audio_SD_DMA.c
  * @brief Prueba completa del sistema de audio: SD, I2S, reproductor, LCD,
  *        selector de instrumentos, IMU y modo de bajo consumo.
+ *
+ * Core0 atiende IMU, botones, LCD y consola; el audio corre en core1
+ * (audio_engine) y se controla mediante comandos. El bucle principal de
+ * core0 duerme hasta que una IRQ o core1 le avisan (event_loop) o vence
+ * el plazo del siguiente trabajo periódico.
  */
 
 #include <stdio.h>
-#include <math.h>
+#include <stdlib.h>
 
 #include "pico/stdlib.h"
-#include "hardware/clocks.h"
 
 #include "sd_manager.h"
-#include "i2s_output.h"
-#include "audio_player.h"
+#include "audio_engine.h"
+#include "sample_index.h"
+#include "mix_kernels.h"
+#include "benchmark.h"
 #include "button_controller.h"
+#include "latency_probe.h"
+#include "event_loop.h"
+#include "power_manager.h"
+#include "clock_plan.h"
 #include "mpu6050.h"
-#include "lcd.h"
+#include "imu_fusion.h"
+#include "LCD.h"
 #include "botones.h"
 #include "sistema.h"
 #include "instrumentos.h"
@@ -25,6 +36,11 @@
  */
 #define INACTIVITY_MS (10u * 60u * 1000u)
 
+/**
+ * @brief Periodo del resumen de estado mientras hay reproducción (5 s).
+ */
+#define STATUS_PERIOD_MS 5000u
+
 /**
  * @brief Indica si el sistema está en modo de bajo consumo.
  */
@@ -36,34 +52,64 @@ static bool low_power_mode = false;
 static uint32_t last_activity_time = 0;
 
 /**
- * @brief Ingresa al modo de bajo consumo reduciendo la frecuencia del sistema
- *        y deteniendo el reproductor de audio.
+ * @brief Orientación de la IMU, actualizada con cada muestra de su FIFO.
+ */
+static imu_fusion_t imu_fusion;
+
+/**
+ * @brief Ingresa al modo de bajo consumo y duerme hasta que se pulsa un botón.
+ *
+ * Suspende el audio (voces, I2S y lecturas de la SD quietos en core1),
+ * duerme la IMU, apaga la LCD y deja el chip en dormant o en sueño ligero
+ * (ver power_manager.h). Al volver, relojes y divisores ya están
+ * restaurados: reanuda el I2S y entrega la pulsación que despertó al
+ * instrumento. La IMU y la LCD vuelven en exit_low_power_mode(), después
+ * de encolar la nota.
  */
 static void enter_low_power_mode(void) {
     if (low_power_mode) {
         return;
     }
 
-    audio_player_stop();
-    set_sys_clock_khz(12000, true);
+    if (!audio_engine_suspend()) {
+        printf("Advertencia: cola de audio llena, bajo consumo postergado\n");
+        return;
+    }
+    event_loop_set_imu(false);
+    mpu6050_set_sleep(true);
+    lcd_set_power(false);
     low_power_mode = true;
+
+    power_manager_sleep(button_controller_wake_pins());
+
+    latency_probe_start_wake(power_manager_wake_us());
+    audio_engine_resume();
+    button_controller_wake();
 }
 
 /**
- * @brief Sale del modo de bajo consumo restaurando la frecuencia del sistema
- *        y actualizando el tiempo de actividad.
+ * @brief Sale del modo de bajo consumo despertando la IMU y la LCD, y
+ *        actualiza el tiempo de actividad.
  *
  * @param now Marca de tiempo actual en milisegundos.
  */
 static void exit_low_power_mode(uint32_t now) {
+    last_activity_time = now;
     if (!low_power_mode) {
-        last_activity_time = now;
         return;
     }
 
-    set_sys_clock_khz(125000, true);
+    mpu6050_set_sleep(false);
+    lcd_set_power(true);
+    imu_fusion_init(&imu_fusion);
+    event_loop_set_imu(true);
     low_power_mode = false;
-    last_activity_time = now;
+
+    power_stats_t ps = power_manager_get_stats();
+    printf("Fin del bajo consumo (%s): arranque del XOSC %lu us, relojes y divisores %lu us\n",
+           ps.xosc_us > 0 ? "dormant" : "sueño ligero",
+           (unsigned long)ps.xosc_us,
+           (unsigned long)ps.restore_us);
 }
 
 /**
@@ -74,6 +120,13 @@ static void exit_low_power_mode(uint32_t now) {
  * @return int Código de retorno estándar.
  */
 int main(void) {
+    // El reloj cambia antes de stdio y de los periféricos, que ya arrancan
+    // con sus divisores para el reloj final
+    static const uint32_t audio_rates[] = { AUDIO_OUTPUT_RATE };
+    clock_plan_t clock_plan;
+    clock_plan_compute(audio_rates, 1, &clock_plan);
+    clock_plan_apply(&clock_plan);
+
     stdio_init_all();
     sleep_ms(3000);
 
@@ -81,6 +134,10 @@ int main(void) {
     printf("Handino Motion Tool\n");
     printf("Inicializando sistema...\n\n");
 
+    printf("Paso 0: Plan de relojes para el audio\n");
+    clock_plan_print(&clock_plan);
+    printf("\n");
+
     printf("Paso 1: Inicializar modulo SD\n");
     if (!sd_manager_init()) {
         printf("Error: no se pudo inicializar la SD\n");
@@ -101,24 +158,29 @@ int main(void) {
     printf("Instrumentos cargados\n\n");
     sleep_ms(300);
 
-    printf("Paso 3: Inicializar salida I2S\n");
-    if (!i2s_output_init(44100)) {
-        printf("Error al inicializar I2S\n");
-        return -1;
-    }
-    printf("Salida I2S inicializada\n\n");
+    printf("Paso 2c: Indexar cabeceras WAV de los instrumentos\n");
+    sample_index_build();
+    printf("Samples fragmentados:\n");
+    sample_index_report_fragmentation(SAMPLE_FRAGMENT_WARN);
+    printf("Cabeceras indexadas\n\n");
     sleep_ms(300);
 
-    printf("Paso 4: Inicializar reproductor de audio\n");
-    if (!audio_player_init()) {
-        printf("Error al inicializar reproductor de audio\n");
+    printf("Paso 2d: Medir kernels de mezcla\n");
+    benchmark_print_header();
+    mix_kernels_benchmark();
+    printf("\n");
+
+    printf("Paso 3-4: Iniciar motor de audio (I2S + reproductor) en core1\n");
+    if (!audio_engine_start()) {
+        printf("Error al inicializar I2S o reproductor de audio\n");
         return -1;
     }
-    printf("Reproductor de audio inicializado\n\n");
+    printf("Motor de audio corriendo en core1\n\n");
     sleep_ms(300);
 
     printf("Paso 5: Inicializar botones de notas\n");
     button_controller_init();
+    latency_probe_init();
     printf("Botones de notas listos\n\n");
     sleep_ms(300);
 
@@ -131,60 +193,64 @@ int main(void) {
     lcd_init();
     botones_init();
     sistema_init();
+    audio_engine_set_instrument(SLOT_H, instrumento_slot[SLOT_H]);
+    audio_engine_set_instrument(SLOT_V, instrumento_slot[SLOT_V]);
     printf("LCD y selector de instrumentos inicializados\n\n");
     sleep_ms(300);
 
-    uint32_t samples_processed = 0;
+    // Divisores que dependen de clk_sys / clk_peri
+    power_manager_add_clock_listener(i2s_output_clock_changed);
+    power_manager_add_clock_listener(sd_manager_clock_changed);
+    power_manager_add_clock_listener(mpu6050_clock_changed);
+    power_manager_add_clock_listener(lcd_clock_changed);
+
+    imu_fusion_init(&imu_fusion);
+    event_loop_init();
+
     uint32_t last_status_time  = 0;
 
     bool instrumento2 = false;
-    bool sonido_b     = false;
-
-    uint32_t last_imu_time   = 0;
-    uint32_t yaw_strong_time = 0;
 
-    const char *note_tokens[7] = {
-        "do", "re", "mi", "fa", "sol", "la", "si"
-    };
+    uint16_t last_trem_rate  = 0;
+    uint16_t last_trem_depth = 0;
 
     last_activity_time = to_ms_since_boot(get_absolute_time());
     low_power_mode = false;
 
+#if BENCHMARK_AT_BOOT
+    benchmark_run();
+#endif
+
     printf("Sistema listo. Use los botones de notas y el selector de instrumentos.\n\n");
 
+    // Primera vuelta: atender todo una vez
+    uint32_t events = EVENT_ALL;
+
     while (1) {
         uint32_t now = to_ms_since_boot(get_absolute_time());
 
         /**
-         * @brief Procesamiento continuo del reproductor de audio mediante polling.
+         * @brief Muestras de la IMU: cada una pasa por la fusión de
+         *        orientación; el giro en yaw se promedia por vuelta.
          */
-        for (int i = 0; i < 8; i++) {
-            audio_player_process();
+        mpu6050_sample_t sample;
+        int32_t          gz_sum    = 0;
+        int32_t          n_samples = 0;
+
+        while ((events & EVENT_IMU) && mpu6050_stream_pop(&sample)) {
+            imu_fusion_update(&imu_fusion, &sample.raw);
+            gz_sum += sample.raw.gz;
+            n_samples++;
         }
-        samples_processed += 8;
 
-        /**
-         * @brief Lectura periódica de la IMU para detectar orientación y giros.
-         */
-        if (now - last_imu_time > 50) {
-            uint32_t dt = (last_imu_time == 0) ? 0 : (now - last_imu_time);
-            last_imu_time = now;
-
-            mpu6050_raw_t data;
-            mpu6050_read_raw(&data);
-
-            float ax = mpu6050_calc_g(data.ax);
-            float ay = mpu6050_calc_g(data.ay);
-            float az = mpu6050_calc_g(data.az);
-
-            float pitch = calc_pitch(ax, ay, az);
-            float roll  = calc_roll(ay, az);
+        if (n_samples > 0) {
+            imu_euler_t angles = imu_fusion_euler(&imu_fusion);
 
             /**
              * @brief Interpretación de orientación para decidir si usar SLOT_H o SLOT_V.
              */
-            bool vertical   = is_vertical(pitch, roll);
-            bool horizontal = is_horizontal(pitch, roll);
+            bool vertical   = imu_fusion_is_vertical(&angles);
+            bool horizontal = imu_fusion_is_horizontal(&angles);
 
             if (!instrumento2 && vertical) {
                 instrumento2 = true;
@@ -193,28 +259,32 @@ int main(void) {
             }
 
             /**
-             * @brief Lógica de detección de giro fuerte en yaw para activar sonido 'b'.
+             * @brief Giro en yaw -> tremolo: por encima del umbral, la velocidad
+             *        angular fija de forma continua la profundidad y la
+             *        frecuencia del LFO (el motor suaviza los cambios).
              */
-            const float    YAW_ON_THRESHOLD_DPS  = 35.0f;
-            const float    YAW_OFF_THRESHOLD_DPS = 15.0f;
-            const uint32_t YAW_SUSTAIN_MS        = 300;
-
-            float gz_dps  = (float)data.gz / 131.0f;
-            float yaw_abs = fabsf(gz_dps);
-
-            if (dt > 0) {
-                if (yaw_abs > YAW_ON_THRESHOLD_DPS) {
-                    yaw_strong_time += dt;
-                    if (yaw_strong_time >= YAW_SUSTAIN_MS) {
-                        sonido_b = true;
-                    }
-                } else if (yaw_abs < YAW_OFF_THRESHOLD_DPS) {
-                    yaw_strong_time = 0;
-                    sonido_b = false;
-                } else {
-                    if (!sonido_b) {
-                        yaw_strong_time = 0;
-                    }
+            const int32_t YAW_OFF_THRESHOLD_DPS = 15;
+            const int32_t YAW_FULL_DPS          = 200;
+            const int32_t TREM_MIN_RATE_CHZ     = 300;
+            const int32_t TREM_MAX_RATE_CHZ     = 1200;
+            const int32_t TREM_MAX_DEPTH_Q15    = 26214;   // 0,8
+
+            int32_t yaw_abs = abs(imu_fusion_gyro_dps((int16_t)(gz_sum / n_samples)));
+
+            // Fracción del rango en Q15: (°/s Q16 / 2) / °/s
+            int32_t amount = ((yaw_abs - IMU_FUSION_DEG(YAW_OFF_THRESHOLD_DPS)) >> 1) /
+                             (YAW_FULL_DPS - YAW_OFF_THRESHOLD_DPS);
+            if (amount < 0)     amount = 0;
+            if (amount > 32768) amount = 32768;
+
+            uint16_t trem_depth = (uint16_t)((amount * TREM_MAX_DEPTH_Q15) >> 15);
+            uint16_t trem_rate  = (uint16_t)(TREM_MIN_RATE_CHZ +
+                                  ((amount * (TREM_MAX_RATE_CHZ - TREM_MIN_RATE_CHZ)) >> 15));
+
+            if (trem_depth != last_trem_depth || trem_rate != last_trem_rate) {
+                if (audio_engine_set_tremolo(trem_rate, trem_depth)) {
+                    last_trem_rate  = trem_rate;
+                    last_trem_depth = trem_depth;
                 }
             }
         }
@@ -222,86 +292,190 @@ int main(void) {
         /**
          * @brief Gestión del selector de instrumentos.
          */
-        botones_update();
-        if (sistema_update()) {
-            exit_low_power_mode(now);
+        if (events & EVENT_BUTTON) {
+            botones_update();
+            if (sistema_update()) {
+                exit_low_power_mode(now);
+                audio_engine_set_instrument(SLOT_H, instrumento_slot[SLOT_H]);
+                audio_engine_set_instrument(SLOT_V, instrumento_slot[SLOT_V]);
+            }
+        }
+
+        /**
+         * @brief Consola USB: 'h' vuelca los contadores de salud del audio,
+         *        'r' los reinicia, 'i' muestra el flujo de la IMU.
+         */
+        int c;
+        while ((events & EVENT_CONSOLE) && (c = getchar_timeout_us(0)) >= 0) {
+            if (c == 'h') {
+                audio_engine_status_t st = audio_engine_get_status();
+                audio_health_print(&st.health);
+            } else if (c == 'r') {
+                audio_engine_reset_health();
+                printf("Contadores de salud reiniciados\n");
+            } else if (c == 'l') {
+                if (latency_probe_start_scripted(LATENCY_PROBE_MAX_PRESSES)) {
+                    printf("Medición de latencia: %u pulsaciones de Do cada %u ms\n",
+                           LATENCY_PROBE_MAX_PRESSES, LATENCY_PROBE_PERIOD_MS);
+                }
+            } else if (c == 'm') {
+                latency_probe_set_manual(!latency_probe_manual());
+                printf("Medición de latencia manual %s\n",
+                       latency_probe_manual() ? "activada" : "desactivada");
+            } else if (c == 'p') {
+                latency_probe_print();
+            } else if (c == 'b') {
+                benchmark_run();
+            } else if (c == 'i') {
+                mpu6050_stream_print();
+                imu_fusion_print(&imu_fusion);
+            }
+        }
+
+        /**
+         * @brief Eventos publicados por el motor de audio.
+         */
+        audio_engine_event_t ev;
+        while (audio_engine_poll_event(&ev)) {
+            if (ev.type == ENGINE_EVT_NOTE_FAILED) {
+                char wav_file[40];
+                sample_index_path(wav_file, sizeof(wav_file),
+                                  ev.inst, ev.variant, ev.note);
+                printf("Advertencia: no se encontro el archivo %s\n", wav_file);
+            } else {
+                last_status_time = now;
+            }
+        }
+
+        /**
+         * @brief Mensajes del reproductor (core1 no imprime).
+         */
+        char log_line[AUDIO_LOG_LINE_LEN];
+        while (audio_engine_poll_log(log_line)) {
+            printf("%s", log_line);
         }
 
         /**
          * @brief Estado cada 5 s si un archivo está en reproducción.
          */
-        if (audio_player_is_playing() && (now - last_status_time > 5000)) {
-            player_info_t info = audio_player_get_info();
-            printf("Progreso: %.1f%% (%lu/%lu bytes, %lu muestras procesadas)\n",
+        if (audio_engine_is_playing() && (now - last_status_time > STATUS_PERIOD_MS)) {
+            audio_engine_status_t st = audio_engine_get_status();
+            player_info_t info = st.player;
+            i2s_info_t i2s = st.i2s;
+            printf("Progreso: %.1f%% (%lu/%lu bytes, %lu bloques I2S, %lu en silencio, %lu sin copia)\n",
                    info.progress_percent,
                    (unsigned long)info.bytes_played,
                    (unsigned long)info.total_bytes,
-                   (unsigned long)samples_processed);
+                   (unsigned long)i2s.blocks_played,
+                   (unsigned long)i2s.silence_blocks,
+                   (unsigned long)i2s.external_blocks);
+            printf("Voces: %u activas, %lu robadas | Mezcla: %lu us prom, %lu us max (%.1f%%), ADPCM %lu us\n",
+                   info.active_voices,
+                   (unsigned long)info.voices_stolen,
+                   (unsigned long)info.mix_us_avg,
+                   (unsigned long)info.mix_us_max,
+                   info.mix_load_percent,
+                   (unsigned long)info.decode_us_avg);
+            printf("SD: %lu lecturas, %lu tarde, %lu us max | %lu faltas de datos, %lu bloques I2S vacíos\n",
+                   (unsigned long)st.health.read.count,
+                   (unsigned long)st.health.read_misses,
+                   (unsigned long)st.health.read.max_us,
+                   (unsigned long)st.health.swap_misses,
+                   (unsigned long)st.health.i2s_underruns);
+
+            sample_cache_stats_t cache = st.cache;
+            printf("Cache: %lu aciertos, %lu fallos, %lu desalojos | %u notas, %lu KB | precarga %lu pag\n",
+                   (unsigned long)cache.hits,
+                   (unsigned long)cache.misses,
+                   (unsigned long)cache.evictions,
+                   cache.entries,
+                   (unsigned long)(cache.bytes_cached / 1024),
+                   (unsigned long)info.prefetch_pages);
             last_status_time = now;
         }
 
         /**
          * @brief Procesamiento de botones de notas.
          */
-        int pressed_button = button_controller_process();
-
-        if (pressed_button >= 0) {
-            exit_low_power_mode(now);
+        button_edge_t edge;
+        int pressed_button;
+
+        while ((events & EVENT_BUTTON) &&
+               (pressed_button = button_controller_process(&edge)) >= 0) {
+            if (edge == BUTTON_RELEASE) {
+                // Suelta: la nota se apaga con su release y libera su voz
+                if (!audio_engine_release_note((uint8_t)pressed_button)) {
+                    printf("Advertencia: cola de audio llena, suelta descartada\n");
+                }
+            } else {
+                latency_probe_mark(LATENCY_POLL);
 
-            const char *note_name = button_controller_get_note_name(pressed_button);
+                const char *note_name = button_controller_get_note_name(pressed_button);
 
-            uint8_t slot = instrumento2 ? SLOT_V : SLOT_H;
-            uint8_t idx  = instrumento_slot[slot];
+                uint8_t slot = instrumento2 ? SLOT_V : SLOT_H;
+                uint8_t idx  = instrumento_slot[slot];
 
-            if (idx >= total_instrumentos && total_instrumentos > 0) {
-                idx = 0;
-            }
+                if (idx >= total_instrumentos && total_instrumentos > 0) {
+                    idx = 0;
+                }
 
-            uint8_t inst_id = (total_instrumentos > 0) ? instrumentos_id[idx] : 1;
-            const char *note_token = "do";
+                uint8_t inst_id = (total_instrumentos > 0) ? instrumentos_id[idx] : 1;
+                char sound_char = 'a';
 
-            if (pressed_button >= 0 && pressed_button < 7) {
-                note_token = note_tokens[pressed_button];
-            }
+                char wav_file[40];
+                sample_index_path(wav_file, sizeof(wav_file),
+                                  idx, sound_char, (uint8_t)pressed_button);
 
-            char sound_char = sonido_b ? 'b' : 'a';
+                printf("Nota: %s | Instrumento id=%u | Sonido %c | Archivo: %s\n",
+                       note_name,
+                       inst_id,
+                       sound_char,
+                       wav_file);
 
-            char wav_file[40];
-            snprintf(wav_file, sizeof(wav_file),
-                     "0:/i%u%c-%s.wav", inst_id, sound_char, note_token);
-
-            printf("Nota: %s | Instrumento id=%u | Sonido %c | Archivo: %s\n",
-                   note_name,
-                   inst_id,
-                   sound_char,
-                   wav_file);
+                // Antes de encolar: core1 puede tomar la nota de inmediato
+                latency_probe_mark(LATENCY_SEND);
+                if (!audio_engine_play_note(slot, sound_char, (uint8_t)pressed_button)) {
+                    printf("Advertencia: cola de audio llena, nota descartada\n");
+                }
 
-            if (audio_player_is_playing()) {
-                audio_player_stop();
+                // Con la nota ya encolada: IMU y LCD tras un despertar
+                exit_low_power_mode(now);
             }
+        }
 
-            if (audio_player_play(wav_file)) {
-                samples_processed = 0;
-                last_status_time  = now;
-            } else {
-                printf("Advertencia: no se encontro el archivo %s\n", wav_file);
-            }
+        /**
+         * @brief Despertar sin pulsación válida (rebote): salir igual.
+         */
+        if (low_power_mode && (events & EVENT_BUTTON)) {
+            exit_low_power_mode(now);
         }
 
         /**
          * @brief Entrada al modo de bajo consumo por inactividad.
          */
         if (!low_power_mode &&
-            !audio_player_is_playing() &&
+            !audio_engine_is_playing() &&
             (now - last_activity_time >= INACTIVITY_MS)) {
-            enter_low_power_mode();
             printf("Entrando en modo de bajo consumo tras inactividad prolongada.\n");
+            enter_low_power_mode();
         }
 
         /**
-         * @brief Pequeño descanso para suavizar el polling.
+         * @brief Espera del siguiente evento.
+         *
+         * El plazo cubre lo que depende solo del tiempo: el estado
+         * periódico mientras suena audio y la entrada al bajo consumo.
          */
-        sleep_us(50);
+        uint32_t timeout_ms = INACTIVITY_MS;
+        now = to_ms_since_boot(get_absolute_time());
+        if (audio_engine_is_playing()) {
+            uint32_t since = now - last_status_time;
+            timeout_ms = (since > STATUS_PERIOD_MS) ? 0 : STATUS_PERIOD_MS + 1 - since;
+        } else if (!low_power_mode) {
+            uint32_t idle = now - last_activity_time;
+            timeout_ms = (idle >= INACTIVITY_MS) ? 0 : INACTIVITY_MS - idle;
+        }
+        events = event_loop_wait(timeout_ms);
     }
 
     return 0;
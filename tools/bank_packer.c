@@ -0,0 +1,315 @@
+/**
+ * @file bank_packer.c
+ * @brief Empaquetador de bancos de instrumento para PC (ver bank_format.h).
+ *
+ * Lee index.txt de una carpeta con los samples de la tarjeta SD y, para
+ * cada instrumento "i<id>-<nombre>", reúne sus archivos
+ * "i<id><a|b>-<nota>.wav" en un banco "i<id>.bnk". Los WAV que faltan o no
+ * son PCM 16 bits / IMA ADPCM quedan como entradas vacías; un instrumento
+ * sin ningún WAV no genera banco (el firmware seguirá buscando sueltos).
+ *
+ * Compilación y uso (desde la raíz del proyecto):
+ *   gcc -std=c11 -O2 -I. -o bank_packer tools/bank_packer.c
+ *   ./bank_packer [-a <atenuacion_q8>] <carpeta_samples> [carpeta_salida]
+ *
+ * Si no se indica carpeta de salida, los bancos se escriben junto a los WAV.
+ *
+ * Con -a las notas PCM se guardan ya atenuadas (por ejemplo -a 32 = 1/8,
+ * la ganancia maestra por defecto del firmware). El firmware lo compensa
+ * con la ganancia de la voz, de modo que suenan igual, y con la ganancia
+ * maestra igual a la atenuación (la de fábrica con -a 32) una nota sola
+ * llega al I2S sin copia por la CPU.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "bank_format.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *note_tokens[BANK_NOTES] = {
+    "do", "re", "mi", "fa", "sol", "la", "si"
+};
+
+// Atenuación en Q8 aplicada a las notas PCM (256 = ninguna)
+static int atten_q8 = 256;
+
+static uint16_t rd16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void wr16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void wr32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief Audio de un WAV cargado en memoria.
+ */
+typedef struct {
+    uint8_t       *file;         // contenido completo del archivo
+    uint8_t       *data;         // inicio del chunk data
+    uint32_t       length;
+    uint32_t       sample_rate;
+    uint16_t       channels;
+    uint16_t       bits;
+    uint16_t       format;
+    uint16_t       block_align;
+    uint32_t       loop_start;   // lazo del chunk smpl en bytes de audio
+    uint32_t       loop_end;     // (0 si no tiene)
+} wav_t;
+
+/**
+ * @brief Lee un archivo completo en memoria.
+ */
+static uint8_t *read_file(const char *path, uint32_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *buf = (len > 0) ? malloc((size_t)len) : NULL;
+    if (!buf || fread(buf, 1, (size_t)len, f) != (size_t)len) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = (uint32_t)len;
+    return buf;
+}
+
+/**
+ * @brief Carga un WAV y localiza sus chunks fmt, data y smpl.
+ * @return true si el formato es uno de los que reproduce el firmware.
+ */
+static bool wav_load(const char *path, wav_t *w) {
+    uint32_t size;
+
+    memset(w, 0, sizeof(*w));
+    w->file = read_file(path, &size);
+    if (!w->file) return false;
+
+    uint8_t *b = w->file;
+    if (size < 12 || memcmp(b, "RIFF", 4) != 0 || memcmp(b + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "  %s: no es un WAV válido\n", path);
+        return false;
+    }
+
+    bool     fmt_found  = false;
+    bool     has_loop   = false;
+    uint32_t loop_first = 0;
+    uint32_t loop_last  = 0;
+    uint32_t pos        = 12;
+
+    while (pos + 8 <= size) {
+        uint32_t len = rd32(b + pos + 4);
+        if (pos + 8 + len > size) len = size - pos - 8;   // chunk truncado
+
+        if (memcmp(b + pos, "fmt ", 4) == 0 && len >= 16) {
+            const uint8_t *f = b + pos + 8;
+            w->format      = rd16(f + 0);
+            w->channels    = rd16(f + 2);
+            w->sample_rate = rd32(f + 4);
+            w->block_align = rd16(f + 12);
+            w->bits        = rd16(f + 14);
+            fmt_found      = true;
+        } else if (memcmp(b + pos, "data", 4) == 0 && fmt_found) {
+            w->data   = b + pos + 8;
+            w->length = len;
+        } else if (memcmp(b + pos, "smpl", 4) == 0 && len >= 36 + 24 &&
+                   rd32(b + pos + 8 + 28) > 0) {
+            // Primer lazo: inicio y último frame
+            loop_first = rd32(b + pos + 8 + 36 + 8);
+            loop_last  = rd32(b + pos + 8 + 36 + 12);
+            has_loop   = true;
+        }
+        pos += 8 + len + (len & 1u);
+    }
+
+    if (!w->data) {
+        fprintf(stderr, "  %s: faltan los chunks fmt/data\n", path);
+        return false;
+    }
+
+    bool pcm   = (w->format == 0x0001 && w->bits == 16);
+    bool adpcm = (w->format == 0x0011 && w->bits == 4);
+    if ((!pcm && !adpcm) || (w->channels != 1 && w->channels != 2)) {
+        fprintf(stderr, "  %s: formato %u / %u bits / %u canales no soportado\n",
+                path, w->format, w->bits, w->channels);
+        return false;
+    }
+
+    // El firmware solo repite lazos en PCM; lo demás lo valida al cargar
+    uint64_t frame = (uint64_t)w->channels * 2u;
+    if (has_loop && pcm && ((uint64_t)loop_last + 1u) * frame <= w->length) {
+        w->loop_start = (uint32_t)(loop_first * frame);
+        w->loop_end   = (uint32_t)(((uint64_t)loop_last + 1u) * frame);
+    }
+    return true;
+}
+
+/**
+ * @brief Multiplica las muestras PCM de 16 bits por atten_q8 / 256.
+ */
+static void wav_attenuate(wav_t *w) {
+    for (uint32_t i = 0; i + 1 < w->length; i += 2) {
+        int32_t s = (int16_t)rd16(w->data + i);
+        wr16(w->data + i, (uint16_t)(int16_t)(s * atten_q8 / 256));
+    }
+}
+
+/**
+ * @brief Construye el banco de un instrumento.
+ * @return Notas incluidas, o -1 si no se pudo escribir el banco.
+ */
+static int pack_instrument(const char *src_dir, const char *dst_dir, int id) {
+    uint8_t header[BANK_HEADER_SIZE];
+    uint8_t zeros[BANK_SECTOR] = {0};
+    char    path[512];
+    wav_t   wav[BANK_ENTRIES];
+    int     count = 0;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, BANK_MAGIC, 4);
+    wr16(header + 4, BANK_VERSION);
+    wr16(header + 6, BANK_ENTRIES);
+
+    // Asignar offsets: cada nota empieza en un límite de sector
+    uint32_t offset = BANK_HEADER_SIZE;
+    for (int v = 0; v < BANK_VARIANTS; v++) {
+        for (int n = 0; n < BANK_NOTES; n++) {
+            int      i = v * BANK_NOTES + n;
+            uint8_t *e = header + BANK_TABLE_OFFSET + i * BANK_ENTRY_SIZE;
+
+            snprintf(path, sizeof(path), "%s/i%d%c-%s.wav",
+                     src_dir, id, 'a' + v, note_tokens[n]);
+            if (!wav_load(path, &wav[i])) {
+                free(wav[i].file);
+                wav[i].file = NULL;
+                continue;
+            }
+
+            wr32(e + BANK_E_OFFSET,      offset);
+            wr32(e + BANK_E_LENGTH,      wav[i].length);
+            wr32(e + BANK_E_SAMPLE_RATE, wav[i].sample_rate);
+            wr16(e + BANK_E_CHANNELS,    wav[i].channels);
+            wr16(e + BANK_E_BITS,        wav[i].bits);
+            wr16(e + BANK_E_FORMAT,      wav[i].format);
+            wr16(e + BANK_E_BLOCK_ALIGN, wav[i].block_align);
+            wr32(e + BANK_E_LOOP_START,  wav[i].loop_start);
+            wr32(e + BANK_E_LOOP_END,    wav[i].loop_end);
+
+            // El ADPCM no se puede atenuar sin recodificar: queda como está
+            if (atten_q8 != 256 && wav[i].format == 0x0001) {
+                wav_attenuate(&wav[i]);
+                wr16(e + BANK_E_ATTEN, (uint16_t)atten_q8);
+            }
+
+            offset += (wav[i].length + BANK_SECTOR - 1) / BANK_SECTOR * BANK_SECTOR;
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        printf("i%d: sin WAV, banco omitido\n", id);
+        return 0;
+    }
+
+    snprintf(path, sizeof(path), "%s/i%d.bnk", dst_dir, id);
+    FILE *out = fopen(path, "wb");
+    bool  ok  = (out != NULL) && fwrite(header, 1, sizeof(header), out) == sizeof(header);
+
+    for (int i = 0; ok && i < BANK_ENTRIES; i++) {
+        if (!wav[i].file) continue;
+
+        uint32_t pad = (BANK_SECTOR - wav[i].length % BANK_SECTOR) % BANK_SECTOR;
+        ok = fwrite(wav[i].data, 1, wav[i].length, out) == wav[i].length &&
+             fwrite(zeros, 1, pad, out) == pad;
+    }
+
+    for (int i = 0; i < BANK_ENTRIES; i++) {
+        free(wav[i].file);
+    }
+    if (out) fclose(out);
+
+    if (!ok) {
+        fprintf(stderr, "No se pudo escribir %s\n", path);
+        return -1;
+    }
+
+    printf("%s: %d/%d notas, %lu bytes\n", path, count, BANK_ENTRIES,
+           (unsigned long)offset);
+    return count;
+}
+
+int main(int argc, char **argv) {
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-a") == 0) {
+        atten_q8 = atoi(argv[2]);
+        if (atten_q8 < BANK_MIN_ATTEN_Q8 || atten_q8 > 256) {
+            fprintf(stderr, "Atenuación fuera de rango (%d..256)\n", BANK_MIN_ATTEN_Q8);
+            return 1;
+        }
+        arg = 3;
+    }
+
+    if (argc <= arg) {
+        fprintf(stderr, "Uso: %s [-a <atenuacion_q8>] <carpeta_samples> [carpeta_salida]\n",
+                argv[0]);
+        return 1;
+    }
+
+    const char *src_dir = argv[arg];
+    const char *dst_dir = (argc > arg + 1) ? argv[arg + 1] : argv[arg];
+    char        path[512];
+    char        line[64];
+
+    snprintf(path, sizeof(path), "%s/index.txt", src_dir);
+    FILE *index = fopen(path, "r");
+    if (!index) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return 1;
+    }
+
+    // Mismo formato que lee el firmware: "i<id>-<nombre>"
+    int banks = 0, errors = 0;
+    while (fgets(line, sizeof(line), index)) {
+        if (line[0] != 'i' || !strchr(line, '-')) continue;
+
+        int id = atoi(line + 1);
+        if (id <= 0 || id > 255) continue;
+
+        int notes = pack_instrument(src_dir, dst_dir, id);
+        if (notes < 0) {
+            errors++;
+        } else if (notes > 0) {
+            banks++;
+        }
+    }
+    fclose(index);
+
+    printf("Bancos generados: %d (errores: %d)\n", banks, errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file tremolo.c
+ * @brief Implementación del LFO del tremolo.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#include "tremolo.h"
+#include <stdbool.h>
+#include <math.h>
+
+/** Muestras de la tabla del seno (índice = 8 bits altos de la fase). */
+#define TREMOLO_TABLE_SIZE  256
+
+/** Suavizado de objetivos: se recorre 1/2^N de la diferencia por bloque. */
+#define TREMOLO_SMOOTH_SHIFT  3
+
+static int16_t  sine_q15[TREMOLO_TABLE_SIZE];
+static bool     table_ready = false;
+
+static uint32_t phase      = 0;
+static uint32_t phase_k_q8 = 0;   // incremento de fase por frame y por cHz, Q8
+
+static int32_t  rate_chz   = 0,  rate_target  = 0;
+static int32_t  depth_q15  = 0,  depth_target = 0;
+
+void tremolo_init(uint32_t sample_rate) {
+    if (!table_ready) {
+        for (int i = 0; i < TREMOLO_TABLE_SIZE; i++) {
+            sine_q15[i] = (int16_t)lrintf(32767.0f *
+                          sinf(2.0f * 3.14159265f * (float)i / TREMOLO_TABLE_SIZE));
+        }
+        table_ready = true;
+    }
+
+    // 2^32 / (100 * fs) por centésima de Hz, con 8 bits de fracción
+    phase_k_q8 = (sample_rate > 0)
+                 ? (uint32_t)((1ull << 40) / (100ull * sample_rate))
+                 : 0;
+    phase = 0;
+}
+
+/**
+ * @brief Acerca un valor a su objetivo; avanza al menos una unidad por bloque.
+ */
+static int32_t smooth(int32_t cur, int32_t target) {
+    int32_t d = target - cur;
+    if (d > 0) {
+        return cur + ((d + (1 << TREMOLO_SMOOTH_SHIFT) - 1) >> TREMOLO_SMOOTH_SHIFT);
+    }
+    return cur + (d >> TREMOLO_SMOOTH_SHIFT);
+}
+
+void tremolo_set(uint16_t rate, uint16_t depth) {
+    if (rate  > TREMOLO_MAX_RATE_CHZ) rate  = TREMOLO_MAX_RATE_CHZ;
+    if (depth > 32767)                depth = 32767;
+
+    rate_target  = rate;
+    depth_target = depth;
+}
+
+int32_t tremolo_next_gain(uint32_t frames) {
+    rate_chz  = smooth(rate_chz,  rate_target);
+    depth_q15 = smooth(depth_q15, depth_target);
+
+    uint32_t inc = ((uint32_t)rate_chz * phase_k_q8) >> 8;
+    phase += inc * frames;
+
+    if (depth_q15 == 0) {
+        return TREMOLO_UNITY_Q15;
+    }
+
+    // g = 1 - depth * (1 - sen) / 2, entre 1 - depth y 1
+    int32_t s    = sine_q15[phase >> 24];
+    int32_t dip  = (32768 - s) >> 1;
+    return TREMOLO_UNITY_Q15 - ((depth_q15 * dip) >> 15);
+}
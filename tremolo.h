@@ -0,0 +1,49 @@
+/**
+ * @file tremolo.h
+ * @brief Tremolo en punto fijo aplicado a la mezcla completa, bloque a bloque.
+ *
+ * Un LFO senoidal (tabla de 256 muestras, fase de 32 bits) modula la
+ * amplitud de la salida. La frecuencia y la profundidad se fijan como
+ * objetivos y se alcanzan suavemente, de modo que pueden seguir de forma
+ * continua al giroscopio mientras una nota ya está sonando.
+ *
+ * @authors
+ *  - Mauricio Reyes Rosero
+ *  - Reinaldo Marín Nieto
+ *  - Daniel Pérez Gallego
+ *  - Jorge Arroyo Niño
+ */
+
+#ifndef TREMOLO_H
+#define TREMOLO_H
+
+#include <stdint.h>
+
+/** Ganancia unitaria del tremolo en Q15. */
+#define TREMOLO_UNITY_Q15   32768
+
+/** Frecuencia máxima del LFO en centésimas de Hz (20 Hz). */
+#define TREMOLO_MAX_RATE_CHZ  2000
+
+/**
+ * @brief Reinicia el LFO para una frecuencia de muestreo de salida.
+ */
+void tremolo_init(uint32_t sample_rate);
+
+/**
+ * @brief Fija los objetivos de frecuencia y profundidad.
+ *
+ * @param rate_chz Frecuencia del LFO en centésimas de Hz.
+ * @param depth_q15 Profundidad en Q15 (0 = sin efecto, 32767 = 100 %).
+ */
+void tremolo_set(uint16_t rate_chz, uint16_t depth_q15);
+
+/**
+ * @brief Avanza el LFO un bloque y devuelve la ganancia al final del bloque.
+ *
+ * @param frames Frames del bloque.
+ * @return Ganancia en Q15 (TREMOLO_UNITY_Q15 si la profundidad es 0).
+ */
+int32_t tremolo_next_gain(uint32_t frames);
+
+#endif // TREMOLO_H